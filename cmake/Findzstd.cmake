@@ -0,0 +1,20 @@
+# Look for the header file.
+FIND_PATH(ZSTD_INCLUDE_DIR NAMES zstd.h)
+
+# Look for the library.
+FIND_LIBRARY(ZSTD_LIBRARY NAMES zstd libzstd)
+
+# Handle the QUIETLY and REQUIRED arguments and set ZSTD_FOUND to TRUE if all listed variables are TRUE.
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(ZSTD DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+
+# Copy the results to the output variables.
+IF(ZSTD_FOUND)
+	SET(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+	SET(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+ELSE(ZSTD_FOUND)
+	SET(ZSTD_LIBRARIES)
+	SET(ZSTD_INCLUDE_DIRS)
+ENDIF(ZSTD_FOUND)
+
+MARK_AS_ADVANCED(ZSTD_INCLUDE_DIRS ZSTD_LIBRARIES)
@@ -41,8 +41,17 @@ struct print_array {
 
 std::ostream& operator<<(std::ostream& o, const print_array& a);
 
+/**
+ * Most verbose level compiled in, 0 (Error) to 4 (Trace). Statements of more
+ * verbose levels are constant false and removed by the compiler, including
+ * the formatting of their arguments.
+ */
+#ifndef PVLIB_LOG_LEVEL
+#define PVLIB_LOG_LEVEL 4
+#endif
+
 #define LOG(LEVEL) \
-if (LEVEL > Log::reportingLevel()) \
+if (LEVEL > PVLIB_LOG_LEVEL || LEVEL > Log::reportingLevel()) \
 ; \
 else \
 Log().get(LEVEL, __FILE__, __LINE__)
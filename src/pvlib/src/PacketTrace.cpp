@@ -0,0 +1,156 @@
+/*
+ *   Pvlib - Packet trace
+ *
+ *   Copyright (C) 2011
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include "PacketTrace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "Log.h"
+
+namespace pvlib {
+
+namespace {
+
+const uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+const uint32_t LINKTYPE_USER0 = 147;
+const uint32_t PSEUDO_HEADER_SIZE = 2;
+
+struct PcapHeader {
+	uint32_t magic;
+	uint16_t versionMajor;
+	uint16_t versionMinor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+};
+
+struct PcapRecordHeader {
+	uint32_t sec;
+	uint32_t usec;
+	uint32_t inclLen;
+	uint32_t origLen;
+};
+
+} //namespace {
+
+const size_t PacketTrace::SLOTS;
+const size_t PacketTrace::SNAP_LEN;
+const std::chrono::seconds PacketTrace::ERROR_DUMP_INTERVAL(60);
+
+PacketTrace::PacketTrace() : next(0), count(0), lastErrorDump(std::chrono::steady_clock::now() - ERROR_DUMP_INTERVAL) {
+	//nothing to do
+}
+
+PacketTrace& PacketTrace::instance() {
+	static PacketTrace packetTrace;
+	return packetTrace;
+}
+
+void PacketTrace::record(Layer layer, Direction direction, const uint8_t *data, size_t len,
+		const uint8_t *data2, size_t len2) {
+	int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	size_t copy = std::min(len, SNAP_LEN);
+	size_t copy2 = std::min(len2, SNAP_LEN - copy);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Frame& frame = frames[next];
+	frame.time = time;
+	frame.len = len + len2;
+	frame.direction = direction;
+	frame.layer = layer;
+	memcpy(frame.data, data, copy);
+	if (copy2 > 0) {
+		memcpy(frame.data + copy, data2, copy2);
+	}
+
+	next = (next + 1) % SLOTS;
+	count = std::min(count + 1, SLOTS);
+}
+
+int PacketTrace::dump(const std::string& file) {
+	std::vector<Frame> copy;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		copy.reserve(count);
+		for (size_t i = (next + SLOTS - count) % SLOTS; copy.size() < count; i = (i + 1) % SLOTS) {
+			copy.push_back(frames[i]);
+		}
+	}
+
+	FILE *f = fopen(file.c_str(), "wb");
+	if (f == nullptr) {
+		LOG(Error) << "Could not open packet trace file: " << file;
+		return -1;
+	}
+
+	PcapHeader header = { PCAP_MAGIC, 2, 4, 0, 0, SNAP_LEN + PSEUDO_HEADER_SIZE, LINKTYPE_USER0 };
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+	for (const Frame& frame : copy) {
+		uint32_t inclLen = std::min<uint32_t>(frame.len, SNAP_LEN);
+		PcapRecordHeader recordHeader = {
+			static_cast<uint32_t>(frame.time / 1000000),
+			static_cast<uint32_t>(frame.time % 1000000),
+			inclLen + PSEUDO_HEADER_SIZE,
+			frame.len + PSEUDO_HEADER_SIZE
+		};
+		uint8_t pseudoHeader[PSEUDO_HEADER_SIZE] = { frame.direction, frame.layer };
+
+		ok = ok && fwrite(&recordHeader, sizeof(recordHeader), 1, f) == 1;
+		ok = ok && fwrite(pseudoHeader, PSEUDO_HEADER_SIZE, 1, f) == 1;
+		ok = ok && (inclLen == 0 || fwrite(frame.data, inclLen, 1, f) == 1);
+	}
+
+	if (fclose(f) != 0 || !ok) {
+		LOG(Error) << "Failed writing packet trace file: " << file;
+		return -1;
+	}
+
+	return 0;
+}
+
+void PacketTrace::setErrorFile(const std::string& file) {
+	std::lock_guard<std::mutex> lock(errorMutex);
+	errorFile = file;
+}
+
+void PacketTrace::error() {
+	std::lock_guard<std::mutex> lock(errorMutex);
+	if (errorFile.empty()) {
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastErrorDump < ERROR_DUMP_INTERVAL) {
+		return;
+	}
+	lastErrorDump = now;
+
+	if (dump(errorFile) == 0) {
+		LOG(Info) << "Dumped packet trace to " << errorFile;
+	}
+}
+
+} //namespace pvlib {
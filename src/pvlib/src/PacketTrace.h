@@ -0,0 +1,105 @@
+/*
+ *   Pvlib - Packet trace
+ *
+ *   Copyright (C) 2011
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef PACKETTRACE_H
+#define PACKETTRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <chrono>
+
+#include <utility.h>
+
+namespace pvlib {
+
+/**
+ * Ring of the last raw frames sent and received, independent of the log level.
+ *
+ * Recording a frame only copies it into a preallocated slot, frames are formatted
+ * when the trace is dumped. Dumps are pcap files with link type USER0, every frame
+ * is prefixed with a two byte pseudo header: direction and layer.
+ */
+class PacketTrace {
+	DISABLE_COPY(PacketTrace)
+public:
+	enum Direction : uint8_t {
+		OUT = 0, IN = 1
+	};
+
+	enum Layer : uint8_t {
+		SMABLUETOOTH = 0, SMADATA2PLUS = 1
+	};
+
+	static const size_t SLOTS = 256;
+	static const size_t SNAP_LEN = 600; //longer frames are truncated
+
+	static PacketTrace& instance();
+
+	/**
+	 * Record frame consisting of data followed by data2.
+	 */
+	void record(Layer layer, Direction direction, const uint8_t *data, size_t len,
+			const uint8_t *data2 = nullptr, size_t len2 = 0);
+
+	/**
+	 * Write recorded frames, oldest first, to file.
+	 *
+	 * @return 0 on success, -1 if file could not be written.
+	 */
+	int dump(const std::string& file);
+
+	/**
+	 * Set file dumped to by error. Empty file disables dumping on errors.
+	 */
+	void setErrorFile(const std::string& file);
+
+	/**
+	 * Dump to error file, at most once per ERROR_DUMP_INTERVAL.
+	 */
+	void error();
+
+private:
+	static const std::chrono::seconds ERROR_DUMP_INTERVAL;
+
+	struct Frame {
+		int64_t time; //microseconds since epoch
+		uint32_t len; //original length
+		Direction direction;
+		Layer layer;
+		uint8_t data[SNAP_LEN];
+	};
+
+	PacketTrace();
+
+	std::mutex mutex;
+	Frame frames[SLOTS];
+	size_t next;
+	size_t count;
+
+	std::mutex errorMutex;
+	std::string errorFile;
+	std::chrono::steady_clock::time_point lastErrorDump;
+};
+
+} //namespace pvlib {
+
+#endif /* #ifndef PACKETTRACE_H */
@@ -115,6 +115,8 @@ public:
 
 	virtual int readEvents(uint32_t id, time_t from, time_t to, pvlib_event **events) = 0;
 
+	virtual void readCounters(pvlib_counters *counters) = 0;
+
 	static const std::vector<const ProtocolInfo*> availableProtocols;
 };
 
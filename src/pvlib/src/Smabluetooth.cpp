@@ -28,6 +28,7 @@
 
 #include "Log.h"
 #include "Connection.h"
+#include "PacketTrace.h"
 
 namespace pvlib {
 
@@ -243,6 +244,8 @@ void Smabluetooth::worker_thread() {
 		if ((ret = read_complete_len(con, packet.data, packet.len, TIMEOUT)) < 0) {
 			goto error;
 		}
+		PacketTrace::instance().record(PacketTrace::SMABLUETOOTH, PacketTrace::IN, buf, HEADER_SIZE,
+				packet.data, packet.len);
 
 		//LOG_DEBUG("Got header");
 
@@ -255,6 +258,7 @@ void Smabluetooth::worker_thread() {
 			mutex.lock();
 			if (packets.size() >= MAX_PACKETS_SIZE) { //remove old packets
 				packets.pop();
+				droppedPackets++;
 			}
 			packets.push(packet);
 			mutex.unlock();
@@ -285,7 +289,8 @@ Smabluetooth::Smabluetooth(Connection *con) :
 		state(STATE_NOT_CONNECTED),
 		num_devices(0),
 		signalStrength(0),
-		events(0) {
+		events(0),
+		droppedPackets(0) {
 	memset(mac, 0, sizeof(mac));
 	memset(mac_inv, 0, sizeof(mac_inv));
 }
@@ -379,6 +384,7 @@ int Smabluetooth::writePacket(const Packet *packet)
 	memcpy(&buf[18], packet->data, packet->len);
 
 	LOG(Trace) << "smabluetooth, write:\n" << print_array(buf, len);
+	PacketTrace::instance().record(PacketTrace::SMABLUETOOTH, PacketTrace::OUT, buf, len);
 
 	if ((ret = con->write(buf, len)) < 0) {
 		LOG(Error) << "Failed writing data.";
@@ -444,6 +450,10 @@ int Smabluetooth::read(uint8_t *data, int maxlen, std::string &from) {
 	return dataLen;
 }
 
+uint64_t Smabluetooth::getDroppedPackets() const {
+	return droppedPackets;
+}
+
 int Smabluetooth::getSignalStrength(const uint8_t *mac)
 {
 	Packet packet;
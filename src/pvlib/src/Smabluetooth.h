@@ -125,6 +125,11 @@ public:
 	 * @return signal strength from 0 to 100 inclusive, if error occurs < 0.
 	 */
 	int getSignalStrength(const uint8_t *mac);
+
+	/**
+	 * Number of received packets dropped because the queue was full.
+	 */
+	uint64_t getDroppedPackets() const;
 private:
 	int cmd_02(const Packet *packet);
 
@@ -172,6 +177,7 @@ private:
 
 	std::queue<Packet> packets;
 	const static size_t MAX_PACKETS_SIZE = 40;
+	std::atomic<uint64_t> droppedPackets;
 };
 
 } //namespace pvlib {
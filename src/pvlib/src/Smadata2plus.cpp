@@ -36,6 +36,7 @@
 #include <Smanet.h>
 
 #include "Log.h"
+#include "PacketTrace.h"
 #include "byte.h"
 #include "pvlib.h"
 #include "resources.h"
@@ -504,6 +505,7 @@ int Smadata2plus::writeReplay(const Packet *packet, uint16_t transactionCntr)
 
 	memcpy(&buf[size], packet->data, packet->len);
 	LOG(Trace) << "write smadata2plus packet\n" << print_array(buf, packet->len + size);
+	PacketTrace::instance().record(PacketTrace::SMADATA2PLUS, PacketTrace::OUT, buf, packet->len + size);
 
 	std::string to(mac_dst, 6);
 	return smanet.write(buf, size + packet->len, to);
@@ -543,6 +545,7 @@ int Smadata2plus::read(Packet *packet) {
 	memcpy(packet->src_mac, src.c_str(), macsize);
 
 	LOG(Trace) << "read smadata2plus packet" << print_array(buf, len);
+	PacketTrace::instance().record(PacketTrace::SMADATA2PLUS, PacketTrace::IN, buf, len);
 
 	packet->ctrl = buf[1];
 	packet->dst = byte::parseU32le(&buf[4]);
@@ -971,7 +974,8 @@ Smadata2plus::Smadata2plus(Connection *con) :
 		sma(con),
 		smanet(PROTOCOL, &sma),
 		transaction_cntr(TRANSACTION_CNTR_START),
-		transaction_active(false) {
+		transaction_active(false),
+		retries(0) {
 
 	std::string tagFile = std::string(resources_path()) + '/' + "en_US_tags.txt";
 	if (readTags(tagFile) < 0) {
@@ -1005,6 +1009,7 @@ int Smadata2plus::connect(const char *password, const void *param)
 		} else if (ret < 0){
 			LOG(Warning) << "Device discover failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1018,6 +1023,7 @@ int Smadata2plus::connect(const char *password, const void *param)
 		} else if (ret < 0){
 			LOG(Warning) << "Authentication failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1031,6 +1037,7 @@ int Smadata2plus::connect(const char *password, const void *param)
 		} else if (ret < 0){
 			LOG(Warning) << "Sync time failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1089,6 +1096,7 @@ int Smadata2plus::readAc(uint32_t id, pvlib_ac *ac)
 		} else if (ret < 0){
 			LOG(Warning) << "Reading dc spot data failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1196,6 +1204,7 @@ int Smadata2plus::readDc(uint32_t id, pvlib_dc *dc)
 		} else if (ret < 0){
 			LOG(Error) << "Reading dc spot data failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1276,6 +1285,7 @@ int Smadata2plus::readStats(uint32_t id, pvlib_stats *stats) {
 		} else if (ret < 0){
 			LOG(Warning) << "Reading stats failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1323,6 +1333,7 @@ int Smadata2plus::readStatus(uint32_t id, pvlib_status *status)
 		} else if (ret < 0){
 			LOG(Warning) << "Reading inverter status failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1406,6 +1417,7 @@ int Smadata2plus::readInverterInfo(uint32_t id, pvlib_inverter_info *inverter_in
 		} else if (ret < 0){
 			LOG(Warning) << "Reading inverter info failed! Retrying ...";
 			cnt++;
+			retries++;
 			sleep_for(seconds(cnt));
 		}
 	} while (ret < 0);
@@ -1733,6 +1745,11 @@ int Smadata2plus::readEvents(uint32_t id, time_t from, time_t to, pvlib_event**
 	return eventData.size();
 }
 
+void Smadata2plus::readCounters(pvlib_counters *counters) {
+	counters->retries        = retries;
+	counters->droppedPackets = sma.getDroppedPackets();
+}
+
 int Smadata2plus::inverterNum() {
 	return devices.size();
 }
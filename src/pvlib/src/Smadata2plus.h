@@ -22,6 +22,7 @@
 #define SMADATA2PLUS_H
 
 #include <Protocol.h>
+#include <atomic>
 #include <cstring>
 #include <unordered_map>
 
@@ -68,6 +69,8 @@ public:
 
 	virtual int readEvents(uint32_t id, time_t from, time_t to, pvlib_event **events) override;
 
+	virtual void readCounters(pvlib_counters *counters) override;
+
 	struct Device {
 		uint32_t serial;
 		char     mac[6];
@@ -156,6 +159,8 @@ private:
 	uint16_t transaction_cntr; // Packet counter
 	bool transaction_active;
 
+	std::atomic<uint64_t> retries;
+
 	std::vector<Device> devices;
 
 	struct Tag {
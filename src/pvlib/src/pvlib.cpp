@@ -25,6 +25,7 @@
 #include "pvlib.h"
 #include "Connection.h"
 #include "Protocol.h"
+#include "PacketTrace.h"
 
 using namespace pvlib;
 
@@ -33,6 +34,13 @@ struct pvlib_plant {
 	Protocol *protocol;
 };
 
+static int traceError(int ret) {
+	if (ret < 0) {
+		PacketTrace::instance().error();
+	}
+	return ret;
+}
+
 int pvlib_connection_num(void) {
 	return Connection::availableConnections.size();
 }
@@ -113,6 +121,7 @@ int pvlib_connect(pvlib_plant *plant,
         return ret;
     }
 	if ((ret = plant->protocol->connect(passwd, protocol_param)) < 0) {
+	    PacketTrace::instance().error();
 	    plant->con->disconnect();
 	    return ret;
 	}
@@ -144,31 +153,43 @@ int pvlib_device_handles(pvlib_plant *plant, uint32_t *ids, int max_handles) {
 }
 
 int pvlib_get_ac_values(pvlib_plant *plant, uint32_t id, pvlib_ac *ac) {
-	return plant->protocol->readAc(id, ac);
+	return traceError(plant->protocol->readAc(id, ac));
 }
 
 int pvlib_get_dc_values(pvlib_plant *plant, uint32_t id, pvlib_dc *dc) {
-	return plant->protocol->readDc(id, dc);
+	return traceError(plant->protocol->readDc(id, dc));
 }
 
 int pvlib_get_stats(pvlib_plant *plant, uint32_t id, pvlib_stats *stats) {
-	return plant->protocol->readStats(id, stats);
+	return traceError(plant->protocol->readStats(id, stats));
 }
 
 int pvlib_get_status(pvlib_plant *plant, uint32_t id, pvlib_status *status) {
-    return plant->protocol->readStatus(id, status);
+    return traceError(plant->protocol->readStatus(id, status));
 }
 
 int pvlib_get_inverter_info(pvlib_plant *plant, uint32_t id, pvlib_inverter_info *inverter_info) {
-	return plant->protocol->readInverterInfo(id, inverter_info);
+	return traceError(plant->protocol->readInverterInfo(id, inverter_info));
 }
 
 int pvlib_get_day_yield(pvlib_plant *plant, uint32_t id, time_t from, time_t to, pvlib_day_yield **dayYield) {
-	return plant->protocol->readDayYield(id, from, to, dayYield);
+	return traceError(plant->protocol->readDayYield(id, from, to, dayYield));
 }
 
 int pvlib_get_events(pvlib_plant *plant, uint32_t id, time_t from, time_t to, pvlib_event **events) {
-	return plant->protocol->readEvents(id, from, to, events);
+	return traceError(plant->protocol->readEvents(id, from, to, events));
+}
+
+void pvlib_get_counters(pvlib_plant *plant, pvlib_counters *counters) {
+	plant->protocol->readCounters(counters);
+}
+
+int pvlib_dump_packet_trace(const char *file) {
+	return PacketTrace::instance().dump(file);
+}
+
+void pvlib_set_packet_trace_file(const char *file) {
+	PacketTrace::instance().setErrorFile(file != NULL ? file : "");
 }
 
 void *pvlib_protocol_handle(pvlib_plant *plant) {
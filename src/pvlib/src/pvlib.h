@@ -120,6 +120,11 @@ typedef struct pvlib_event {
 	char    message[255];
 } pvlib_event;
 
+typedef struct pvlib_counters {
+	uint64_t retries;        ///<requests repeated after a failed attempt
+	uint64_t droppedPackets; ///<received packets dropped because the receive queue was full
+} pvlib_counters;
+
 /**
  * Initialize pvlib.
  *
@@ -321,6 +326,32 @@ int pvlib_get_day_yield(pvlib_plant *plant, uint32_t id, time_t from, time_t to,
  */
 int pvlib_get_events(pvlib_plant *plant, uint32_t id, time_t from, time_t to, pvlib_event **events);
 
+/**
+ * Read counters of plant since it was opened.
+ *
+ * @param plant plant handle
+ * @param[out] counters counters of plant.
+ */
+void pvlib_get_counters(pvlib_plant *plant, pvlib_counters *counters);
+
+/**
+ * Write the last raw frames sent and received by all plants to file.
+ * The file is in pcap format with link type USER0, every frame is prefixed
+ * with its direction (0 sent, 1 received) and layer (0 smabluetooth, 1 smadata2plus).
+ *
+ * @param file path of file to write.
+ * @return 0 on success, -1 if file could not be written.
+ */
+int pvlib_dump_packet_trace(const char *file);
+
+/**
+ * Set file the packet trace is dumped to if a request to a plant fails.
+ * Dumps on error are limited to one per minute.
+ *
+ * @param file path of file to write or NULL to disable dumping on errors.
+ */
+void pvlib_set_packet_trace_file(const char *file);
+
 /**
  * Returns protocol handle.
  * This must not be supported by protocol, so NULL does not mean an error occurred.
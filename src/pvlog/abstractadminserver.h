@@ -31,6 +31,10 @@ class AbstractAdminServer : public jsonrpc::AbstractServer<AbstractAdminServer>
             this->bindAndAddMethod(jsonrpc::Procedure("saveEmail", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "email",jsonrpc::JSON_STRING, NULL), &AbstractAdminServer::saveEmailI);
             this->bindAndAddMethod(jsonrpc::Procedure("getEmail", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractAdminServer::getEmailI);
             this->bindAndAddMethod(jsonrpc::Procedure("sendTestEmail", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractAdminServer::sendTestEmailI);
+            this->bindAndAddMethod(jsonrpc::Procedure("backupDatabase", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "file",jsonrpc::JSON_STRING, NULL), &AbstractAdminServer::backupDatabaseI);
+            this->bindAndAddMethod(jsonrpc::Procedure("dumpPacketTrace", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "file",jsonrpc::JSON_STRING, NULL), &AbstractAdminServer::dumpPacketTraceI);
+            this->bindAndAddMethod(jsonrpc::Procedure("exportDatabase", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "directory",jsonrpc::JSON_STRING, NULL), &AbstractAdminServer::exportDatabaseI);
+            this->bindAndAddMethod(jsonrpc::Procedure("importDatabase", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "directory",jsonrpc::JSON_STRING, NULL), &AbstractAdminServer::importDatabaseI);
         }
 
         inline virtual void stopDataloggerI(const Json::Value &request)
@@ -120,6 +124,22 @@ class AbstractAdminServer : public jsonrpc::AbstractServer<AbstractAdminServer>
             (void)request;
             response = this->sendTestEmail();
         }
+        inline virtual void backupDatabaseI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->backupDatabase(request["file"].asString());
+        }
+        inline virtual void dumpPacketTraceI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->dumpPacketTrace(request["file"].asString());
+        }
+        inline virtual void exportDatabaseI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->exportDatabase(request["directory"].asString());
+        }
+        inline virtual void importDatabaseI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->importDatabase(request["directory"].asString());
+        }
         virtual void stopDatalogger() = 0;
         virtual void startDatalogger() = 0;
         virtual bool isDataloggerRunning() = 0;
@@ -139,6 +159,10 @@ class AbstractAdminServer : public jsonrpc::AbstractServer<AbstractAdminServer>
         virtual Json::Value saveEmail(const std::string& email) = 0;
         virtual Json::Value getEmail() = 0;
         virtual Json::Value sendTestEmail() = 0;
+        virtual Json::Value backupDatabase(const std::string& file) = 0;
+        virtual Json::Value dumpPacketTrace(const std::string& file) = 0;
+        virtual Json::Value exportDatabase(const std::string& directory) = 0;
+        virtual Json::Value importDatabase(const std::string& directory) = 0;
 };
 
 #endif //JSONRPC_CPP_STUB_ABSTRACTADMINSERVER_H_
@@ -13,6 +13,7 @@ class AbstractPvlogServer : public jsonrpc::AbstractServer<AbstractPvlogServer>
         AbstractPvlogServer(jsonrpc::AbstractServerConnector &conn, jsonrpc::serverVersion_t type = jsonrpc::JSONRPC_SERVER_V2) : jsonrpc::AbstractServer<AbstractPvlogServer>(conn, type)
         {
             this->bindAndAddMethod(jsonrpc::Procedure("getSpotData", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "date",jsonrpc::JSON_STRING, NULL), &AbstractPvlogServer::getSpotDataI);
+            this->bindAndAddMethod(jsonrpc::Procedure("getSpotDataRange", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "from",jsonrpc::JSON_STRING,"method",jsonrpc::JSON_STRING,"points",jsonrpc::JSON_INTEGER,"to",jsonrpc::JSON_STRING, NULL), &AbstractPvlogServer::getSpotDataRangeI);
             this->bindAndAddMethod(jsonrpc::Procedure("getLiveSpotData", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractPvlogServer::getLiveSpotDataI);
             this->bindAndAddMethod(jsonrpc::Procedure("getDataloggerStatus", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractPvlogServer::getDataloggerStatusI);
             this->bindAndAddMethod(jsonrpc::Procedure("getDayData", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "from",jsonrpc::JSON_STRING,"to",jsonrpc::JSON_STRING, NULL), &AbstractPvlogServer::getDayDataI);
@@ -30,6 +31,10 @@ class AbstractPvlogServer : public jsonrpc::AbstractServer<AbstractPvlogServer>
         {
             response = this->getSpotData(request["date"].asString());
         }
+        inline virtual void getSpotDataRangeI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->getSpotDataRange(request["from"].asString(), request["method"].asString(), request["points"].asInt(), request["to"].asString());
+        }
         inline virtual void getLiveSpotDataI(const Json::Value &request, Json::Value &response)
         {
             (void)request;
@@ -82,6 +87,7 @@ class AbstractPvlogServer : public jsonrpc::AbstractServer<AbstractPvlogServer>
             response = this->getEvents();
         }
         virtual Json::Value getSpotData(const std::string& date) = 0;
+        virtual Json::Value getSpotDataRange(const std::string& from, const std::string& method, int points, const std::string& to) = 0;
         virtual Json::Value getLiveSpotData() = 0;
         virtual Json::Value getDataloggerStatus() = 0;
         virtual Json::Value getDayData(const std::string& from, const std::string& to) = 0;
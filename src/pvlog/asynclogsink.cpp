@@ -0,0 +1,214 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "asynclogsink.h"
+
+#include <cstdint>
+#include <iostream>
+
+#include <boost/log/trivial.hpp>
+#include <boost/log/utility/formatting_ostream.hpp>
+
+#include "metrics.h"
+#include "pvlogexception.h"
+
+namespace btlog = boost::log;
+namespace bttrivial = boost::log::trivial;
+
+static std::size_t roundUpPowerOfTwo(std::size_t size) {
+	std::size_t result = 2;
+	while (result < size) {
+		result <<= 1;
+	}
+	return result;
+}
+
+AsyncLogSink::AsyncLogSink(const std::string& file, btlog::formatter formatter, std::size_t queueSize,
+		std::chrono::milliseconds flushInterval) :
+		sink(true),
+		formatter(formatter),
+		out(&std::clog),
+		flushInterval(flushInterval),
+		cells(roundUpPowerOfTwo(queueSize)),
+		mask(cells.size() - 1),
+		enqueuePos(0),
+		dequeuePos(0),
+		droppedRecords(0),
+		reportedDrops(0),
+		droppedCounter(MetricsRegistry::instance().counter("pvlog_log_records_dropped_total",
+				"Log records dropped because the asynchronous log queue was full")),
+		stopped(false),
+		wakeRequested(false),
+		flushRequests(0),
+		flushes(0) {
+	if (!file.empty()) {
+		this->file.reset(new std::ofstream(file, std::ios_base::out | std::ios_base::trunc));
+		if (!*this->file) {
+			PVLOG_EXCEPT("Could not open log file " + file);
+		}
+		out = this->file.get();
+	}
+
+	for (std::size_t i = 0; i < cells.size(); ++i) {
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	worker = std::thread(&AsyncLogSink::work, this);
+}
+
+AsyncLogSink::~AsyncLogSink() {
+	stop();
+}
+
+bool AsyncLogSink::will_consume(const btlog::attribute_value_set&) {
+	//records are filtered by the core
+	return true;
+}
+
+void AsyncLogSink::consume(const btlog::record_view& record) {
+	try_consume(record);
+}
+
+bool AsyncLogSink::try_consume(const btlog::record_view& record) {
+	std::size_t pos;
+	if (!push(record, pos)) {
+		droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	//the queue is drained at the latest every half queue, errors are written at once
+	auto severity = record[bttrivial::severity];
+	if ((pos & (mask >> 1)) == 0 || (severity && severity.get() >= bttrivial::error)) {
+		wake();
+	}
+	return true;
+}
+
+bool AsyncLogSink::push(const btlog::record_view& record, std::size_t& pos) {
+	pos = enqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		Cell& cell = cells[pos & mask];
+		std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0) {
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell.record = record;
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool AsyncLogSink::pop(btlog::record_view& record) {
+	Cell& cell = cells[dequeuePos & mask];
+	if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+		return false;
+	}
+
+	record = cell.record;
+	cell.record.reset();
+	cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+	++dequeuePos;
+	return true;
+}
+
+void AsyncLogSink::wake() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		wakeRequested = true;
+	}
+	wakeUp.notify_one();
+}
+
+void AsyncLogSink::flush() {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (stopped) {
+		return;
+	}
+
+	uint64_t request = ++flushRequests;
+	wakeUp.notify_one();
+	flushed.wait(lock, [&]() { return flushes >= request; });
+}
+
+void AsyncLogSink::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopped) {
+			return;
+		}
+		stopped = true;
+	}
+	wakeUp.notify_one();
+	worker.join();
+}
+
+void AsyncLogSink::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		wakeUp.wait_for(lock, flushInterval, [this]() {
+			return stopped || wakeRequested || flushRequests != flushes;
+		});
+		wakeRequested = false;
+		bool stop = stopped;
+		uint64_t requests = flushRequests;
+
+		lock.unlock();
+		write();
+		lock.lock();
+
+		flushes = requests;
+		flushed.notify_all();
+		if (stop) {
+			break;
+		}
+	}
+}
+
+void AsyncLogSink::write() {
+	batch.clear();
+	btlog::formatting_ostream stream(batch);
+
+	//at most one queue of records, so a flood of records can not starve flush requests
+	btlog::record_view record;
+	for (std::size_t i = 0; i < cells.size() && pop(record); ++i) {
+		formatter(record, stream);
+		stream << '\n';
+	}
+	record.reset();
+
+	uint64_t drops = droppedRecords.load(std::memory_order_relaxed);
+	if (drops != reportedDrops) {
+		stream << "Log queue full, dropped " << drops - reportedDrops << " log records\n";
+		droppedCounter.inc(drops - reportedDrops);
+		reportedDrops = drops;
+	}
+	stream.flush();
+
+	if (!batch.empty()) {
+		out->write(batch.data(), batch.size());
+		out->flush();
+	}
+}
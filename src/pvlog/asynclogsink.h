@@ -0,0 +1,124 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SRC_PVLOG_ASYNCLOGSINK_H_
+#define SRC_PVLOG_ASYNCLOGSINK_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/log/core/record_view.hpp>
+#include <boost/log/expressions/formatter.hpp>
+#include <boost/log/sinks/sink.hpp>
+
+#include "utility.h"
+
+class Counter;
+
+/**
+ * Log sink formatting and writing records in a background thread.
+ *
+ * Logging threads only put the record into a bounded lock-free queue, records
+ * not fitting into the queue are dropped and counted. The background thread
+ * wakes up every flushInterval, or when the queue is half full or an error was
+ * logged, and writes all queued records with a single write and flush.
+ */
+class AsyncLogSink: public boost::log::sinks::sink {
+	DISABLE_COPY(AsyncLogSink)
+public:
+	/**
+	 * Write to file, to std::clog if file is empty. queueSize is rounded up
+	 * to a power of two.
+	 */
+	AsyncLogSink(const std::string& file, boost::log::formatter formatter, std::size_t queueSize,
+			std::chrono::milliseconds flushInterval);
+
+	virtual ~AsyncLogSink();
+
+	virtual bool will_consume(const boost::log::attribute_value_set& attributes) override;
+
+	virtual void consume(const boost::log::record_view& record) override;
+
+	virtual bool try_consume(const boost::log::record_view& record) override;
+
+	/**
+	 * Write all records queued so far.
+	 */
+	virtual void flush() override;
+
+	/**
+	 * Write remaining records and stop the background thread.
+	 */
+	void stop();
+
+	uint64_t dropped() const {
+		return droppedRecords.load(std::memory_order_relaxed);
+	}
+
+private:
+	//bounded multi producer queue, see Dmitry Vyukov's bounded MPMC queue
+	struct Cell {
+		std::atomic<std::size_t> sequence;
+		boost::log::record_view record;
+	};
+
+	/**
+	 * Returns false if the queue is full, pos is the queue position of record.
+	 */
+	bool push(const boost::log::record_view& record, std::size_t& pos);
+	bool pop(boost::log::record_view& record);
+
+	void wake();
+	void work();
+	void write();
+
+	boost::log::formatter formatter;
+	std::unique_ptr<std::ofstream> file;
+	std::ostream* out;
+	const std::chrono::milliseconds flushInterval;
+
+	std::vector<Cell> cells;
+	const std::size_t mask;
+	std::atomic<std::size_t> enqueuePos;
+	std::size_t dequeuePos;
+	std::atomic<uint64_t> droppedRecords;
+	uint64_t reportedDrops;
+	Counter& droppedCounter;
+	std::string batch;
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::condition_variable flushed;
+	bool stopped;
+	bool wakeRequested;
+	uint64_t flushRequests;
+	uint64_t flushes;
+	std::thread worker;
+};
+
+#endif /* SRC_PVLOG_ASYNCLOGSINK_H_ */
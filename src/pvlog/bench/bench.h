@@ -0,0 +1,82 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_BENCH_BENCH_H_
+#define SRC_PVLOG_BENCH_BENCH_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/**
+ * Options shared by all benchmarks of pvlog-bench.
+ */
+struct BenchOptions {
+	std::string directory; //databases are created here
+	std::string config;    //pvlog config file, pvoutput settings of the pvoutput benchmark
+	int days;
+	int inverters;
+	int repeat;
+};
+
+/**
+ * Write and read throughput of spot data with the sqlite defaults and the
+ * journal modes and synchronous settings of SqliteProfile.
+ */
+void benchSqliteProfile(const BenchOptions& options);
+
+/**
+ * Latency, allocations and peak memory of the spot data rpc methods on generated
+ * data, through the json-rpc-cpp handlers and the streaming serializedResult,
+ * and of getEvents pages.
+ */
+void benchSpotData(const BenchOptions& options);
+
+/**
+ * Upload generated live data with PvoutputUploader to pvoutput_host and pvoutput_port
+ * of the config file, usually tools/pvoutput-server.py. Refuses to upload to pvoutput.org.
+ */
+void benchPvoutput(const BenchOptions& options);
+
+/**
+ * Allocations with operator new since the last resetHeapStats, counted
+ * by the operator new replaced in heapstats.cpp. Allocations of sqlite
+ * use malloc and are not counted.
+ */
+struct HeapStats {
+	std::size_t allocations;
+	std::size_t peakBytes; //highest number of bytes in use above those in use at reset
+};
+
+void resetHeapStats();
+
+HeapStats heapStats();
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void removeDatabase(const std::string& file) {
+	for (const char* suffix : { "", "-journal", "-wal", "-shm" }) {
+		std::remove((file + suffix).c_str());
+	}
+}
+
+#endif /* SRC_PVLOG_BENCH_BENCH_H_ */
@@ -0,0 +1,103 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <boost/log/attributes/mutable_constant.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include "bench.h"
+
+namespace btlog = boost::log;
+namespace btattrs = boost::log::attributes;
+namespace bttrivial = boost::log::trivial;
+namespace po = boost::program_options;
+
+//attributes used by LOG, the benchmarks only print warnings and errors to the console
+static void initLogging() {
+	btlog::core::get()->add_global_attribute("Module",
+			btattrs::mutable_constant<const char *>("global"));
+	btlog::core::get()->add_global_attribute("File",
+			btattrs::mutable_constant<std::string> (""));
+	btlog::core::get()->add_global_attribute("Line",
+			btattrs::mutable_constant<int>(0));
+
+	btlog::core::get()->set_filter(bttrivial::severity >= bttrivial::warning);
+}
+
+int main(int argc, char** argv) {
+	std::string bench;
+	BenchOptions options;
+
+	po::options_description desc("Usage");
+	desc.add_options()
+			("help", "print help message")
+			("bench", po::value<std::string>(&bench)->default_value("sqlite-profile"),
+					"benchmark to run: sqlite-profile, spot-data, pvoutput")
+			("dir", po::value<std::string>(&options.directory)->default_value("."),
+					"directory the benchmark databases are created in, existing ones are replaced")
+			("config", po::value<std::string>(&options.config),
+					"pvlog config file with the pvoutput settings for the pvoutput benchmark")
+			("days", po::value<int>(&options.days)->default_value(30), "days of generated spot data")
+			("inverters", po::value<int>(&options.inverters)->default_value(2), "number of generated inverters")
+			("repeat", po::value<int>(&options.repeat)->default_value(3), "number of read passes");
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+	} catch (const po::error& ex) {
+		std::cerr << ex.what() << std::endl << desc << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (vm.count("help")) {
+		std::cout << desc << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	if (options.days < 1 || options.inverters < 1 || options.repeat < 1) {
+		std::cerr << "days, inverters and repeat have to be at least 1" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	initLogging();
+
+	try {
+		if (bench == "sqlite-profile") {
+			benchSqliteProfile(options);
+		} else if (bench == "spot-data") {
+			benchSpotData(options);
+		} else if (bench == "pvoutput") {
+			benchPvoutput(options);
+		} else {
+			std::cerr << "Unknown benchmark " << bench << std::endl << desc << std::endl;
+			return EXIT_FAILURE;
+		}
+	} catch (const std::exception& ex) {
+		std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
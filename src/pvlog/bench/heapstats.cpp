@@ -0,0 +1,83 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+#include "bench.h"
+
+namespace {
+
+std::atomic<std::size_t> allocations(0);
+std::atomic<std::size_t> bytesInUse(0);
+std::atomic<std::size_t> baseBytes(0);
+std::atomic<std::size_t> peakBytes(0);
+
+} //namespace {
+
+void* operator new(std::size_t size) {
+	void* p = std::malloc(size != 0 ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	++allocations;
+	std::size_t inUse = (bytesInUse += malloc_usable_size(p));
+	std::size_t peak  = peakBytes;
+	while (inUse > peak && !peakBytes.compare_exchange_weak(peak, inUse)) {
+		//peak is reloaded by compare_exchange_weak
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	if (p != nullptr) {
+		bytesInUse -= malloc_usable_size(p);
+		std::free(p);
+	}
+}
+
+//some standard libraries do not implement the nothrow versions with the replaceable ones
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	operator delete(p);
+}
+
+void resetHeapStats() {
+	allocations = 0;
+	baseBytes   = bytesInUse.load();
+	peakBytes   = baseBytes.load();
+}
+
+HeapStats heapStats() {
+	HeapStats stats;
+	stats.allocations = allocations;
+	stats.peakBytes   = peakBytes - baseBytes;
+	return stats;
+}
@@ -0,0 +1,159 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <odb/database.hxx>
+#include <odb/schema-catalog.hxx>
+#include <odb/transaction.hxx>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "bench.h"
+#include "configreader.h"
+#include "databasepool.h"
+#include "metrics.h"
+#include "pvlogexception.h"
+#include "pvoutputuploader.h"
+#include "sqliteprofile.h"
+#include "timeutil.h"
+
+#include "models/config.h"
+#include "models/config_odb.h"
+#include "models/spotdata.h"
+#include "models/upload.h"
+#include "models/upload_odb.h"
+
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+
+namespace {
+
+const int INTERVAL_MINUTES = 5;
+const int TIMEOUT_SECONDS  = 120;
+
+std::size_t outboxSize(odb::database* db) {
+	odb::transaction t(db->begin());
+	std::size_t count = db->query_value<model::UploadCount>().count;
+	t.commit();
+	return count;
+}
+
+//https request counters of HttpsSessionPool and failed uploads
+void printMetrics() {
+	std::string metrics;
+	MetricsRegistry::instance().writePrometheus(metrics);
+
+	std::istringstream lines(metrics);
+	std::string line;
+	while (std::getline(lines, line)) {
+		if (line.compare(0, 26, "pvlog_https_requests_total") == 0
+				|| line.compare(0, 27, "pvlog_upload_failures_total") == 0) {
+			std::cout << "  " << line << std::endl;
+		}
+	}
+}
+
+} //namespace {
+
+void benchPvoutput(const BenchOptions& options) {
+	if (options.config.empty()) {
+		PVLOG_EXCEPT("The pvoutput benchmark needs --config with pvoutput_host and pvoutput_port of a test "
+				"server, for example tools/pvoutput-server.py");
+	}
+
+	ConfigReader configReader(options.config);
+	configReader.parse();
+	PvoutputUploader::Settings settings = PvoutputUploader::Settings::read(configReader);
+
+	//generated data must never reach a real account
+	std::string host = settings.host;
+	std::transform(host.begin(), host.end(), host.begin(), [](unsigned char c) { return std::tolower(c); });
+	if (host == "pvoutput.org" || (host.size() > 13 && host.compare(host.size() - 13, 13, ".pvoutput.org") == 0)) {
+		PVLOG_EXCEPT("Refusing to upload generated data to " + settings.host + ", set pvoutput_host to a test server");
+	}
+
+	SqliteProfile profile;
+	profile.databaseName = options.directory + "/pvlog-bench-pvoutput.db";
+	removeDatabase(profile.databaseName);
+
+	{
+		DatabasePool databasePool(profile);
+		odb::database* db = databasePool.writer();
+		{
+			odb::transaction t(db->begin());
+			odb::schema_catalog::create_schema(*db, "", false);
+			model::Config systemId("pvoutputSystemId", "1");
+			model::Config apiKey("pvoutputApiKey", "pvlog-bench");
+			db->persist(systemId);
+			db->persist(apiKey);
+			t.commit();
+		}
+
+		//live data intervals up to now, older ones would be dropped by the uploader,
+		//at most as many as the hourly request quota uploads without waiting
+		int days = std::max(std::min(options.days, static_cast<int>(settings.maxAge.days()) - 1), 1);
+		int intervals = static_cast<int>(std::min<std::size_t>(days * 24 * 60 / INTERVAL_MINUTES,
+				settings.requestsPerHour * settings.batchSize));
+		pt::ptime last = util::roundDown(pt::second_clock::universal_time(), pt::minutes(INTERVAL_MINUTES));
+
+		std::cout << "Uploading " << intervals << " live data intervals to " << settings.host << ":"
+				<< settings.port << ", batch size " << settings.batchSize << ", batch delay "
+				<< settings.batchDelay.total_seconds() / 60 << " min, keep alive "
+				<< settings.keepAlive.total_seconds() << " s" << std::endl;
+
+		auto start = std::chrono::steady_clock::now();
+		std::size_t left;
+		{
+			PvoutputUploader uploader(db, settings);
+
+			for (int i = intervals - 1; i >= 0; --i) {
+				SpotData sd;
+				sd.time     = last - pt::minutes(i * INTERVAL_MINUTES);
+				sd.power    = 1000 + i % 4000;
+				sd.dayYield = i * 10;
+				uploader.uploadSpotData({ sd });
+			}
+			uploader.flush();
+
+			do {
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				left = outboxSize(db);
+			} while (left > 0 && elapsedMs(start) < TIMEOUT_SECONDS * 1000);
+		}
+
+		std::cout << std::fixed << std::setprecision(0) << intervals - left << " intervals uploaded in "
+				<< elapsedMs(start) << " ms, " << left << " left in the outbox" << std::endl;
+		printMetrics();
+
+		if (left > 0) {
+			PVLOG_EXCEPT("Outbox not empty after " + std::to_string(TIMEOUT_SECONDS) + " seconds");
+		}
+	}
+
+	removeDatabase(profile.databaseName);
+}
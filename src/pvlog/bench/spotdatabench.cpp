@@ -0,0 +1,322 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+#include <jsoncpp/json/writer.h>
+#include <jsonrpccpp/server/abstractserverconnector.h>
+#include <odb/database.hxx>
+#include <odb/schema-catalog.hxx>
+#include <odb/session.hxx>
+#include <odb/transaction.hxx>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "bench.h"
+#include "databasepool.h"
+#include "datalogger.h"
+#include "jsonrpcserver.h"
+#include "pvlogexception.h"
+#include "spotdataarchiver.h"
+#include "spotdatabuffer.h"
+#include "sqliteprofile.h"
+#include "timeutil.h"
+
+#include "models/event.h"
+#include "models/event_odb.h"
+#include "models/inverter.h"
+#include "models/inverter_odb.h"
+#include "models/plant.h"
+#include "models/plant_odb.h"
+#include "models/spotdata.h"
+#include "models/spotdata_odb.h"
+
+namespace bg = boost::gregorian;
+namespace pt = boost::posix_time;
+
+using model::Inverter;
+using model::InverterPtr;
+using model::Plant;
+using model::PlantPtr;
+using model::SpotData;
+
+namespace {
+
+//one sample every 5 minutes from 6:00 to 20:00, like the sqlite-profile benchmark
+const int INTERVAL        = 300;
+const int DAY_START       = 6 * 3600;
+const int SAMPLES_PER_DAY = 14 * 3600 / INTERVAL;
+const double PI           = 3.14159265358979323846;
+const int RANGE_POINTS    = 1000;
+const int EVENTS_PER_DAY  = 4;
+const int EVENT_PAGE_SIZE = 100;
+
+//the rpc server is called directly, it never listens
+class BenchConnector : public jsonrpc::AbstractServerConnector {
+public:
+	virtual bool StartListening() override {
+		return true;
+	}
+
+	virtual bool StopListening() override {
+		return true;
+	}
+};
+
+struct Measurement {
+	std::vector<double> times; //ms
+	std::size_t allocations;
+	std::size_t peakHeap;      //bytes
+	std::size_t peakSqlite;    //bytes
+	std::size_t bytes;         //serialized result
+
+	Measurement() : allocations(0), peakHeap(0), peakSqlite(0), bytes(0) {}
+};
+
+//call returns the size of the serialized result
+Measurement measure(const std::vector<std::string>& args, int repeat,
+		const std::function<std::size_t (const std::string&)>& call) {
+	Measurement m;
+	for (int r = 0; r < repeat; ++r) {
+		for (const std::string& arg : args) {
+			resetHeapStats();
+			sqlite3_memory_highwater(1);
+			int64_t sqliteBase = sqlite3_memory_used();
+
+			auto start = std::chrono::steady_clock::now();
+			m.bytes += call(arg);
+			m.times.push_back(elapsedMs(start));
+
+			HeapStats stats = heapStats();
+			m.allocations += stats.allocations;
+			m.peakHeap     = std::max(m.peakHeap, stats.peakBytes);
+			m.peakSqlite   = std::max(m.peakSqlite,
+					static_cast<std::size_t>(std::max<int64_t>(sqlite3_memory_highwater(0) - sqliteBase, 0)));
+		}
+	}
+	return m;
+}
+
+void print(const std::string& name, Measurement m) {
+	std::sort(m.times.begin(), m.times.end());
+	double sum = 0;
+	for (double t : m.times) {
+		sum += t;
+	}
+	std::size_t calls = m.times.size();
+
+	std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(8) << calls
+			<< std::setw(10) << sum / calls
+			<< std::setw(10) << m.times[std::min(calls - 1, calls * 99 / 100)]
+			<< std::setw(10) << m.times.back()
+			<< std::setw(12) << m.allocations / calls
+			<< std::setw(12) << m.peakHeap / 1024
+			<< std::setw(12) << m.peakSqlite / 1024
+			<< std::setw(10) << m.bytes / calls / 1024 << std::endl;
+}
+
+std::size_t serializedSize(const Json::Value& value) {
+	Json::FastWriter writer;
+	return writer.write(value).size();
+}
+
+std::size_t payloadSize(const PayloadPtr& payload) {
+	if (payload == nullptr) {
+		PVLOG_EXCEPT("No serialized result");
+	}
+	return payload->data.size();
+}
+
+//spot data and events of days ending yesterday, so all of them can be archived
+void generate(odb::database* db, const BenchOptions& options, bg::date first) {
+	PlantPtr plant = std::make_shared<Plant>("bench", "bluetooth", "smadata2plus", "", "");
+	std::vector<InverterPtr> inverters;
+	{
+		odb::transaction t(db->begin());
+		odb::schema_catalog::create_schema(*db, "", false);
+		db->persist(plant);
+		for (int i = 1; i <= options.inverters; ++i) {
+			InverterPtr inverter = std::make_shared<Inverter>(i, "inverter " + std::to_string(i), 5000, 3, 2);
+			inverter->plant = plant;
+			db->persist(inverter);
+			inverters.push_back(inverter);
+		}
+		t.commit();
+	}
+
+	for (int d = 0; d < options.days; ++d) {
+		pt::ptime dayStart = util::local_to_utc(pt::ptime(first + bg::days(d)));
+
+		odb::transaction t(db->begin());
+		for (const InverterPtr& inverter : inverters) {
+			int32_t dayYield = 0;
+			for (int s = 0; s < SAMPLES_PER_DAY; ++s) {
+				SpotData sd;
+				sd.inverter  = inverter;
+				sd.time      = dayStart + pt::seconds(DAY_START + s * INTERVAL);
+				sd.power     = static_cast<int32_t>(5000 * std::sin(PI * s / SAMPLES_PER_DAY));
+				dayYield    += sd.power / 12;
+				sd.dayYield  = dayYield;
+				sd.frequency = 50000;
+				for (int p = 1; p <= 3; ++p) {
+					sd.phases.emplace(p, model::Phase{sd.power / 3, 230000, sd.power * 1000 / 3 / 230});
+				}
+				for (int i = 1; i <= 2; ++i) {
+					sd.dcInputs.emplace(i, model::DcInput{sd.power / 2, 400000, sd.power * 1000 / 2 / 400});
+				}
+				db->persist(sd);
+			}
+			for (int e = 0; e < EVENTS_PER_DAY; ++e) {
+				model::Event event(inverter, dayStart + pt::seconds(DAY_START + e * 3600), 10000 + e,
+						"Event " + std::to_string(e));
+				db->persist(event);
+			}
+		}
+		t.commit();
+	}
+}
+
+void run(JsonRpcServer& server, const BenchOptions& options, bg::date first, bg::date last) {
+	std::vector<std::string> days;
+	for (bg::date d = first; d <= last; d += bg::days(1)) {
+		days.push_back(bg::to_iso_extended_string(d));
+	}
+	std::vector<std::string> range = { bg::to_iso_extended_string(first) };
+	std::string to = bg::to_iso_extended_string(last);
+
+	std::cout << std::left << std::setw(28) << "method" << std::right << std::setw(8) << "calls"
+			<< std::setw(10) << "avg ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms"
+			<< std::setw(12) << "allocs" << std::setw(12) << "heap KiB" << std::setw(12) << "sqlite KiB"
+			<< std::setw(10) << "out KiB" << std::endl;
+
+	print("getSpotData handler", measure(days, options.repeat, [&](const std::string& day) {
+		return serializedSize(server.getSpotData(day));
+	}));
+	print("getSpotData streamed", measure(days, options.repeat, [&](const std::string& day) {
+		Json::Value params;
+		params["date"] = day;
+		return payloadSize(server.serializedResult("getSpotData", params, ResponseEncoding::JSON));
+	}));
+	print("columnar json", measure(days, options.repeat, [&](const std::string& day) {
+		Json::Value params;
+		params["date"]   = day;
+		params["format"] = "columnar";
+		return payloadSize(server.serializedResult("getSpotData", params, ResponseEncoding::JSON));
+	}));
+	print("columnar msgpack", measure(days, options.repeat, [&](const std::string& day) {
+		Json::Value params;
+		params["date"]   = day;
+		params["format"] = "columnar";
+		return payloadSize(server.serializedResult("getSpotData", params, ResponseEncoding::MSGPACK));
+	}));
+	print("getSpotDataRange handler", measure(range, options.repeat, [&](const std::string& from) {
+		return serializedSize(server.getSpotDataRange(from, "lttb", RANGE_POINTS, to));
+	}));
+	print("getSpotDataRange streamed", measure(range, options.repeat, [&](const std::string& from) {
+		Json::Value params;
+		params["from"]   = from;
+		params["to"]     = to;
+		params["method"] = "lttb";
+		params["points"] = RANGE_POINTS;
+		return payloadSize(server.serializedResult("getSpotDataRange", params, ResponseEncoding::JSON));
+	}));
+}
+
+Json::Value eventPageParams(const std::string& cursor) {
+	Json::Value params;
+	params["limit"] = EVENT_PAGE_SIZE;
+	if (!cursor.empty()) {
+		params["cursor"] = cursor;
+	}
+	return params;
+}
+
+//getEventPage and visitSpotDataPower keep their query state in the request arena
+void runEvents(JsonRpcServer& server, const BenchOptions& options) {
+	//cursors of all pages, the first page has none
+	std::vector<std::string> cursors = { "" };
+	for (;;) {
+		Json::Value response;
+		server.getEventsI(eventPageParams(cursors.back()), response);
+		if (!response["cursor"].isString()) {
+			break;
+		}
+		cursors.push_back(response["cursor"].asString());
+	}
+
+	print("getEvents page", measure(cursors, options.repeat, [&](const std::string& cursor) {
+		Json::Value response;
+		server.getEventsI(eventPageParams(cursor), response);
+		return serializedSize(response);
+	}));
+	print("getEvents all", measure({ "" }, options.repeat, [&](const std::string&) {
+		return serializedSize(server.getEvents());
+	}));
+}
+
+} //namespace {
+
+void benchSpotData(const BenchOptions& options) {
+	SqliteProfile profile;
+	profile.databaseName = options.directory + "/pvlog-bench-spotdata.db";
+	removeDatabase(profile.databaseName);
+
+	bg::date last  = bg::day_clock::local_day() - bg::days(1);
+	bg::date first = last - bg::days(options.days - 1);
+
+	{
+		DatabasePool databasePool(profile);
+
+		auto start = std::chrono::steady_clock::now();
+		generate(databasePool.writer(), options, first);
+		std::cout << options.days << " days, " << options.inverters << " inverters, " << SAMPLES_PER_DAY
+				<< " samples per day and inverter, generated in " << std::setprecision(0) << std::fixed
+				<< elapsedMs(start) << " ms" << std::endl;
+
+		//the response cache is disabled, every call reads the database, results are not compressed
+		SpotDataBuffer spotDataBuffer(databasePool.writer(), SpotDataBuffer::Settings());
+		Datalogger datalogger(databasePool.writer(), &spotDataBuffer);
+		BenchConnector connector;
+		JsonRpcServer server(connector, &datalogger, databasePool.reader(), 0,
+				std::numeric_limits<std::size_t>::max(), nullptr);
+
+		std::cout << "spot data rows:" << std::endl;
+		run(server, options, first, last);
+		runEvents(server, options);
+
+		start = std::chrono::steady_clock::now();
+		SpotDataArchiver(databasePool.writer(), 1).archive();
+		std::cout << "archived in " << std::setprecision(0) << elapsedMs(start) << " ms:" << std::endl;
+		run(server, options, first, last);
+	}
+
+	removeDatabase(profile.databaseName);
+}
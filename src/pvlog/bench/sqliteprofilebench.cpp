@@ -0,0 +1,325 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <sqlite3.h>
+
+#include "bench.h"
+#include "pvlogexception.h"
+#include "sqliteprofile.h"
+#include "utility.h"
+
+namespace {
+
+//one sample every 5 minutes from 6:00 to 20:00
+const int64_t INTERVAL       = 300;
+const int64_t DAY_START      = 6 * 3600;
+const int SAMPLES_PER_DAY    = 14 * 3600 / INTERVAL;
+const int64_t FIRST_DAY      = 1704067200; //2024-01-01
+const int PHASES             = 3;
+const int DC_INPUTS          = 2;
+const double PI             = 3.14159265358979323846;
+
+//layout of the odb schema of SpotData
+const char* SCHEMA =
+		"CREATE TABLE spot_data (id INTEGER PRIMARY KEY AUTOINCREMENT, inverter INTEGER NOT NULL, "
+		"time INTEGER, power INTEGER NOT NULL, dayYield INTEGER NULL, frequency INTEGER NULL);"
+		"CREATE INDEX spot_data_time_i ON spot_data (time);"
+		"CREATE TABLE phase (id INTEGER NOT NULL, phase INTEGER NOT NULL, power INTEGER NOT NULL, "
+		"voltage INTEGER NULL, current INTEGER NULL);"
+		"CREATE INDEX phase_id_i ON phase (id);"
+		"CREATE TABLE dc_input (id INTEGER NOT NULL, input INTEGER NOT NULL, power INTEGER NOT NULL, "
+		"voltage INTEGER NULL, current INTEGER NULL);"
+		"CREATE INDEX dc_input_id_i ON dc_input (id);";
+
+//same query as the spot data of a day read by JsonRpcServer
+const char* READ_DAY =
+		"SELECT s.id, s.inverter, s.time, s.power, s.dayYield, s.frequency FROM spot_data s "
+		"WHERE s.time >= ?1 AND s.time < ?2 ORDER BY s.inverter, s.time";
+const char* READ_PHASES = "SELECT phase, power, voltage, current FROM phase WHERE id = ?1";
+const char* READ_DC_INPUTS = "SELECT input, power, voltage, current FROM dc_input WHERE id = ?1";
+
+struct Profile {
+	const char* journalMode;
+	const char* synchronous;
+	const char* description;
+};
+
+const Profile PROFILES[] = {
+	{ "DELETE", "FULL",   "sqlite defaults" },
+	{ "WAL",    "FULL",   "" },
+	{ "WAL",    "NORMAL", "SqliteProfile default" },
+};
+
+struct Result {
+	double writesPerSecond;   //transactions, one sample of one inverter each
+	double rowsPerSecond;     //spot data rows read with phases and dc inputs
+	double concurrentWritesPerSecond; //while reading
+	double readsDuringWrites; //day reads per second while writing
+	double maxReadMs;         //longest day read while writing
+};
+
+void check(sqlite3* db, int rc) {
+	if (rc != SQLITE_OK && rc != SQLITE_ROW && rc != SQLITE_DONE) {
+		PVLOG_EXCEPT(std::string("sqlite error: ") + sqlite3_errmsg(db));
+	}
+}
+
+class Connection {
+	DISABLE_COPY(Connection)
+public:
+	Connection(const std::string& file, const SqliteProfile& profile, bool readOnly) : db(nullptr) {
+		int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+		if (sqlite3_open_v2(file.c_str(), &db, flags | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+			std::string error = sqlite3_errmsg(db);
+			sqlite3_close(db);
+			PVLOG_EXCEPT("Opening " + file + " failed: " + error);
+		}
+		sqlite3_busy_timeout(db, 10000);
+		profile.apply(db, readOnly);
+	}
+
+	~Connection() {
+		sqlite3_close(db);
+	}
+
+	void exec(const char* sql) {
+		check(db, sqlite3_exec(db, sql, nullptr, nullptr, nullptr));
+	}
+
+	sqlite3* db;
+};
+
+class Statement {
+	DISABLE_COPY(Statement)
+public:
+	Statement(Connection& connection, const char* sql) : db(connection.db), stmt(nullptr) {
+		check(db, sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr));
+	}
+
+	~Statement() {
+		sqlite3_finalize(stmt);
+	}
+
+	Statement& bind(int index, int64_t value) {
+		check(db, sqlite3_bind_int64(stmt, index, value));
+		return *this;
+	}
+
+	bool step() {
+		int rc = sqlite3_step(stmt);
+		check(db, rc);
+		return rc == SQLITE_ROW;
+	}
+
+	int64_t column(int index) {
+		return sqlite3_column_int64(stmt, index);
+	}
+
+	void reset() {
+		sqlite3_reset(stmt);
+	}
+
+private:
+	sqlite3* db;
+	sqlite3_stmt* stmt;
+};
+
+//spot data of one day with its phases and dc inputs, returns the number of spot data rows
+std::size_t readDay(Statement& day, Statement& phases, Statement& dcInputs, int64_t begin) {
+	std::size_t rows = 0;
+	int64_t sum = 0;
+
+	day.bind(1, begin).bind(2, begin + 24 * 3600);
+	while (day.step()) {
+		int64_t id = day.column(0);
+		sum += day.column(3);
+		for (Statement* values : { &phases, &dcInputs }) {
+			values->bind(1, id);
+			while (values->step()) {
+				sum += values->column(1);
+			}
+			values->reset();
+		}
+		++rows;
+	}
+	day.reset();
+
+	//keeps the column reads from being optimized out
+	if (sum < 0) {
+		PVLOG_EXCEPT("Negative power");
+	}
+	return rows;
+}
+
+//inserts days of samples, one transaction per inverter and sample like the datalogger without write buffer
+class Writer {
+	DISABLE_COPY(Writer)
+public:
+	Writer(Connection& connection, int inverters) :
+			connection(connection),
+			inverters(inverters),
+			insertSpotData(connection, "INSERT INTO spot_data (inverter, time, power, dayYield, frequency) "
+					"VALUES (?1, ?2, ?3, ?4, 50000)"),
+			insertPhase(connection, "INSERT INTO phase (id, phase, power, voltage, current) "
+					"VALUES (?1, ?2, ?3, 230000, ?4)"),
+			insertDcInput(connection, "INSERT INTO dc_input (id, input, power, voltage, current) "
+					"VALUES (?1, ?2, ?3, 400000, ?4)") {
+		//nothing to do
+	}
+
+	void writeDay(int64_t day) {
+		for (int s = 0; s < SAMPLES_PER_DAY; ++s) {
+			int64_t time  = day + DAY_START + s * INTERVAL;
+			int64_t power = static_cast<int64_t>(5000 * std::sin(PI * s / SAMPLES_PER_DAY));
+			for (int inverter = 1; inverter <= inverters; ++inverter) {
+				connection.exec("BEGIN");
+				insertSpotData.bind(1, inverter).bind(2, time).bind(3, power).bind(4, power * s / 12);
+				insertSpotData.step();
+				insertSpotData.reset();
+				int64_t id = sqlite3_last_insert_rowid(connection.db);
+				for (int p = 1; p <= PHASES; ++p) {
+					insertPhase.bind(1, id).bind(2, p).bind(3, power / PHASES).bind(4, power * 1000 / PHASES / 230);
+					insertPhase.step();
+					insertPhase.reset();
+				}
+				for (int i = 1; i <= DC_INPUTS; ++i) {
+					insertDcInput.bind(1, id).bind(2, i).bind(3, power / DC_INPUTS)
+							.bind(4, power * 1000 / DC_INPUTS / 400);
+					insertDcInput.step();
+					insertDcInput.reset();
+				}
+				connection.exec("COMMIT");
+			}
+		}
+	}
+
+private:
+	Connection& connection;
+	int inverters;
+	Statement insertSpotData;
+	Statement insertPhase;
+	Statement insertDcInput;
+};
+
+Result run(const BenchOptions& options, const Profile& profileSettings) {
+	SqliteProfile profile;
+	profile.databaseName = options.directory + "/pvlog-bench-" + profileSettings.journalMode + "-"
+			+ profileSettings.synchronous + ".db";
+	profile.journalMode  = profileSettings.journalMode;
+	profile.synchronous  = profileSettings.synchronous;
+	removeDatabase(profile.databaseName);
+
+	Result result;
+	Connection connection(profile.databaseName, profile, false);
+	connection.exec(SCHEMA);
+	Writer writer(connection, options.inverters);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int d = 0; d < options.days; ++d) {
+		writer.writeDay(FIRST_DAY + d * 24 * 3600);
+	}
+	result.writesPerSecond = 1000.0 * options.days * SAMPLES_PER_DAY * options.inverters / elapsedMs(start);
+
+	//all days, with a read only connection like the rpc server
+	{
+		Connection reader(profile.databaseName, profile, true);
+		Statement day(reader, READ_DAY);
+		Statement phases(reader, READ_PHASES);
+		Statement dcInputs(reader, READ_DC_INPUTS);
+		std::size_t rows = 0;
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < options.repeat; ++r) {
+			for (int d = 0; d < options.days; ++d) {
+				rows += readDay(day, phases, dcInputs, FIRST_DAY + d * 24 * 3600);
+			}
+		}
+		result.rowsPerSecond = 1000.0 * rows / elapsedMs(start);
+	}
+
+	//another week is written while the day being written is read, like the web interface polling today
+	const int concurrentDays = 7;
+	std::atomic<int64_t> today(FIRST_DAY + options.days * 24 * 3600);
+	std::atomic<bool> done(false);
+	std::size_t reads = 0;
+	result.maxReadMs = 0;
+	std::thread readerThread([&]() {
+		Connection reader(profile.databaseName, profile, true);
+		Statement day(reader, READ_DAY);
+		Statement phases(reader, READ_PHASES);
+		Statement dcInputs(reader, READ_DC_INPUTS);
+		while (!done) {
+			auto readStart = std::chrono::steady_clock::now();
+			readDay(day, phases, dcInputs, today);
+			result.maxReadMs = std::max(result.maxReadMs, elapsedMs(readStart));
+			++reads;
+		}
+	});
+
+	start = std::chrono::steady_clock::now();
+	try {
+		for (int d = 0; d < concurrentDays; ++d) {
+			writer.writeDay(today);
+			today += 24 * 3600;
+		}
+	} catch (...) {
+		done = true;
+		readerThread.join();
+		throw;
+	}
+	double writeMs = elapsedMs(start);
+	done = true;
+	readerThread.join();
+
+	result.concurrentWritesPerSecond = 1000.0 * concurrentDays * SAMPLES_PER_DAY * options.inverters / writeMs;
+	result.readsDuringWrites = 1000.0 * reads / writeMs;
+
+	removeDatabase(profile.databaseName);
+	return result;
+}
+
+} //namespace {
+
+void benchSqliteProfile(const BenchOptions& options) {
+	std::cout << options.days << " days, " << options.inverters << " inverters, " << SAMPLES_PER_DAY
+			<< " samples per day and inverter, " << options.repeat << " read passes" << std::endl;
+	std::cout << std::left << std::setw(16) << "profile" << std::right
+			<< std::setw(12) << "writes/s" << std::setw(14) << "rows read/s"
+			<< std::setw(18) << "writes/s (read)" << std::setw(18) << "reads/s (write)"
+			<< std::setw(14) << "max read ms" << std::endl;
+
+	for (const Profile& profile : PROFILES) {
+		Result result = run(options, profile);
+		std::cout << std::left << std::setw(16) << (std::string(profile.journalMode) + "/" + profile.synchronous)
+				<< std::right << std::fixed << std::setprecision(0)
+				<< std::setw(12) << result.writesPerSecond << std::setw(14) << result.rowsPerSecond
+				<< std::setw(18) << result.concurrentWritesPerSecond << std::setw(18) << result.readsDuringWrites
+				<< std::setprecision(2) << std::setw(14) << result.maxReadMs
+				<< "  " << profile.description << std::endl;
+	}
+}
@@ -0,0 +1,267 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <initializer_list>
+#include <sstream>
+
+#include <zlib.h>
+#ifdef PVLOG_ZSTD
+#include <zstd.h>
+#endif
+
+#include "pvlogexception.h"
+
+namespace {
+
+//cached payloads are compressed once, spend more time on them
+const int PRECOMPRESS_LEVEL = Z_BEST_COMPRESSION;
+const int RESPONSE_LEVEL    = Z_DEFAULT_COMPRESSION;
+#ifdef PVLOG_ZSTD
+const int ZSTD_PRECOMPRESS_LEVEL = 12;
+const int ZSTD_RESPONSE_LEVEL    = 3;
+#endif
+
+//deflate, fixed 32k window, no preset dictionary
+const unsigned char ZLIB_HEADER[] = { 0x78, 0x9c };
+const unsigned char GZIP_HEADER[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+
+class RawDeflater {
+public:
+	explicit RawDeflater(int level) {
+		stream.zalloc = Z_NULL;
+		stream.zfree  = Z_NULL;
+		stream.opaque = Z_NULL;
+		if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			PVLOG_EXCEPT("Error initializing deflate");
+		}
+	}
+
+	~RawDeflater() {
+		deflateEnd(&stream);
+	}
+
+	/**
+	 * Append compressed data to out. Z_SYNC_FLUSH ends the output byte aligned
+	 * without final block, Z_FINISH with final block.
+	 */
+	void deflate(const std::string& data, int flush, std::string& out) {
+		stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+		stream.avail_in = data.size();
+
+		int ret;
+		do {
+			std::size_t size = out.size();
+			std::size_t chunk = deflateBound(&stream, stream.avail_in) + 16;
+			out.resize(size + chunk);
+			stream.next_out  = reinterpret_cast<Bytef*>(&out[size]);
+			stream.avail_out = chunk;
+			ret = ::deflate(&stream, flush);
+			out.resize(size + chunk - stream.avail_out);
+			if (ret == Z_STREAM_ERROR) {
+				PVLOG_EXCEPT("Error compressing response");
+			}
+		} while (stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+	}
+
+private:
+	z_stream stream;
+};
+
+void appendLe32(std::string& out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<char>(value >> (8 * i)));
+	}
+}
+
+void appendBe32(std::string& out, uint32_t value) {
+	for (int i = 3; i >= 0; --i) {
+		out.push_back(static_cast<char>(value >> (8 * i)));
+	}
+}
+
+uint32_t crc32Of(uint32_t crc, const std::string& data) {
+	return crc32(crc, reinterpret_cast<const Bytef*>(data.data()), data.size());
+}
+
+uint32_t adler32Of(uint32_t adler, const std::string& data) {
+	return adler32(adler, reinterpret_cast<const Bytef*>(data.data()), data.size());
+}
+
+#ifdef PVLOG_ZSTD
+void appendZstd(const std::string& data, int level, std::string& out) {
+	std::size_t size = out.size();
+	out.resize(size + ZSTD_compressBound(data.size()));
+	std::size_t written = ZSTD_compress(&out[size], out.size() - size, data.data(), data.size(), level);
+	if (ZSTD_isError(written)) {
+		PVLOG_EXCEPT(std::string("Error compressing response: ") + ZSTD_getErrorName(written));
+	}
+	out.resize(size + written);
+}
+#endif
+
+std::string deflateResponse(ContentEncoding encoding, const std::string& head, const Payload* payload,
+		const std::string& tail) {
+	bool gzip = (encoding == ContentEncoding::GZIP);
+
+	std::string out;
+	if (gzip) {
+		out.assign(reinterpret_cast<const char*>(GZIP_HEADER), sizeof(GZIP_HEADER));
+	} else {
+		out.assign(reinterpret_cast<const char*>(ZLIB_HEADER), sizeof(ZLIB_HEADER));
+	}
+
+	uint32_t crc   = crc32Of(crc32(0, Z_NULL, 0), head);
+	uint32_t adler = adler32Of(adler32(0, Z_NULL, 0), head);
+	std::size_t size = head.size() + tail.size();
+
+	if (payload != nullptr && payload->precompressed) {
+		//the payload blocks do not reference data before them, every part is compressed on its own
+		RawDeflater(RESPONSE_LEVEL).deflate(head, Z_SYNC_FLUSH, out);
+		out += payload->deflate;
+		RawDeflater(RESPONSE_LEVEL).deflate(tail, Z_FINISH, out);
+
+		crc   = crc32_combine(crc, payload->crc32, payload->data.size());
+		adler = adler32_combine(adler, payload->adler32, payload->data.size());
+	} else {
+		RawDeflater deflater(RESPONSE_LEVEL);
+		deflater.deflate(head, Z_NO_FLUSH, out);
+		if (payload != nullptr) {
+			deflater.deflate(payload->data, Z_NO_FLUSH, out);
+			crc   = crc32Of(crc, payload->data);
+			adler = adler32Of(adler, payload->data);
+		}
+		deflater.deflate(tail, Z_FINISH, out);
+	}
+	crc   = crc32Of(crc, tail);
+	adler = adler32Of(adler, tail);
+
+	if (gzip) {
+		appendLe32(out, crc);
+		appendLe32(out, static_cast<uint32_t>(size + (payload != nullptr ? payload->data.size() : 0)));
+	} else {
+		appendBe32(out, adler);
+	}
+
+	return out;
+}
+
+} //namespace {
+
+ContentEncoding acceptedContentEncoding(const std::string& acceptEncoding) {
+	bool deflate = false;
+	bool gzip    = false;
+	bool zstd    = false;
+
+	std::istringstream codings(acceptEncoding);
+	std::string coding;
+	while (std::getline(codings, coding, ',')) {
+		std::string name = coding.substr(0, coding.find(';'));
+		name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+		std::size_t q = coding.find("q=");
+		if (q != std::string::npos && std::strtod(coding.c_str() + q + 2, nullptr) <= 0) {
+			continue;
+		}
+
+		deflate |= (name == "deflate");
+		gzip    |= (name == "gzip" || name == "x-gzip");
+		zstd    |= (name == "zstd");
+	}
+
+#ifdef PVLOG_ZSTD
+	if (zstd) {
+		return ContentEncoding::ZSTD;
+	}
+#else
+	(void)zstd;
+#endif
+	if (gzip) {
+		return ContentEncoding::GZIP;
+	} else if (deflate) {
+		return ContentEncoding::DEFLATE;
+	}
+	return ContentEncoding::IDENTITY;
+}
+
+const char* contentEncodingName(ContentEncoding encoding) {
+	switch (encoding) {
+	case ContentEncoding::DEFLATE:
+		return "deflate";
+	case ContentEncoding::GZIP:
+		return "gzip";
+	case ContentEncoding::ZSTD:
+		return "zstd";
+	default:
+		return "identity";
+	}
+}
+
+std::size_t Payload::bytes() const {
+	return data.size() + deflate.size() + zstd.size();
+}
+
+PayloadPtr makePayload(std::string data, bool precompress) {
+	std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+	payload->data          = std::move(data);
+	payload->precompressed = precompress;
+	payload->crc32         = 0;
+	payload->adler32       = 0;
+
+	if (precompress) {
+		RawDeflater(PRECOMPRESS_LEVEL).deflate(payload->data, Z_SYNC_FLUSH, payload->deflate);
+		payload->crc32   = crc32Of(crc32(0, Z_NULL, 0), payload->data);
+		payload->adler32 = adler32Of(adler32(0, Z_NULL, 0), payload->data);
+#ifdef PVLOG_ZSTD
+		appendZstd(payload->data, ZSTD_PRECOMPRESS_LEVEL, payload->zstd);
+#endif
+	}
+
+	return payload;
+}
+
+std::string compressResponse(ContentEncoding encoding, const std::string& head, const Payload* payload,
+		const std::string& tail) {
+	switch (encoding) {
+	case ContentEncoding::DEFLATE:
+	case ContentEncoding::GZIP:
+		return deflateResponse(encoding, head, payload, tail);
+#ifdef PVLOG_ZSTD
+	case ContentEncoding::ZSTD: {
+		//a zstd body may consist of several frames
+		std::string out;
+		if (payload != nullptr && payload->precompressed) {
+			appendZstd(head, ZSTD_RESPONSE_LEVEL, out);
+			out += payload->zstd;
+			appendZstd(tail, ZSTD_RESPONSE_LEVEL, out);
+		} else {
+			appendZstd(head + (payload != nullptr ? payload->data : std::string()) + tail, ZSTD_RESPONSE_LEVEL, out);
+		}
+		return out;
+	}
+#endif
+	default:
+		PVLOG_EXCEPT(std::string("Unsupported content encoding: ") + contentEncodingName(encoding));
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_COMPRESSION_H_
+#define SRC_PVLOG_COMPRESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * Http content encodings of responses. Zstd is only available if pvlog
+ * is built with libzstd (PVLOG_ZSTD).
+ */
+enum class ContentEncoding {
+	IDENTITY,
+	DEFLATE,
+	GZIP,
+	ZSTD
+};
+
+/**
+ * Preferred supported encoding of an Accept-Encoding header: zstd, gzip,
+ * deflate, identity. Encodings with q=0 are excluded.
+ */
+ContentEncoding acceptedContentEncoding(const std::string& acceptEncoding);
+
+/**
+ * Value of the Content-Encoding header.
+ */
+const char* contentEncodingName(ContentEncoding encoding);
+
+/**
+ * Serialized rpc result with its precompressed forms.
+ *
+ * The compressed forms can be spliced into a compressed response between
+ * the uncompressed envelope, so a result is compressed once however often
+ * it is sent.
+ */
+struct Payload {
+	std::string data;
+
+	bool precompressed;
+	std::string deflate; //raw deflate blocks, byte aligned and without final block
+	uint32_t crc32;      //of data, for the gzip trailer
+	uint32_t adler32;    //of data, for the zlib trailer
+	std::string zstd;    //zstd frame, empty without PVLOG_ZSTD
+
+	/**
+	 * Memory used by data and the compressed forms.
+	 */
+	std::size_t bytes() const;
+};
+
+using PayloadPtr = std::shared_ptr<const Payload>;
+
+/**
+ * Payload of data, precompressed if precompress is set.
+ */
+PayloadPtr makePayload(std::string data, bool precompress);
+
+/**
+ * Compress head, payload and tail as one response body. Precompressed
+ * payloads are copied, everything else is compressed. payload may be nullptr.
+ */
+std::string compressResponse(ContentEncoding encoding, const std::string& head, const Payload* payload,
+		const std::string& tail);
+
+#endif /* SRC_PVLOG_COMPRESSION_H_ */
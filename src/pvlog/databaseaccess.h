@@ -0,0 +1,31 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_DATABASEACCESS_H_
+#define SRC_PVLOG_DATABASEACCESS_H_
+
+/**
+ * Kind of database access a component needs.
+ */
+enum class DatabaseAccess {
+	READ,
+	WRITE
+};
+
+#endif /* SRC_PVLOG_DATABASEACCESS_H_ */
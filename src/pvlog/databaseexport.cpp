@@ -0,0 +1,634 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define PVLOG_LOG_MODULE "databaseexport"
+
+#include "databaseexport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <sqlite3.h>
+#include <odb/sqlite/database.hxx>
+
+#include "databasepool.h"
+#include "log.h"
+#include "pvlogexception.h"
+#include "spotdatacodec.h"
+
+namespace pt = boost::posix_time;
+
+namespace {
+
+struct Field {
+	std::string value;
+	bool quoted;
+};
+
+/**
+ * Merge an imported row into the existing row with the same sample columns,
+ * returns false if the existing row already contains it.
+ */
+using MergeFunction = bool (*)(sqlite3* handle, const std::vector<Field>& header,
+		const std::vector<Field>& fields, int64_t existingId);
+
+bool mergeArchive(sqlite3* handle, const std::vector<Field>& header, const std::vector<Field>& fields,
+		int64_t existingId);
+
+struct Table {
+	const char* name;
+	const char* keyColumns;    //duplicate check for tables without primary key
+	const char* sampleColumns; //duplicate check of measurements, their id may be taken by another row
+	const char* parent;        //table the id column refers to, reassigned ids are followed
+	MergeFunction merge;       //for rows holding several samples, nullptr skips existing rows
+};
+
+//in foreign key order
+const Table TABLES[] = {
+	{ "plant",             nullptr,    nullptr,                nullptr,     nullptr },
+	{ "inverter",          nullptr,    nullptr,                nullptr,     nullptr },
+	{ "spot_data",         nullptr,    "inverter,time",        nullptr,     nullptr },
+	{ "phase",             "id,phase", nullptr,                "spot_data", nullptr },
+	{ "dc_input",          "id,input", nullptr,                "spot_data", nullptr },
+	{ "day_data",          nullptr,    "inverter,date",        nullptr,     nullptr },
+	{ "event",             nullptr,    "inverter,time,number", nullptr,     nullptr },
+	{ "spot_data_archive", nullptr,    "inverter,date",        nullptr,     &mergeArchive }
+};
+
+const size_t WRITE_CHUNK_SIZE  = 64 * 1024;
+const int64_t IMPORT_CHUNK_ROWS = 50000;
+
+using Statement = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
+
+odb::sqlite::connection_ptr connection(odb::database* db) {
+	return static_cast<odb::sqlite::database*>(db)->connection();
+}
+
+void exec(sqlite3* handle, const std::string& sql) {
+	char* errorMsg = nullptr;
+	if (sqlite3_exec(handle, sql.c_str(), nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+		std::string error = errorMsg != nullptr ? errorMsg : "unknown error";
+		sqlite3_free(errorMsg);
+		PVLOG_EXCEPT("Executing " + sql + " failed: " + error);
+	}
+}
+
+Statement prepare(sqlite3* handle, const std::string& sql) {
+	sqlite3_stmt* stmt = nullptr;
+	if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+		PVLOG_EXCEPT("Preparing " + sql + " failed: " + sqlite3_errmsg(handle));
+	}
+	return Statement(stmt, &sqlite3_finalize);
+}
+
+std::unordered_set<std::string> tableColumns(sqlite3* handle, const std::string& table) {
+	std::unordered_set<std::string> columns;
+	Statement stmt = prepare(handle, "PRAGMA table_info(" + table + ")");
+	while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+		columns.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1)));
+	}
+	return columns;
+}
+
+void appendQuoted(std::string& out, const char* text, int size) {
+	out += '"';
+	for (int i = 0; i < size; ++i) {
+		if (text[i] == '"') {
+			out += '"';
+		}
+		out += text[i];
+	}
+	out += '"';
+}
+
+void appendValue(std::string& out, sqlite3_stmt* stmt, int column) {
+	static const char HEX[] = "0123456789abcdef";
+
+	switch (sqlite3_column_type(stmt, column)) {
+	case SQLITE_NULL:
+		break;
+	case SQLITE_INTEGER:
+		out += std::to_string(sqlite3_column_int64(stmt, column));
+		break;
+	case SQLITE_FLOAT: {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.17g", sqlite3_column_double(stmt, column));
+		out += buf;
+		break;
+	}
+	case SQLITE_BLOB: {
+		const unsigned char* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, column));
+		int size = sqlite3_column_bytes(stmt, column);
+		out += 'x';
+		for (int i = 0; i < size; ++i) {
+			out += HEX[blob[i] >> 4];
+			out += HEX[blob[i] & 0xf];
+		}
+		break;
+	}
+	default:
+		appendQuoted(out, reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)),
+				sqlite3_column_bytes(stmt, column));
+	}
+}
+
+//Read one CSV record, returns false at end of input
+bool readRecord(std::istream& in, std::vector<Field>& fields) {
+	fields.clear();
+
+	int c = in.get();
+	if (c == EOF) {
+		return false;
+	}
+
+	Field field{"", false};
+	bool inQuotes = false;
+	for (; c != EOF; c = in.get()) {
+		if (inQuotes) {
+			if (c == '"') {
+				if (in.peek() == '"') {
+					field.value += static_cast<char>(in.get());
+				} else {
+					inQuotes = false;
+				}
+			} else {
+				field.value += static_cast<char>(c);
+			}
+		} else if (c == '"') {
+			inQuotes     = true;
+			field.quoted = true;
+		} else if (c == ',') {
+			fields.push_back(std::move(field));
+			field = Field{"", false};
+		} else if (c == '\n') {
+			break;
+		} else if (c != '\r') {
+			field.value += static_cast<char>(c);
+		}
+	}
+
+	if (inQuotes) {
+		PVLOG_EXCEPT("Unterminated quoted field");
+	}
+	fields.push_back(std::move(field));
+
+	return true;
+}
+
+int hexDigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	PVLOG_EXCEPT("Invalid hex digit in blob");
+}
+
+//Blob of a field written as x followed by hex digits
+std::vector<char> blobValue(const Field& field) {
+	std::vector<char> blob;
+	blob.reserve(field.value.size() / 2);
+	for (size_t i = 1; i + 1 < field.value.size(); i += 2) {
+		blob.push_back(static_cast<char>(hexDigit(field.value[i]) << 4 | hexDigit(field.value[i + 1])));
+	}
+	return blob;
+}
+
+void bind(sqlite3_stmt* stmt, int index, const Field& field) {
+	int ret;
+	if (field.quoted) {
+		ret = sqlite3_bind_text(stmt, index, field.value.data(), field.value.size(), SQLITE_TRANSIENT);
+	} else if (field.value.empty()) {
+		ret = sqlite3_bind_null(stmt, index);
+	} else if (field.value[0] == 'x') {
+		std::vector<char> blob = blobValue(field);
+		ret = sqlite3_bind_blob(stmt, index, blob.data(), blob.size(), SQLITE_TRANSIENT);
+	} else if (field.value.find_first_of(".eE") != std::string::npos) {
+		ret = sqlite3_bind_double(stmt, index, std::stod(field.value));
+	} else {
+		ret = sqlite3_bind_int64(stmt, index, std::stoll(field.value));
+	}
+
+	if (ret != SQLITE_OK) {
+		PVLOG_EXCEPT("Binding value failed");
+	}
+}
+
+//Header indexes of the comma separated columns
+std::vector<size_t> columnIndexes(const Table& table, const std::vector<Field>& header, const std::string& columns) {
+	std::vector<size_t> indexes;
+	size_t pos = 0;
+	while (pos != std::string::npos) {
+		size_t next = columns.find(',', pos);
+		std::string column = columns.substr(pos, next == std::string::npos ? next : next - pos);
+		pos = next == std::string::npos ? next : next + 1;
+
+		size_t i = 0;
+		while (i < header.size() && header[i].value != column) {
+			++i;
+		}
+		if (i == header.size()) {
+			PVLOG_EXCEPT(std::string("Missing key column ") + column + " in " + table.name);
+		}
+		indexes.push_back(i);
+	}
+	return indexes;
+}
+
+//Condition on the columns with the values of the fields at indexes as parameters
+std::string keyCondition(const std::vector<Field>& header, const std::vector<size_t>& indexes) {
+	std::string condition;
+	for (size_t i : indexes) {
+		condition += (condition.empty() ? "" : " AND ") + header[i].value + " = ?" + std::to_string(i + 1);
+	}
+	return condition;
+}
+
+std::string insertStatement(const Table& table, const std::vector<Field>& header) {
+	std::string columns;
+	std::string params;
+	for (size_t i = 0; i < header.size(); ++i) {
+		columns += (i == 0 ? "" : ",") + header[i].value;
+		params  += (i == 0 ? "?" : ",?") + std::to_string(i + 1);
+	}
+
+	if (table.keyColumns == nullptr) {
+		return std::string("INSERT OR IGNORE INTO ") + table.name + " (" + columns + ") VALUES (" + params + ")";
+	}
+
+	std::string condition = keyCondition(header, columnIndexes(table, header, table.keyColumns));
+	return std::string("INSERT INTO ") + table.name + " (" + columns + ") SELECT " + params
+			+ " WHERE NOT EXISTS (SELECT 1 FROM " + table.name + " WHERE " + condition + ")";
+}
+
+//Statement selecting the id of the row with the values of the fields at indexes
+std::string selectIdStatement(const Table& table, const std::vector<Field>& header,
+		const std::vector<size_t>& indexes) {
+	return std::string("SELECT id FROM ") + table.name + " WHERE " + keyCondition(header, indexes) + " LIMIT 1";
+}
+
+bool selectId(sqlite3_stmt* stmt, const std::vector<size_t>& indexes, const std::vector<Field>& fields,
+		int64_t& id) {
+	sqlite3_reset(stmt);
+	for (size_t i : indexes) {
+		bind(stmt, i + 1, fields[i]);
+	}
+
+	int ret = sqlite3_step(stmt);
+	if (ret == SQLITE_ROW) {
+		id = sqlite3_column_int64(stmt, 0);
+		return true;
+	}
+	if (ret != SQLITE_DONE) {
+		PVLOG_EXCEPT(std::string("Selecting existing row failed: ") + sqlite3_errmsg(sqlite3_db_handle(stmt)));
+	}
+	return false;
+}
+
+//Decode the existing and the imported chunk of a day, the existing sample wins for the same time
+bool mergeArchive(sqlite3* handle, const std::vector<Field>& header, const std::vector<Field>& fields,
+		int64_t existingId) {
+	using model::SpotData;
+
+	size_t dataIndex = 0;
+	while (dataIndex < header.size() && header[dataIndex].value != "data") {
+		++dataIndex;
+	}
+	if (dataIndex == header.size()) {
+		PVLOG_EXCEPT("Missing column data in spot_data_archive");
+	}
+
+	Statement select = prepare(handle, "SELECT data FROM spot_data_archive WHERE id = ?1");
+	sqlite3_bind_int64(select.get(), 1, existingId);
+	if (sqlite3_step(select.get()) != SQLITE_ROW) {
+		PVLOG_EXCEPT(std::string("Reading archive chunk failed: ") + sqlite3_errmsg(handle));
+	}
+	const char* existingData = static_cast<const char*>(sqlite3_column_blob(select.get(), 0));
+	std::vector<char> existing(existingData, existingData + sqlite3_column_bytes(select.get(), 0));
+
+	std::vector<SpotData> spotDatas = decodeSpotData(existing, model::InverterPtr());
+	size_t existingCount = spotDatas.size();
+	for (SpotData& sd : decodeSpotData(blobValue(fields[dataIndex]), model::InverterPtr())) {
+		spotDatas.push_back(std::move(sd));
+	}
+	auto timeLess = [](const SpotData& a, const SpotData& b) {
+		return a.time < b.time;
+	};
+	std::stable_sort(spotDatas.begin(), spotDatas.end(), timeLess);
+	spotDatas.erase(std::unique(spotDatas.begin(), spotDatas.end(), [](const SpotData& a, const SpotData& b) {
+		return a.time == b.time;
+	}), spotDatas.end());
+
+	if (spotDatas.size() == existingCount) {
+		return false;
+	}
+
+	std::vector<char> data = encodeSpotData(spotDatas);
+	Statement update = prepare(handle, "UPDATE spot_data_archive SET first_time = ?1, last_time = ?2, "
+			"sample_count = ?3, data = ?4 WHERE id = ?5");
+	sqlite3_bind_int64(update.get(), 1, pt::to_time_t(spotDatas.front().time));
+	sqlite3_bind_int64(update.get(), 2, pt::to_time_t(spotDatas.back().time));
+	sqlite3_bind_int64(update.get(), 3, spotDatas.size());
+	sqlite3_bind_blob(update.get(), 4, data.data(), data.size(), SQLITE_TRANSIENT);
+	sqlite3_bind_int64(update.get(), 5, existingId);
+	if (sqlite3_step(update.get()) != SQLITE_DONE) {
+		PVLOG_EXCEPT(std::string("Updating archive chunk failed: ") + sqlite3_errmsg(handle));
+	}
+
+	return true;
+}
+
+const Table& findTable(const std::string& name) {
+	for (const Table& table : TABLES) {
+		if (name == table.name) {
+			return table;
+		}
+	}
+	PVLOG_EXCEPT("Unknown table " + name);
+}
+
+} //namespace {
+
+DatabaseExport::DatabaseExport(DatabasePool* databasePool) :
+		databasePool(databasePool) {
+	PVLOG_NOT_NULL(databasePool);
+}
+
+void DatabaseExport::backup(const std::string& file) {
+	LOG(Info) << "Backing up database to " << file;
+	auto start = std::chrono::steady_clock::now();
+
+	std::string tmpFile = file + ".tmp";
+	std::remove(tmpFile.c_str());
+
+	sqlite3* dest = nullptr;
+	if (sqlite3_open(tmpFile.c_str(), &dest) != SQLITE_OK) {
+		std::string error = dest != nullptr ? sqlite3_errmsg(dest) : "out of memory";
+		sqlite3_close(dest);
+		PVLOG_EXCEPT("Opening backup file " + tmpFile + " failed: " + error);
+	}
+	std::unique_ptr<sqlite3, decltype(&sqlite3_close)> destGuard(dest, &sqlite3_close);
+
+	//Copying all pages in one step keeps a single read snapshot, in WAL mode
+	//the writer is not blocked by it
+	odb::sqlite::connection_ptr source(connection(databasePool->reader()));
+	sqlite3_backup* backup = sqlite3_backup_init(dest, "main", source->handle(), "main");
+	if (backup == nullptr) {
+		PVLOG_EXCEPT(std::string("Starting backup failed: ") + sqlite3_errmsg(dest));
+	}
+	int ret = sqlite3_backup_step(backup, -1);
+	int pages = sqlite3_backup_pagecount(backup);
+	sqlite3_backup_finish(backup);
+
+	if (ret != SQLITE_DONE) {
+		PVLOG_EXCEPT(std::string("Backup failed: ") + sqlite3_errstr(ret));
+	}
+
+	destGuard.reset();
+	if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+		PVLOG_EXCEPT("Renaming backup file " + tmpFile + " failed");
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	LOG(Info) << "Backed up " << pages << " pages to " << file << " in " << duration.count() << "ms";
+}
+
+DatabaseExport::RowCounts DatabaseExport::exportCsv(const std::string& directory) {
+	LOG(Info) << "Exporting database to " << directory;
+
+	RowCounts rowCounts;
+
+	//One read transaction for all tables, so the export is a consistent snapshot
+	odb::sqlite::connection_ptr c(connection(databasePool->reader()));
+	exec(c->handle(), "BEGIN");
+	try {
+		for (const Table& table : TABLES) {
+			rowCounts[table.name] = exportTable(c->handle(), table.name, directory + "/" + table.name + ".csv");
+		}
+	} catch (...) {
+		sqlite3_exec(c->handle(), "ROLLBACK", nullptr, nullptr, nullptr);
+		throw;
+	}
+	exec(c->handle(), "COMMIT");
+
+	return rowCounts;
+}
+
+int64_t DatabaseExport::exportTable(sqlite3* handle, const std::string& table, const std::string& file) {
+	auto start = std::chrono::steady_clock::now();
+
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		PVLOG_EXCEPT("Could not open " + file);
+	}
+
+	Statement stmt = prepare(handle, "SELECT * FROM " + table + " ORDER BY rowid");
+	int columns = sqlite3_column_count(stmt.get());
+
+	std::string buf;
+	for (int i = 0; i < columns; ++i) {
+		buf += (i == 0 ? "" : ",");
+		buf += sqlite3_column_name(stmt.get(), i);
+	}
+	buf += '\n';
+
+	int64_t rows = 0;
+	int ret;
+	while ((ret = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+		for (int i = 0; i < columns; ++i) {
+			if (i != 0) {
+				buf += ',';
+			}
+			appendValue(buf, stmt.get(), i);
+		}
+		buf += '\n';
+		++rows;
+
+		if (buf.size() >= WRITE_CHUNK_SIZE) {
+			out.write(buf.data(), buf.size());
+			buf.clear();
+		}
+	}
+	if (ret != SQLITE_DONE) {
+		PVLOG_EXCEPT("Reading " + table + " failed: " + sqlite3_errmsg(handle));
+	}
+
+	out.write(buf.data(), buf.size());
+	out.close();
+	if (!out) {
+		PVLOG_EXCEPT("Writing " + file + " failed");
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	LOG(Info) << "Exported " << rows << " rows of " << table << " in " << duration.count() << "ms";
+
+	return rows;
+}
+
+DatabaseExport::RowCounts DatabaseExport::importCsv(const std::string& directory) {
+	LOG(Info) << "Importing database from " << directory;
+
+	RowCounts rowCounts;
+	std::map<std::string, IdMap> reassignedIds; //by table
+	for (const Table& table : TABLES) {
+		std::string file = directory + "/" + table.name + ".csv";
+		if (!std::ifstream(file)) {
+			LOG(Info) << "Skipping " << table.name << ", " << file << " does not exist";
+			continue;
+		}
+		const IdMap* parentIds = (table.parent != nullptr) ? &reassignedIds[table.parent] : nullptr;
+		rowCounts[table.name] = importTable(table.name, file, reassignedIds[table.name], parentIds);
+	}
+
+	importSig();
+
+	return rowCounts;
+}
+
+int64_t DatabaseExport::importTable(const std::string& tableName, const std::string& file, IdMap& ids,
+		const IdMap* parentIds) {
+	auto start = std::chrono::steady_clock::now();
+	const Table& table = findTable(tableName);
+
+	std::ifstream in(file, std::ios::binary);
+	std::vector<Field> header;
+	if (!readRecord(in, header)) {
+		PVLOG_EXCEPT("Missing header in " + file);
+	}
+
+	bool sample = (table.sampleColumns != nullptr);
+	std::vector<size_t> idIndexes;
+	std::vector<size_t> sampleIndexes;
+	if (sample || parentIds != nullptr) {
+		idIndexes = columnIndexes(table, header, "id");
+	}
+	if (sample) {
+		sampleIndexes = columnIndexes(table, header, table.sampleColumns);
+	}
+
+	int64_t rows       = 0;
+	int64_t inserted   = 0;
+	int64_t reassigned = 0;
+	int64_t merged     = 0;
+	std::vector<Field> fields;
+	bool done = false;
+	while (!done) {
+		//release the write connection between chunks, so the datalogger is not blocked
+		odb::sqlite::connection_ptr c(connection(databasePool->writer()));
+		sqlite3* handle = c->handle();
+
+		std::unordered_set<std::string> columns = tableColumns(handle, table.name);
+		for (const Field& column : header) {
+			if (column.quoted || columns.count(column.value) == 0) {
+				PVLOG_EXCEPT("Unknown column " + column.value + " in " + file);
+			}
+		}
+		Statement stmt = prepare(handle, insertStatement(table, header));
+		Statement selectSample(nullptr, &sqlite3_finalize);
+		Statement selectById(nullptr, &sqlite3_finalize);
+		if (sample) {
+			selectSample = prepare(handle, selectIdStatement(table, header, sampleIndexes));
+			selectById   = prepare(handle, selectIdStatement(table, header, idIndexes));
+		}
+
+		exec(handle, "BEGIN IMMEDIATE");
+		try {
+			int64_t chunkRows = 0;
+			while (chunkRows < IMPORT_CHUNK_ROWS) {
+				if (!readRecord(in, fields)) {
+					done = true;
+					break;
+				}
+				if (fields.size() == 1 && fields[0].value.empty() && !fields[0].quoted) {
+					continue; //empty line
+				}
+				if (fields.size() != header.size()) {
+					PVLOG_EXCEPT("Invalid number of fields in row " + std::to_string(rows + 1) + " of " + file);
+				}
+
+				++rows;
+				++chunkRows;
+
+				if (parentIds != nullptr) {
+					Field& parentId = fields[idIndexes.front()];
+					auto it = parentIds->find(std::stoll(parentId.value));
+					if (it != parentIds->end()) {
+						parentId.value = std::to_string(it->second);
+					}
+				}
+
+				//a measurement is identified by its inverter and time, not by its id: the
+				//database may have kept logging after the export and used the same ids
+				int64_t id = 0;
+				bool reassign = false;
+				if (sample) {
+					id = std::stoll(fields[idIndexes.front()].value);
+					int64_t existingId;
+					if (selectId(selectSample.get(), sampleIndexes, fields, existingId)) {
+						if (existingId != id) {
+							ids[id] = existingId;
+						}
+						if (table.merge != nullptr && table.merge(handle, header, fields, existingId)) {
+							++merged;
+						}
+						continue;
+					}
+					if (selectId(selectById.get(), idIndexes, fields, existingId)) {
+						fields[idIndexes.front()] = Field{"", false}; //NULL, a new id is assigned
+						reassign = true;
+					}
+				}
+
+				sqlite3_reset(stmt.get());
+				for (size_t i = 0; i < fields.size(); ++i) {
+					bind(stmt.get(), i + 1, fields[i]);
+				}
+				if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+					PVLOG_EXCEPT("Inserting into " + tableName + " failed: " + sqlite3_errmsg(handle));
+				}
+				inserted += sqlite3_changes(handle);
+
+				if (reassign) {
+					ids[id] = sqlite3_last_insert_rowid(handle);
+					++reassigned;
+				}
+			}
+			exec(handle, "COMMIT");
+		} catch (...) {
+			sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
+			throw;
+		}
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	LOG(Info) << "Imported " << inserted << " of " << rows << " rows into " << tableName
+			<< " in " << duration.count() << "ms";
+	if (reassigned > 0) {
+		LOG(Info) << "Assigned new ids to " << reassigned << " rows of " << tableName << ", their ids were taken";
+	}
+	if (merged > 0) {
+		LOG(Info) << "Merged " << merged << " rows into existing rows of " << tableName;
+	}
+
+	return inserted;
+}
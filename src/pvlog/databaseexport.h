@@ -0,0 +1,87 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_DATABASEEXPORT_H_
+#define SRC_PVLOG_DATABASEEXPORT_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include <boost/signals2.hpp>
+
+#include "utility.h"
+
+class DatabasePool;
+
+struct sqlite3;
+
+/**
+ * Online backup, export and import of the measurement tables.
+ *
+ * backup and exportCsv read from a single snapshot of a read only connection,
+ * so the datalogger keeps writing while they run. Tables are streamed row by
+ * row, memory usage does not depend on the size of the database.
+ *
+ * The CSV files contain a header with the column names. Text is quoted, NULL is
+ * an empty unquoted field and blobs are written as x followed by hex digits.
+ */
+class DatabaseExport {
+	DISABLE_COPY(DatabaseExport)
+public:
+	using RowCounts = std::map<std::string, int64_t>;
+
+	//emitted after rows were imported
+	boost::signals2::signal<void ()> importSig;
+
+	explicit DatabaseExport(DatabasePool* databasePool);
+
+	/**
+	 * Write a consistent copy of the database to file using the sqlite backup API.
+	 */
+	void backup(const std::string& file);
+
+	/**
+	 * Write one <table>.csv file per measurement table to directory.
+	 */
+	RowCounts exportCsv(const std::string& directory);
+
+	/**
+	 * Import files written by exportCsv. Rows already present are skipped.
+	 *
+	 * Plants and inverters are matched by id. Measurements are matched by inverter
+	 * and time (date for day data and archives, number for events), they keep their
+	 * id unless it is taken by another row. Phases and dc inputs follow the new id
+	 * of their spot data. An archive chunk of a day already archived is merged into
+	 * the existing chunk, samples of the same time are kept from the existing one.
+	 */
+	RowCounts importCsv(const std::string& directory);
+
+private:
+	int64_t exportTable(sqlite3* handle, const std::string& table, const std::string& file);
+
+	using IdMap = std::unordered_map<int64_t, int64_t>; //exported id to id in the database
+
+	int64_t importTable(const std::string& table, const std::string& file, IdMap& ids, const IdMap* parentIds);
+
+	DatabasePool* databasePool;
+};
+
+#endif /* SRC_PVLOG_DATABASEEXPORT_H_ */
@@ -0,0 +1,64 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "databasepool.h"
+
+#include <sqlite3.h>
+#include <odb/sqlite/database.hxx>
+
+#include "log.h"
+
+static std::unique_ptr<odb::database> openDatabase(const SqliteProfile& profile, bool readOnly,
+		std::size_t maxConnections) {
+	std::unique_ptr<odb::sqlite::connection_factory> factory(
+			new ProfiledConnectionFactory(profile, readOnly, maxConnections));
+	int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+	return std::unique_ptr<odb::database>(new odb::sqlite::database(profile.databaseName,
+			flags, true, "", std::move(factory)));
+}
+
+DatabasePool::DatabasePool(const SqliteProfile& profile) {
+	LOG(Info) << "Opening/creating database: " << profile.databaseName
+			<< " [journal_mode=" << profile.journalMode << ", synchronous=" << profile.synchronous
+			<< ", temp_store=" << profile.tempStore << ", mmap_size=" << profile.mmapSize
+			<< ", cache_size=" << profile.cacheSize << ", read_connections=" << profile.readConnections << "]";
+
+	//The writer has to be opened first, it creates the database file and enables WAL mode
+	writeDb = openDatabase(profile, false, 1);
+	readDb  = openDatabase(profile, true, profile.readConnections);
+}
+
+DatabasePool::~DatabasePool() {
+	//readers first, the last connection closing checkpoints the WAL file
+	readDb.reset();
+	writeDb.reset();
+}
+
+odb::database* DatabasePool::database(DatabaseAccess access) {
+	return access == DatabaseAccess::WRITE ? writer() : reader();
+}
+
+odb::database* DatabasePool::writer() {
+	return writeDb.get();
+}
+
+odb::database* DatabasePool::reader() {
+	return readDb.get();
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_DATABASEPOOL_H_
+#define SRC_PVLOG_DATABASEPOOL_H_
+
+#include <memory>
+
+#include "databaseaccess.h"
+#include "sqliteprofile.h"
+#include "utility.h"
+
+namespace odb {
+	class database;
+}
+
+/**
+ * Database connections shared by all components.
+ *
+ * There is exactly one read write connection, writers are serialized on it.
+ * Readers get one of profile.readConnections read only connections, which
+ * in WAL mode never wait for the writer.
+ */
+class DatabasePool {
+	DISABLE_COPY(DatabasePool)
+public:
+	explicit DatabasePool(const SqliteProfile& profile);
+
+	~DatabasePool();
+
+	odb::database* database(DatabaseAccess access);
+
+	/**
+	 * Database for component, which declares its access with
+	 * a static DATABASE_ACCESS member.
+	 */
+	template<typename Component>
+	odb::database* databaseFor() {
+		return database(Component::DATABASE_ACCESS);
+	}
+
+	odb::database* writer();
+
+	odb::database* reader();
+
+private:
+	std::unique_ptr<odb::database> writeDb;
+	std::unique_ptr<odb::database> readDb;
+};
+
+#endif /* SRC_PVLOG_DATABASEPOOL_H_ */
@@ -17,6 +17,7 @@
  * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -31,10 +32,12 @@
 
 #include "datalogger.h"
 #include "log.h"
+#include "metrics.h"
 #include "sunrisesunset.h"
 #include "timeutil.h"
 #include "utility.h"
 #include "pvlibhelper.h"
+#include "spotdatabuffer.h"
 
 #include "models/config.h"
 #include "models/configservice.h"
@@ -49,6 +52,7 @@
 #include "models/spotdata_odb.h"
 #include "models/inverter.h"
 #include "models/inverter_odb.h"
+#include "models/querycache.h"
 
 
 using model::Config;
@@ -83,6 +87,11 @@ namespace {
 
 const pt::ptime ARCHIVE_START = pt::from_iso_string("20000101T000000");
 
+//connect attempts of a plant: bluetooth connect, authentication and device discovery
+const std::chrono::minutes CONNECT_TIMEOUT(2);
+const std::chrono::seconds RETRY_MIN_DELAY(60);
+const std::chrono::seconds RETRY_MAX_DELAY(1800);
+
 //helper functions to test values for validity
 template<typename T>
 void setIfValid(T& s, T t) {
@@ -188,11 +197,16 @@ SpotData average(const std::vector<SpotData>& spotData) {
 } //namespace {
 
 static SpotData fillSpotData(const pvlib_ac* ac, const pvlib_dc* dc) {
+	static_assert(sizeof(pvlib_ac::power) / sizeof(pvlib_ac::power[0]) == model::MAX_PHASES,
+			"MAX_PHASES does not match pvlib");
+	static_assert(sizeof(pvlib_dc::power) / sizeof(pvlib_dc::power[0]) == model::MAX_DC_INPUTS,
+			"MAX_DC_INPUTS does not match pvlib");
+
 	SpotData spotData;
 
 	setIfValid(spotData.power, ac->totalPower);
 	setIfValid(spotData.frequency, ac->frequency);
-	for (int i = 0; i < ac->phaseNum; ++i) {
+	for (int i = 0; i < ac->phaseNum && i < static_cast<int>(model::MAX_PHASES); ++i) {
 		if (isValid(ac->power[i])) {
 			Phase phase;
 			setIfValid(phase.power, ac->power[i]);
@@ -203,7 +217,7 @@ static SpotData fillSpotData(const pvlib_ac* ac, const pvlib_dc* dc) {
 		}
 	}
 
-	for (int i = 0; i < dc->trackerNum; ++i) {
+	for (int i = 0; i < dc->trackerNum && i < static_cast<int>(model::MAX_DC_INPUTS); ++i) {
 		DcInput dcInput;
 		setIfValid(dcInput.power, dc->power[i]);
 		setIfValid(dcInput.voltage, dc->voltage[i]);
@@ -215,13 +229,32 @@ static SpotData fillSpotData(const pvlib_ac* ac, const pvlib_dc* dc) {
 	return spotData;
 }
 
+namespace {
+
+struct DayDataKey {
+	bg::date date;
+	int64_t inverterId;
+};
+
+struct EventKey {
+	pt::ptime time;
+	int64_t inverterId;
+};
+
+} //namespace {
+
 static void updateOrInsert(odb::database* db, DayData& dayData) {
 	using Query  = odb::query<DayData>;
 
-	Query query((Query::date == Query::_ref(dayData.date))
-			&& (Query::inverter == Query::_ref(dayData.inverter->id)));
+	DayDataKey* key;
+	odb::prepared_query<DayData> query(model::cachedQuery<DayData>("datalogger-day-data", key,
+			[](DayDataKey& k) {
+				return (Query::date == Query::_ref(k.date)) && (Query::inverter == Query::_ref(k.inverterId));
+			}));
+	key->date       = dayData.date;
+	key->inverterId = dayData.inverter->id;
 
-	std::shared_ptr<DayData> res(db->query_one<DayData>(query));
+	std::shared_ptr<DayData> res(query.execute_one());
 	if (res != nullptr) {
 		LOG(Info) << dayData.inverter->name << " Updated day yield "
 				<< res->dayYield << " -> " << dayData.dayYield;
@@ -236,10 +269,15 @@ static void updateOrInsert(odb::database* db, DayData& dayData) {
 static void updateOrInsert(odb::database* db, Event& event) {
 	using Query  = odb::query<Event>;
 
-	Query query((Query::time == Query::_ref(event.time))
-			&& (Query::inverter == Query::_ref(event.inverter->id)));
+	EventKey* key;
+	odb::prepared_query<Event> query(model::cachedQuery<Event>("datalogger-event", key,
+			[](EventKey& k) {
+				return (Query::time == Query::_ref(k.time)) && (Query::inverter == Query::_ref(k.inverterId));
+			}));
+	key->time       = event.time;
+	key->inverterId = event.inverter->id;
 
-	std::shared_ptr<Event> res(db->query_one<Event>(query));
+	std::shared_ptr<Event> res(query.execute_one());
 	if (res != nullptr) {
 		//nothing to do
 	} else {
@@ -249,7 +287,9 @@ static void updateOrInsert(odb::database* db, Event& event) {
 	}
 }
 
-static void saveDayArchiveData(odb::database* db, InverterPtr inv, pvlib_day_yield* dayYields, int num, pt::ptime readTime) {
+static std::vector<DayData> saveDayArchiveData(odb::database* db, InverterPtr inv, pvlib_day_yield* dayYields, int num,
+		pt::ptime readTime) {
+	std::vector<DayData> dayDatas;
 	odb::transaction t(db->begin());
 	for (int i = 0; i < num; ++i) {
 		pvlib_day_yield* dy = &dayYields[i];
@@ -262,11 +302,17 @@ static void saveDayArchiveData(odb::database* db, InverterPtr inv, pvlib_day_yie
 
 		LOG(Debug) << "Updating or inserting DayData " << dayData.date << " " << dayData.dayYield;
 		updateOrInsert(db, dayData);
+		dayDatas.push_back(dayData);
 	}
 
 	inv->dayArchiveLastRead = readTime;
 	db->update(inv);
-	t.commit();
+	{
+		Histogram::Timer timer(commitTimeHistogram("datalogger"));
+		t.commit();
+	}
+
+	return dayDatas;
 }
 
 static void saveEventArchiveData(odb::database* db, InverterPtr inv, pvlib_event* events, int num, pt::ptime readTime) {
@@ -279,13 +325,25 @@ static void saveEventArchiveData(odb::database* db, InverterPtr inv, pvlib_event
 
 	inv->eventArchiveLastRead = readTime;
 	db->update(inv);
-	t.commit();
+	{
+		Histogram::Timer timer(commitTimeHistogram("datalogger"));
+		t.commit();
+	}
+}
+
+template<typename F>
+static int timedRequest(Histogram& histogram, F request) {
+	Histogram::Timer timer(histogram);
+	return request();
 }
 
 static std::unordered_map<int64_t, SpotData> averageSpotData(const std::unordered_map<int64_t, std::vector<SpotData>>& curSpotDataList,
 		pt::time_duration timeout) {
 	std::unordered_map<int64_t, SpotData> spotDatas;
 	for (const auto& entry : curSpotDataList) {
+		if (entry.second.empty()) {
+			continue; //no samples of inverter in this interval
+		}
 		try {
 			SpotData averagedSpotData = average(entry.second);
 			averagedSpotData.time = util::roundUp(pt::second_clock::universal_time(), timeout);
@@ -335,36 +393,46 @@ void Datalogger::addDayYieldData(const Datalogger::Plants& plants,
 	}
 }
 
-Datalogger::Datalogger(odb::core::database* database) :
-		quit(false), active(false), dataloggerStatus(OK), db(database)
+Datalogger::Datalogger(odb::core::database* database, SpotDataBuffer* spotDataBuffer) :
+		quit(false), active(false), dataloggerStatus(STARTING), db(database), spotDataBuffer(spotDataBuffer),
+		cycleTime(MetricsRegistry::instance().histogram("pvlog_datalogger_cycle_duration_seconds",
+				"Time to read and log all open inverters")),
+		overruns(MetricsRegistry::instance().counter("pvlog_datalogger_overruns_total",
+				"Logging cycles finished after the start of the next cycle")),
+		created(std::chrono::steady_clock::now()),
+		firstSampleLogged(false),
+		archiveSynced(false)
 {
 	PVLOG_NOT_NULL(database);
+	PVLOG_NOT_NULL(spotDataBuffer);
 }
 
 Datalogger::~Datalogger() {
-	//nothing to do
+	abandonPendingPlants();
+	closeAbandonedConnections(true);
 }
 
 
-void Datalogger::openPlant(const Plant& plant) {
-	LOG(Info) << "Connecting plant " << plant.name << " ["
-			<< plant.connection << ", " << plant.protocol << "]";
-
-	pvlib_plant* pvlibPlant = nullptr;
+Datalogger::PlantConnection Datalogger::connect(const Plant& plant) {
+	PlantConnection connection;
+	connection.plant = connectPlant(plant.connection, plant.protocol, plant.connectionParam, plant.protocolParam);
 	try {
-		pvlibPlant = connectPlant(plant.connection, plant.protocol, plant.connectionParam, plant.protocolParam);
-	} catch (PvlogException& ex) {
-		std::string errorMsg = bt::str(bt::format("Error opening plant %1% %2%")
-				% plant.name % ex.what());
-		LOG(Error) << errorMsg;
-		errorSig(errorMsg);
-		return; //Ignore plant
+		connection.inverters = getInverters(connection.plant);
+	} catch (const PvlogException&) {
+		pvlib_close(connection.plant);
+		throw;
 	}
 
+	return connection;
+}
+
+void Datalogger::openPlant(const Plant& plant, const PlantConnection& connection) {
+	pvlib_plant* pvlibPlant = connection.plant;
+	Inverters availableInverterIds = connection.inverters;
+
 	LOG(Info) << "Successfully connected plant " << plant.name << " ["
 			<< plant.connectionParam << ", " << plant.protocolParam << "]";
 
-	Inverters availableInverterIds = getInverters(pvlibPlant);
 	LOG(Info) << "Available inverters: ";
 	for (int64_t id : availableInverterIds) {
 		LOG(Info) << id;
@@ -395,25 +463,125 @@ void Datalogger::openPlant(const Plant& plant) {
 	}
 
 	plants.emplace(pvlibPlant, availableInverterIds);
+	plantCounters[pvlibPlant] = PlantCounters{plant.name, pvlib_counters{0, 0}};
+	for (int64_t id : availableInverterIds) {
+		archiveQueue.emplace_back(pvlibPlant, id);
+	}
 
 	LOG(Info) << "Opened plant " << plant.name << " ["
 			<< plant.connection << ", " << plant.protocol << "]";
 }
 
 void Datalogger::openPlants() {
-	std::unordered_map<std::string, uint32_t> connections = getConnections();
-	std::unordered_map<std::string, uint32_t> protocols   = getProtocols();
-
 	odb::session s;
 	odb::transaction t (db->begin ());
 	odb::result<Plant> r  = db->query<Plant>();
 
+	auto now = std::chrono::steady_clock::now();
 	for (odb::result<Plant>::iterator it(r.begin()); it != r.end (); ++it) {
-		const Plant& plant = *it;
-		openPlant(plant);
-
+		pendingPlants.push_back(PendingPlant{*it, std::future<PlantConnection>(), std::future<PlantConnection>(),
+				now, now, RETRY_MIN_DELAY, 0});
 	}
 	t.commit();
+
+	connectPlants();
+}
+
+void Datalogger::connectPlants() {
+	auto now = std::chrono::steady_clock::now();
+	bool afterSunset = pt::second_clock::universal_time() >= sunset;
+
+	for (auto it = pendingPlants.begin(); it != pendingPlants.end(); ) {
+		PendingPlant& pending = *it;
+
+		if (!pending.connection.valid()) {
+			if (pending.abandoned.valid() &&
+					pending.abandoned.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				closeConnection(pending.abandoned);
+			}
+
+			if (pending.attempts > 0 && afterSunset) {
+				LOG(Info) << "Not retrying plant " << pending.plant.name << " after sunset";
+				if (pending.abandoned.valid()) {
+					abandonedConnections.push_back(std::move(pending.abandoned));
+				}
+				it = pendingPlants.erase(it);
+			} else {
+				//the retry of a plant with a running abandoned attempt starts when the attempt is closed
+				if (now >= pending.retry && !pending.abandoned.valid()) {
+					LOG(Info) << "Connecting plant " << pending.plant.name << " ["
+							<< pending.plant.connection << ", " << pending.plant.protocol << "]";
+					pending.connection = std::async(std::launch::async, &Datalogger::connect, pending.plant);
+					pending.deadline   = now + CONNECT_TIMEOUT;
+					++pending.attempts;
+				}
+				++it;
+			}
+			continue;
+		}
+
+		std::string error;
+		if (pending.connection.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			try {
+				openPlant(pending.plant, pending.connection.get());
+				it = pendingPlants.erase(it);
+				continue;
+			} catch (const PvlogException& ex) {
+				error = ex.what();
+			}
+		} else if (now >= pending.deadline) {
+			pending.abandoned = std::move(pending.connection);
+			error = "Connecting timed out";
+		} else {
+			++it;
+			continue; //still connecting
+		}
+
+		std::string errorMsg = bt::str(bt::format("Error opening plant %1% %2%")
+				% pending.plant.name % error);
+		LOG(Error) << errorMsg;
+		errorSig(errorMsg);
+
+		LOG(Info) << "Retrying plant " << pending.plant.name << " in " << pending.backoff.count() << " seconds";
+		pending.connection = std::future<PlantConnection>();
+		pending.retry      = now + pending.backoff;
+		pending.backoff    = std::min(pending.backoff * 2, RETRY_MAX_DELAY);
+		++it;
+	}
+
+	closeAbandonedConnections(false);
+}
+
+void Datalogger::abandonPendingPlants() {
+	for (PendingPlant& pending : pendingPlants) {
+		if (pending.connection.valid()) {
+			abandonedConnections.push_back(std::move(pending.connection));
+		}
+		if (pending.abandoned.valid()) {
+			abandonedConnections.push_back(std::move(pending.abandoned));
+		}
+	}
+	pendingPlants.clear();
+}
+
+void Datalogger::closeAbandonedConnections(bool wait) {
+	for (auto it = abandonedConnections.begin(); it != abandonedConnections.end(); ) {
+		if (!wait && it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		closeConnection(*it);
+		it = abandonedConnections.erase(it);
+	}
+}
+
+void Datalogger::closeConnection(std::future<PlantConnection>& connection) {
+	try {
+		pvlib_close(connection.get().plant);
+	} catch (const PvlogException&) {
+		//attempt failed, nothing to close
+	}
 }
 
 void Datalogger::updateDayArchive(pvlib_plant* plant, InverterPtr inverter) {
@@ -441,7 +609,7 @@ void Datalogger::updateDayArchive(pvlib_plant* plant, InverterPtr inverter) {
 	}
 	std::unique_ptr<pvlib_day_yield[], decltype(free)*> dayYields(y, free);
 
-	saveDayArchiveData(db, inverter, dayYields.get(), numEntries, currentTime);
+	dayDataSig(saveDayArchiveData(db, inverter, dayYields.get(), numEntries, currentTime));
 
 	LOG(Info) << "Read day archive data for "
 			<< inverter->name << " " << lastRead << " -> " << currentTime;
@@ -479,29 +647,66 @@ void Datalogger::updateEventArchive(pvlib_plant* plant, InverterPtr inverter) {
 			<< inverter->name << " " << lastRead << " -> " << currentTime;
 }
 
-void Datalogger::updateArchiveData() {
+void Datalogger::updateArchiveData(pt::ptime deadline) {
 	odb::session session;
 
-	for (auto plantEntry : plants) {
-		pvlib_plant* plant = plantEntry.first;
-		for (int64_t inverterId : plantEntry.second) {
-			odb::transaction t(db->begin());
-			InverterPtr inverter(db->load<Inverter>(inverterId));
-			t.commit();
+	while (!archiveQueue.empty() && !quit && pt::second_clock::universal_time() < deadline) {
+		pvlib_plant* plant = archiveQueue.front().first;
+		int64_t inverterId = archiveQueue.front().second;
+		archiveQueue.pop_front();
 
-			updateDayArchive(plant, inverter);
-			updateEventArchive(plant, inverter);
-		}
+		odb::transaction t(db->begin());
+		InverterPtr inverter(db->load<Inverter>(inverterId));
+		t.commit();
+
+		updateDayArchive(plant, inverter);
+		updateEventArchive(plant, inverter);
 	}
+
+	if (archiveQueue.empty() && !archiveSynced) {
+		archiveSynced = true;
+		MetricsRegistry::instance().gauge("pvlog_startup_archive_sync_milliseconds",
+				"Time from startup till the archive data of all inverters was read").set(
+				std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - created).count());
+	}
+}
+
+void Datalogger::publishPlantCounters(pvlib_plant* plant) {
+	PlantCounters& counters = plantCounters.at(plant);
+
+	pvlib_counters current;
+	pvlib_get_counters(plant, &current);
+
+	MetricsRegistry& registry = MetricsRegistry::instance();
+	MetricsRegistry::Labels labels{{"plant", counters.name}};
+	registry.counter("pvlog_pvlib_retries_total", "Inverter requests repeated by pvlib after an error", labels)
+			.inc(current.retries - counters.published.retries);
+	registry.counter("pvlog_pvlib_dropped_packets_total", "Received packets dropped by the pvlib connection", labels)
+			.inc(current.droppedPackets - counters.published.droppedPackets);
+
+	counters.published = current;
+}
+
+void Datalogger::closePlant(pvlib_plant* plant) {
+	publishPlantCounters(plant);
+	plantCounters.erase(plant);
+
+	archiveQueue.erase(std::remove_if(archiveQueue.begin(), archiveQueue.end(),
+			[plant](const std::pair<pvlib_plant*, int64_t>& entry) { return entry.first == plant; }),
+			archiveQueue.end());
+
+	pvlib_close(plant);
+	plants.erase(plant);
 }
 
 void Datalogger::closePlants() {
-	for (auto plantEntry : plants) {
-		pvlib_plant* p = plantEntry.first;
-		pvlib_close(p);
-	}
+	abandonPendingPlants();
+	closeAbandonedConnections(true);
 
-	plants.clear();
+	Plants plantsCopy(plants);
+	for (auto plantEntry : plantsCopy) {
+		closePlant(plantEntry.first);
+	}
 }
 
 void Datalogger::sleepUntill(pt::ptime time) const {
@@ -536,7 +741,12 @@ void Datalogger::logDayData(pvlib_plant* plant, int64_t inverterId) {
 		DayData dayData(inverter, curDate, stats->dayYield);
 
 		updateOrInsert(db, dayData);
-		t.commit();
+		{
+			Histogram::Timer timer(commitTimeHistogram("datalogger"));
+			t.commit();
+		}
+
+		dayDataSig(std::vector<DayData>{dayData});
 	} else {
 		std::string errorMsg = "Could not read dayYield (Invalid value)!";
 		LOG(Error) << errorMsg;
@@ -552,6 +762,14 @@ void Datalogger::logSpotData(InverterPtr inverter, const pvlib_ac* ac, const pvl
 	spotData.time = util::roundUp(pt::second_clock::universal_time(), updateInterval);
 
 	curSpotData[inverter->id] = spotData;
+	liveDataSig(spotData);
+
+	if (!firstSampleLogged) {
+		firstSampleLogged = true;
+		MetricsRegistry::instance().gauge("pvlog_startup_first_sample_milliseconds",
+				"Time from startup till the first spot data sample was logged").set(
+				std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - created).count());
+	}
 
 	LOG(Trace) << "Spot data: " << spotData;
 
@@ -566,9 +784,18 @@ void Datalogger::logData(pvlib_plant* plant, int64_t inverterId) {
 
 	InverterPtr inverter = idInverterMapp.at(inverterId);
 
-	if ((ret = pvlib_get_ac_values(plant, inverterId, ac.get())) < 0 ||
-		(ret = pvlib_get_dc_values(plant, inverterId, dc.get())) < 0 ||
-		(ret = pvlib_get_status(plant, inverterId, status.get())) < 0) {
+	MetricsRegistry& registry = MetricsRegistry::instance();
+	auto requestTime = [&registry, &inverter](const char* request) -> Histogram& {
+		return registry.histogram("pvlog_pvlib_request_duration_seconds", "Time of pvlib requests to an inverter",
+				{{"inverter", inverter->name}, {"request", request}});
+	};
+
+	if ((ret = timedRequest(requestTime("ac"),
+			[&]() { return pvlib_get_ac_values(plant, inverterId, ac.get()); })) < 0 ||
+		(ret = timedRequest(requestTime("dc"),
+			[&]() { return pvlib_get_dc_values(plant, inverterId, dc.get()); })) < 0 ||
+		(ret = timedRequest(requestTime("status"),
+			[&]() { return pvlib_get_status(plant, inverterId, status.get()); })) < 0) {
 		std::string errorMsg = bt::str(bt::format("Error reading inverter %1% data. Error: %2%")
 				% inverter->name % ret);
 		LOG(Error) << errorMsg;
@@ -608,8 +835,7 @@ void Datalogger::logData(pvlib_plant* plant, int64_t inverterId) {
 			LOG(Info) << "Closed inverter: " << inverter->name;
 			if (openInverters.empty()) {
 				LOG(Info) << "Closing plant!";
-				pvlib_close(plant);
-				plants.erase(plant);
+				closePlant(plant);
 			}
 			return;
 		} else {
@@ -631,6 +857,9 @@ void Datalogger::logData() {
 		for (int64_t inverterId : inverters) {
 			logData(plant, inverterId);
 		}
+		if (plants.count(plant) != 0) {
+			publishPlantCounters(plant);
+		}
 	}
 
 	//Average data from last interval and store it in database
@@ -647,15 +876,13 @@ void Datalogger::logData() {
 		for (const auto& entry : spotDatas) {
 			spotDataVec.push_back(entry.second);
 		}
-		for (SpotData& sd : spotDataVec) {
-			LOG(Info) << "Persisting spot data: " << sd;
-			odb::transaction t (db->begin ());
-			db->persist(sd);
-			t.commit();
-		}
+		spotDataBuffer->add(spotDataVec);
 
 		spotDataSig(spotDataVec);
-		curSpotDataList.clear();
+		//keep the capacity, so logging samples does not allocate
+		for (auto& entry : curSpotDataList) {
+			entry.second.clear();
+		}
 	}
 }
 
@@ -663,6 +890,10 @@ const std::unordered_map<int64_t, model::SpotData>& Datalogger::getLiveData() co
 	return curSpotData;
 }
 
+std::vector<SpotData> Datalogger::getPendingSpotData(pt::ptime begin, pt::ptime end) const {
+	return spotDataBuffer->pending(begin, end);
+}
+
 void Datalogger::stop() {
 	std::unique_lock<std::mutex> lock(mutex);
 	if (active == false) {
@@ -730,18 +961,18 @@ void Datalogger::work() {
 		active = true;
 		dataloggerStatus = OK;
 		openPlants();
-		if (plants.empty()) {
+		if (plants.empty() && pendingPlants.empty()) {
 			quit = true;
 		}
 
 		if (!quit) {
-			updateArchiveData();
 			logger();
 		}
 
 		if (quit) {
 			LOG(Info) << "Pausing datalogger";
 			closePlants();
+			spotDataBuffer->flush();
 
 
 			active = false;
@@ -757,13 +988,14 @@ void Datalogger::logger()
 {
 	try {
 		while (!quit) {
-			if (plants.empty()) {
-				//no more plants are open => wait for next day
+			if (plants.empty() && pendingPlants.empty()) {
+				//no more plants are open or connecting => wait for next day
 
 				int nextJulianDay = bg::day_clock::universal_day().julian_day() + 1;
 				sunrise = sunriseSunsetCalculator->sunrise(nextJulianDay);
 				sunset  = sunriseSunsetCalculator->sunset(nextJulianDay);
 
+				spotDataBuffer->flush();
 				dayEndSig();
 				dataloggerStatus = NIGHT;
 
@@ -774,8 +1006,6 @@ void Datalogger::logger()
 
 				dataloggerStatus = OK;
 				openPlants();
-
-				updateArchiveData();
 			}
 
 			pt::ptime curTime = pt::second_clock::universal_time();
@@ -791,7 +1021,18 @@ void Datalogger::logger()
 			sleepUntill(nextUpdate);
 			if (quit) return;
 
-			logData();
+			connectPlants();
+			{
+				Histogram::Timer timer(cycleTime);
+				logData();
+			}
+			if (pt::second_clock::universal_time() >= nextUpdate + updateInterval) {
+				LOG(Warning) << "Logging took longer than the update interval of " << updateInterval;
+				overruns.inc();
+			}
+
+			//use the rest of the interval for archive data
+			updateArchiveData(nextUpdate + updateInterval);
 		}
 	} catch (const PvlogException& ex) {
 		dataloggerStatus = ERROR;
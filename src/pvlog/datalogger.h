@@ -21,7 +21,10 @@
 #define DATA_LOGGER_H
 
 #include <atomic>
+#include <chrono>
 #include <ctime>
+#include <deque>
+#include <future>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -32,11 +35,16 @@
 #include <odb/database.hxx>
 #include <pvlib/pvlib.h>
 
+#include "databaseaccess.h"
 #include "pvlibhelper.h"
 
+#include "models/plant.h"
 #include "models/spotdata.h"
 
+class Counter;
+class Histogram;
 class SunriseSunset;
+class SpotDataBuffer;
 class Database;
 struct pvlib_plant;
 
@@ -54,17 +62,21 @@ public:
 	boost::signals2::signal<void ()> dayEndSig;
 	boost::signals2::signal<void (const std::vector<model::SpotData>&)> spotDataSig;
 	boost::signals2::signal<void (const std::vector<model::DayData>&)> dayDataSig;
+	boost::signals2::signal<void (const model::SpotData&)> liveDataSig; //every updateInterval
 
 	enum Status {
 		OK = 0,
 		NIGHT,
 		WARNING,
 		ERROR,
-		PAUSED
+		PAUSED,
+		STARTING //work not called yet
 	};
 
+	//Datalogger persists spot, day and event data
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::WRITE;
 
-	Datalogger(odb::core::database* database);
+	Datalogger(odb::core::database* database, SpotDataBuffer* spotDataBuffer);
 
 	virtual ~Datalogger();
 
@@ -72,6 +84,10 @@ public:
 
 	const std::unordered_map<int64_t, model::SpotData>& getLiveData() const;
 
+	//Spot data logged but not yet committed to the database
+	std::vector<model::SpotData> getPendingSpotData(boost::posix_time::ptime begin,
+	                                                boost::posix_time::ptime end) const;
+
 	void stop();
 
 	void start();
@@ -95,17 +111,68 @@ private:
 
 	void logData(pvlib_plant* plant, int64_t inverterId);
 
-	void openPlant(const model::Plant& plant);
+	struct PlantConnection {
+		pvlib_plant* plant;
+		Inverters inverters; //available inverters
+	};
+
+	//Plant being connected or waiting for the next connect attempt
+	struct PendingPlant {
+		model::Plant plant;
+		std::future<PlantConnection> connection; //valid while an attempt is running
+		std::future<PlantConnection> abandoned; //timed out attempt, no new one before it is closed
+		std::chrono::steady_clock::time_point deadline; //of the running attempt
+		std::chrono::steady_clock::time_point retry; //start of the next attempt
+		std::chrono::seconds backoff;
+		int attempts;
+	};
+
+	//Connect plant and discover its inverters, runs in its own thread
+	static PlantConnection connect(const model::Plant& plant);
 
+	//Add connected plant to the polled plants
+	void openPlant(const model::Plant& plant, const PlantConnection& connection);
+
+	/**
+	 * Connect all plants in the background. Plants are added to the
+	 * polled plants by connectPlants when connected.
+	 */
 	void openPlants();
 
+	/**
+	 * Add plants connected since the last call, start connect attempts that
+	 * are due. Attempts are abandoned after CONNECT_TIMEOUT, failed plants
+	 * are retried with exponential backoff till sunset. A plant is not retried
+	 * while its abandoned attempt still runs, they would share the connection.
+	 */
+	void connectPlants();
+
+	//Stop connecting pending plants
+	void abandonPendingPlants();
+
+	//Close plants of abandoned attempts that finished, wait for all if wait is true
+	void closeAbandonedConnections(bool wait);
+
+	//Close the plant of a finished attempt, waits for it if it is still running
+	static void closeConnection(std::future<PlantConnection>& connection);
+
 	void closePlants();
 
 	void updateDayArchive(pvlib_plant* plant, model::InverterPtr inverter);
 
 	void updateEventArchive(pvlib_plant* plant, model::InverterPtr inverter);
 
-	void updateArchiveData();
+	/**
+	 * Read archive data of the inverters queued by openPlant, one inverter at a
+	 * time while the current time is before deadline. So live polling is not
+	 * delayed by long archive reads after (re)opening plants.
+	 */
+	void updateArchiveData(boost::posix_time::ptime deadline);
+
+	//publish the pvlib counters of plant increased since the last call
+	void publishPlantCounters(pvlib_plant* plant);
+
+	void closePlant(pvlib_plant* plant);
 
 	void addDayYieldData(pvlib_plant* plant, model::InverterPtr inverter,
 			model::SpotData& spotData) const;
@@ -121,6 +188,7 @@ private:
 	Status dataloggerStatus;
 
 	odb::core::database* db;
+	SpotDataBuffer* spotDataBuffer;
 	boost::posix_time::time_duration timeout;
 	boost::posix_time::time_duration updateInterval;
 	std::unique_ptr<SunriseSunset> sunriseSunsetCalculator;
@@ -128,8 +196,27 @@ private:
 	boost::posix_time::ptime sunrise;
 
 	Plants plants;
+	std::vector<PendingPlant> pendingPlants;
+	std::vector<std::future<PlantConnection>> abandonedConnections;
 	std::unordered_map<int64_t, model::InverterPtr> idInverterMapp;
 
+	struct PlantCounters {
+		std::string name;
+		pvlib_counters published;
+	};
+	std::unordered_map<pvlib_plant*, PlantCounters> plantCounters;
+
+	Histogram& cycleTime;
+	Counter& overruns;
+
+	//inverters with archive data not read since their plant was opened
+	std::deque<std::pair<pvlib_plant*, int64_t>> archiveQueue;
+
+	//startup metrics, relative to construction
+	std::chrono::steady_clock::time_point created;
+	bool firstSampleLogged;
+	bool archiveSynced;
+
 	std::unordered_map<int64_t, std::vector<model::SpotData>> curSpotDataList;
 	std::unordered_map<int64_t, model::SpotData> curSpotData;
 };
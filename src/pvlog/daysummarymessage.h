@@ -24,6 +24,8 @@
 
 #include <boost/signals2.hpp>
 
+#include "databaseaccess.h"
+
 namespace odb {
 	class database;
 }
@@ -32,6 +34,8 @@ class DaySummaryMessage {
 public:
 	boost::signals2::signal<void (const std::string&)> newDaySummarySignal;
 
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::READ;
+
 	DaySummaryMessage(odb::database* db);
 
 	void generateDaySummaryMessage();
@@ -0,0 +1,175 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "downsampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/date_time/posix_time/conversion.hpp>
+
+#include "pvlogexception.h"
+
+namespace pt = boost::posix_time;
+
+constexpr std::size_t Downsampler::MAX_POINTS;
+
+Downsampler::Method Downsampler::parseMethod(const std::string& name) {
+	if (name == "avg") {
+		return Method::AVERAGE;
+	} else if (name == "minmax") {
+		return Method::MINMAX;
+	} else if (name == "lttb") {
+		return Method::LTTB;
+	}
+	PVLOG_EXCEPT("Unknown downsampling method: " + name);
+}
+
+Downsampler::Downsampler(Method method, pt::ptime begin, pt::ptime end, std::size_t points) :
+		method(method),
+		begin(pt::to_time_t(begin)),
+		end(pt::to_time_t(end)),
+		bucketCount(0),
+		current(),
+		pending(),
+		started(false),
+		previous(),
+		last() {
+	//LTTB keeps the first and the last sample outside of the buckets
+	std::size_t minPoints = (method == Method::LTTB) ? 3 : 1;
+	if (points < minPoints || points > MAX_POINTS) {
+		PVLOG_EXCEPT("Invalid number of points: " + std::to_string(points));
+	}
+	if (this->end <= this->begin) {
+		PVLOG_EXCEPT("Invalid time range");
+	}
+
+	bucketCount = (method == Method::LTTB) ? points - 2 : points;
+	times.reserve(points);
+	values.reserve(points);
+}
+
+int64_t Downsampler::bucketIndex(int64_t time) const {
+	return (time - begin) * bucketCount / (end - begin);
+}
+
+void Downsampler::emit(int64_t time, int32_t value) {
+	times.push_back(time);
+	values.push_back(value);
+}
+
+void Downsampler::add(const pt::ptime& ptime, int32_t power) {
+	int64_t time = pt::to_time_t(ptime);
+	if (time < begin || time >= end) {
+		return;
+	}
+
+	Point point{time, power};
+	if (method == Method::LTTB && !started) {
+		emit(time, power);
+		previous = point;
+		last     = point;
+		started  = true;
+		return;
+	}
+
+	int64_t index = bucketIndex(time);
+	if (current.count != 0 && index != current.index) {
+		completeBucket();
+	}
+
+	if (current.count == 0) {
+		current.index   = index;
+		current.sum     = 0;
+		current.timeSum = 0;
+		current.min     = power;
+		current.max     = power;
+	}
+	addToBucket(point);
+	last = point;
+}
+
+void Downsampler::addToBucket(const Point& point) {
+	current.sum     += point.value;
+	current.timeSum += point.time;
+	current.count   += 1;
+	current.min      = std::min(current.min, point.value);
+	current.max      = std::max(current.max, point.value);
+	if (method == Method::LTTB) {
+		current.points.push_back(point);
+	}
+}
+
+void Downsampler::completeBucket() {
+	int64_t bucketStart = begin + current.index * (end - begin) / bucketCount;
+
+	switch (method) {
+	case Method::AVERAGE:
+		emit(bucketStart, static_cast<int32_t>(std::lround(static_cast<double>(current.sum) / current.count)));
+		break;
+	case Method::MINMAX:
+		emit(bucketStart, current.min);
+		maxValues.push_back(current.max);
+		break;
+	case Method::LTTB:
+		if (pending.count != 0) {
+			selectLargestTriangle(pending.points, static_cast<double>(current.timeSum) / current.count,
+					static_cast<double>(current.sum) / current.count);
+		}
+		std::swap(pending, current);
+		current.points.clear();
+		break;
+	}
+
+	current.count = 0;
+}
+
+void Downsampler::selectLargestTriangle(const std::vector<Point>& bucket, double nextTime, double nextValue) {
+	double maxArea = -1;
+	const Point* selected = nullptr;
+	for (const Point& point : bucket) {
+		//twice the triangle area, only used for comparison
+		double area = std::abs((previous.time - nextTime) * (point.value - previous.value)
+				- (previous.time - point.time) * (nextValue - previous.value));
+		if (area > maxArea) {
+			maxArea  = area;
+			selected = &point;
+		}
+	}
+
+	if (selected != nullptr) {
+		emit(selected->time, selected->value);
+		previous = *selected;
+	}
+}
+
+void Downsampler::finish() {
+	if (current.count != 0) {
+		completeBucket();
+	}
+
+	if (method == Method::LTTB && pending.count != 0) {
+		//the last sample is the last point of the last bucket and is always kept
+		pending.points.pop_back();
+		selectLargestTriangle(pending.points, last.time, last.value);
+		emit(last.time, last.value);
+		pending.count = 0;
+		pending.points.clear();
+	}
+}
@@ -0,0 +1,154 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_DOWNSAMPLER_H_
+#define SRC_PVLOG_DOWNSAMPLER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/**
+ * Reduces a time ordered power series to a bounded number of points in a
+ * single pass.
+ *
+ * The time range is split into buckets of equal duration, empty buckets
+ * return no point:
+ * AVERAGE: average power of every bucket at the bucket start, one point per bucket.
+ * MINMAX:  minimum and maximum power of every bucket at the bucket start.
+ * LTTB:    largest triangle three buckets. Keeps the first and the last sample
+ *          and from every bucket the sample forming the largest triangle with
+ *          the sample kept before and the average of the next bucket. Only two
+ *          buckets are buffered.
+ *
+ * Written as {"time":[...],"power":[...]}, MINMAX as {"time":[...],"min":[...],"max":[...]}.
+ */
+class Downsampler {
+public:
+	enum class Method {
+		AVERAGE,
+		MINMAX,
+		LTTB
+	};
+
+	static constexpr std::size_t MAX_POINTS = 10000;
+
+	/**
+	 * Parse method name avg, minmax or lttb, throws PvlogException on unknown names.
+	 */
+	static Method parseMethod(const std::string& name);
+
+	/**
+	 * Throws PvlogException if points is out of range for method.
+	 */
+	Downsampler(Method method, boost::posix_time::ptime begin, boost::posix_time::ptime end, std::size_t points);
+
+	/**
+	 * Add sample, samples have to be added in time order, samples outside of
+	 * the time range are ignored.
+	 */
+	void add(const boost::posix_time::ptime& time, int32_t power);
+
+	/**
+	 * Output the buffered buckets, has to be called before write.
+	 */
+	void finish();
+
+	std::size_t size() const {
+		return times.size();
+	}
+
+	/**
+	 * Write points with util::JsonWriter or util::MsgPackWriter.
+	 */
+	template<typename Writer>
+	void write(Writer& writer) const;
+
+private:
+	struct Point {
+		int64_t time;
+		int32_t value;
+	};
+
+	struct Bucket {
+		int64_t index;
+		std::vector<Point> points; //LTTB only
+		int64_t sum;
+		int64_t timeSum;
+		int64_t count;
+		int32_t min;
+		int32_t max;
+	};
+
+	int64_t bucketIndex(int64_t time) const;
+
+	void addToBucket(const Point& point);
+
+	void completeBucket();
+
+	void emit(int64_t time, int32_t value);
+
+	void selectLargestTriangle(const std::vector<Point>& bucket, double nextTime, double nextValue);
+
+	template<typename Writer, typename T>
+	static void writeArray(Writer& writer, const std::string& name, const std::vector<T>& values);
+
+	Method method;
+	int64_t begin;
+	int64_t end;
+	int64_t bucketCount;
+
+	Bucket current;
+	Bucket pending; //LTTB only, complete bucket waiting for the average of the next one
+	bool started;
+	Point previous; //LTTB only, last selected point
+	Point last;     //LTTB only, last sample
+
+	std::vector<int64_t> times;
+	std::vector<int32_t> values; //power or min
+	std::vector<int32_t> maxValues;
+};
+
+template<typename Writer, typename T>
+void Downsampler::writeArray(Writer& writer, const std::string& name, const std::vector<T>& values) {
+	writer.key(name).beginArray(values.size());
+	for (T value : values) {
+		writer.value(value);
+	}
+	writer.endArray();
+}
+
+template<typename Writer>
+void Downsampler::write(Writer& writer) const {
+	bool minMax = (method == Method::MINMAX);
+
+	writer.beginObject(minMax ? 3 : 2);
+	writeArray(writer, "time", times);
+	if (minMax) {
+		writeArray(writer, "min", values);
+		writeArray(writer, "max", maxValues);
+	} else {
+		writeArray(writer, "power", values);
+	}
+	writer.endObject();
+}
+
+#endif /* SRC_PVLOG_DOWNSAMPLER_H_ */
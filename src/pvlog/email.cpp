@@ -66,7 +66,11 @@ Email::Email(const std::string& smtpServer, int port,
 }
 
 Email::~Email() {
-	session->close();
+	try {
+		session->close();
+	} catch (const Exception &e) {
+		LOG(Debug) << "Closing smtp session failed: " << e.displayText();
+	}
 }
 
 void Email::send(const std::string& from, const std::string& to, const std::string& subject, const std::string& content) {
@@ -20,50 +20,205 @@
  * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define PVLOG_LOG_MODULE "emailnotification"
+
+#include <algorithm>
+#include <ctime>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "configreader.h"
 #include "email.h"
 #include "log.h"
+#include "metrics.h"
 
 #include "models/config.h"
 #include "models/configservice.h"
 #include "models/config_odb.h"
 
+namespace pt = boost::posix_time;
+
 using model::ConfigPtr;
 using model::Config;
 
+static const std::string SUBJECT = "Pvlog email notification";
+
+//mails waiting while the smtp server is unreachable, older ones are dropped
+static const std::size_t MAX_QUEUED = 100;
 
-EmailNotification::EmailNotification(odb::database* db) : db(db) {
+EmailNotification::Settings::Settings() :
+		digestDelay(0),
+		keepAlive(0) {
 	//nothing to do
 }
 
+EmailNotification::Settings EmailNotification::Settings::read(const ConfigReader& configReader) {
+	Settings settings;
+
+	settings.digestDelay = std::chrono::seconds(configReader.getSizeValue("email_digest_delay", "60", 0, 24 * 3600));
+	settings.keepAlive   = std::chrono::seconds(configReader.getSizeValue("smtp_keep_alive", "60", 0, 3600));
+
+	return settings;
+}
+
+EmailNotification::EmailNotification(odb::database* db, Settings settings) :
+		db(db),
+		settings(settings),
+		stopped(false),
+		smtpConfig(),
+		sent(MetricsRegistry::instance().counter("pvlog_notifications_sent_total", "Notification mails sent")),
+		failed(MetricsRegistry::instance().counter("pvlog_notification_failures_total",
+				"Notification mails that could not be sent")) {
+	worker = std::thread(&EmailNotification::work, this);
+}
+
+EmailNotification::~EmailNotification() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	wakeUp.notify_all();
+	worker.join();
+}
+
 void EmailNotification::sendMessage(const std::string& message) {
-	using Query = odb::query<Config>;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mails.size() >= MAX_QUEUED) {
+		LOG(Warning) << "Too many queued notifications, dropping: " << mails.front().content;
+		mails.pop_front();
+	}
+	mails.push_back(Mail{SUBJECT, message});
+	wakeUp.notify_one();
+}
+
+void EmailNotification::sendError(const std::string& message) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (errors.empty()) {
+		digestTime = Clock::now() + settings.digestDelay;
+	} else if (errors.size() >= MAX_QUEUED) {
+		LOG(Warning) << "Too many queued notifications, dropping: " << errors.front();
+		errors.pop_front();
+	}
+	errors.push_back(pt::to_simple_string(pt::second_clock::local_time()) + "  " + message);
+	wakeUp.notify_one();
+}
 
-	try {
-		odb::transaction t(db->begin());
-		ConfigPtr smtpServerConf   = db->query_one<Config>(Query::key == "smtpServer");
-		ConfigPtr smtpPortConf     = db->query_one<Config>(Query::key == "smtpPort");
-		ConfigPtr smtpUserConf     = db->query_one<Config>(Query::key == "smtpUser");
-		ConfigPtr smtpPasswordConf = db->query_one<Config>(Query::key == "smtpPassword");
+EmailNotification::Mail EmailNotification::digest() {
+	Mail mail;
+	if (errors.size() == 1) {
+		mail.subject = SUBJECT;
+		mail.content = errors.front();
+	} else {
+		mail.subject = "Pvlog: " + std::to_string(errors.size()) + " notifications";
+		for (const std::string& error : errors) {
+			mail.content += error + "\n";
+		}
+	}
+	errors.clear();
+	return mail;
+}
+
+void EmailNotification::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		Clock::time_point now = Clock::now();
+		//on stop the digest is not delayed, the error that stopped pvlog is in it
+		bool digestDue = !errors.empty() && (stopped || now >= digestTime);
+
+		if (mails.empty() && !digestDue) {
+			if (stopped) {
+				break;
+			}
+
+			if (email && now >= lastSent + settings.keepAlive) {
+				LOG(Debug) << "Closing idle smtp session";
+				std::unique_ptr<Email> idle(std::move(email));
+				lock.unlock();
+				idle.reset();
+				lock.lock();
+				continue;
+			}
+
+			Clock::time_point wake = Clock::time_point::max();
+			if (!errors.empty()) {
+				wake = digestTime;
+			}
+			if (email) {
+				wake = std::min(wake, lastSent + settings.keepAlive);
+			}
+
+			if (wake == Clock::time_point::max()) {
+				wakeUp.wait(lock);
+			} else {
+				wakeUp.wait_until(lock, wake);
+			}
+			continue;
+		}
+
+		std::deque<Mail> pending;
+		pending.swap(mails);
+		if (digestDue) {
+			pending.push_back(digest());
+		}
+
+		lock.unlock();
+		for (const Mail& mail : pending) {
+			deliver(mail);
+		}
+		lock.lock();
+	}
+}
 
-		ConfigPtr emailConf = db->query_one<Config>(Query::key == "email");
-		t.commit();
+void EmailNotification::deliver(const Mail& mail) {
+	//a kept alive session may have been closed by the server, try once more with a new one
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		bool reused = (email != nullptr);
+		try {
+			if (!email) {
+				if (!readSmtpConfig(smtpConfig)) {
+					return;
+				}
+				email.reset(new Email(smtpConfig.server, smtpConfig.port, smtpConfig.user, smtpConfig.password));
+			}
 
-		if (smtpServerConf == nullptr || smtpPortConf == nullptr || smtpUserConf == nullptr ||
-				smtpPasswordConf == nullptr || emailConf == nullptr) {
+			email->send(smtpConfig.user, smtpConfig.targetEmail, mail.subject, mail.content);
+			lastSent = Clock::now();
+			sent.inc();
+			LOG(Info) << "Sended pvlog email notification: " << mail.content;
 			return;
+		} catch (const std::exception& ex) {
+			email.reset();
+			if (!reused) {
+				LOG(Error) << "Failed sending email notification: " << ex.what();
+				failed.inc();
+				return;
+			}
+			LOG(Debug) << "Sending on kept alive smtp session failed, reconnecting: " << ex.what();
 		}
+	}
+}
 
-		const std::string& smtpServer = smtpServerConf->value;
-		int smtpPort                  = std::stoi(smtpPortConf->value);
-		const std::string& user       = smtpUserConf->value;
-		const std::string& password   = smtpPasswordConf->value;
+bool EmailNotification::readSmtpConfig(SmtpConfig& config) {
+	using Query = odb::query<Config>;
 
-		const std::string& targetEmail = emailConf->value;
+	odb::transaction t(db->begin());
+	ConfigPtr smtpServerConf   = db->query_one<Config>(Query::key == "smtpServer");
+	ConfigPtr smtpPortConf     = db->query_one<Config>(Query::key == "smtpPort");
+	ConfigPtr smtpUserConf     = db->query_one<Config>(Query::key == "smtpUser");
+	ConfigPtr smtpPasswordConf = db->query_one<Config>(Query::key == "smtpPassword");
 
-		Email email(smtpServer, smtpPort, user, password);
-		email.send(user, targetEmail, "Pvlog email notification", message);
-		LOG(Info) << "Sended pvlog email notification: " << message;
-	} catch (const std::exception& ex) {
-		LOG(Error) << "Failed sending email notification: " << ex.what();
+	ConfigPtr emailConf = db->query_one<Config>(Query::key == "email");
+	t.commit();
+
+	if (smtpServerConf == nullptr || smtpPortConf == nullptr || smtpUserConf == nullptr ||
+			smtpPasswordConf == nullptr || emailConf == nullptr) {
+		return false;
 	}
+
+	config.server      = smtpServerConf->value;
+	config.port        = std::stoi(smtpPortConf->value);
+	config.user        = smtpUserConf->value;
+	config.password    = smtpPasswordConf->value;
+	config.targetEmail = emailConf->value;
+	return true;
 }
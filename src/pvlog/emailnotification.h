@@ -20,19 +20,106 @@
 #ifndef MAIL_NOTIFICATION_H
 #define MAIL_NOTIFICATION_H
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+
+#include "databaseaccess.h"
+#include "utility.h"
 
 namespace odb {
 	class database;
 }
 
+class ConfigReader;
+class Counter;
+class Email;
+
+/**
+ * Sends notification emails from a worker thread.
+ *
+ * The smtp session stays logged in for keepAlive after a mail was sent, so
+ * bursts of mails need a single login. Errors are collected for digestDelay
+ * after the first one and sent as one digest mail. Mails still queued when
+ * it is destroyed are sent before the destructor returns.
+ */
 class EmailNotification {
+	DISABLE_COPY(EmailNotification)
 public:
-	EmailNotification(odb::database* db);
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::READ;
+
+	struct Settings {
+		std::chrono::seconds digestDelay;
+		std::chrono::seconds keepAlive;
+
+		Settings();
 
+		static Settings read(const ConfigReader& configReader);
+	};
+
+	EmailNotification(odb::database* db, Settings settings);
+
+	~EmailNotification();
+
+	/**
+	 * Queue message, it is sent as a mail of its own.
+	 */
 	void sendMessage(const std::string& message);
+
+	/**
+	 * Queue error message, it is sent with the other errors of the digest.
+	 */
+	void sendError(const std::string& message);
+
 private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Mail {
+		std::string subject;
+		std::string content;
+	};
+
+	struct SmtpConfig {
+		std::string server;
+		int port;
+		std::string user;
+		std::string password;
+		std::string targetEmail;
+	};
+
+	void work();
+
+	Mail digest();
+
+	void deliver(const Mail& mail);
+
+	/**
+	 * Read the smtp settings, returns false if notifications are not configured.
+	 */
+	bool readSmtpConfig(SmtpConfig& config);
+
 	odb::database* db;
+	Settings settings;
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopped;
+	std::deque<Mail> mails;
+	std::deque<std::string> errors;
+	Clock::time_point digestTime;
+
+	//used by the worker thread only
+	std::unique_ptr<Email> email;
+	SmtpConfig smtpConfig;
+	Clock::time_point lastSent;
+
+	Counter& sent;
+	Counter& failed;
+	std::thread worker;
 };
 
 #endif //#ifndef MAIL_NOTIFICATION_H
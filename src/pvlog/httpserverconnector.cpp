@@ -0,0 +1,276 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpserverconnector.h"
+
+#include <Poco/Exception.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/URI.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+
+#include "compression.h"
+#include "livestream.h"
+#include "log.h"
+#include "metrics.h"
+#include "rpcdispatcher.h"
+
+using Poco::Net::HTTPRequest;
+using Poco::Net::HTTPResponse;
+using Poco::Net::HTTPServerRequest;
+using Poco::Net::HTTPServerResponse;
+
+namespace {
+
+//comment sent on idle live streams, detects closed connections and keeps proxies from timing out
+const std::chrono::seconds KEEPALIVE_INTERVAL(15);
+
+class RequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+	explicit RequestHandler(HttpServerConnector* connector) : connector(connector) {}
+
+	virtual void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+		connector->handleRequest(request, response);
+	}
+
+private:
+	HttpServerConnector* connector;
+};
+
+class RequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+	explicit RequestHandlerFactory(HttpServerConnector* connector) : connector(connector) {}
+
+	virtual Poco::Net::HTTPRequestHandler* createRequestHandler(const HTTPServerRequest&) override {
+		return new RequestHandler(connector);
+	}
+
+private:
+	HttpServerConnector* connector;
+};
+
+//Read the whole stream into body, returns false if it is longer than maxSize
+bool readLimited(std::istream& in, std::string& body, std::size_t maxSize) {
+	char buf[8192];
+	while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+		std::size_t read = static_cast<std::size_t>(in.gcount());
+		if (body.size() + read > maxSize) {
+			return false;
+		}
+		body.append(buf, read);
+	}
+	return true;
+}
+
+} //namespace {
+
+HttpServerConnector::HttpServerConnector(int port, int threads, std::size_t compressMinSize,
+		std::size_t maxRequestSize) :
+		port(port),
+		threads(threads),
+		compressMinSize(compressMinSize),
+		maxRequestSize(maxRequestSize),
+		dispatcher(nullptr),
+		liveStream(nullptr) {
+	//nothing to do
+}
+
+HttpServerConnector::~HttpServerConnector() {
+	StopListening();
+}
+
+bool HttpServerConnector::StartListening() {
+	if (server) {
+		return false;
+	}
+
+	try {
+		Poco::Net::ServerSocket socket(port);
+		Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+		params->setKeepAlive(true);
+
+		params->setMaxThreads(threads);
+
+		threadPool.reset(new Poco::ThreadPool(1, threads));
+		server.reset(new Poco::Net::HTTPServer(new RequestHandlerFactory(this), *threadPool, socket, params));
+		server->start();
+	} catch (const Poco::Exception& ex) {
+		LOG(Error) << "Error starting http server on port " << port << ": " << ex.displayText();
+		server.reset();
+		threadPool.reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool HttpServerConnector::StopListening() {
+	if (!server) {
+		return false;
+	}
+
+	//live streams block their connection threads till the stream is closed
+	if (liveStream != nullptr) {
+		liveStream->close();
+	}
+
+	server->stop();
+	threadPool->joinAll();
+	server.reset();
+	threadPool.reset();
+	return true;
+}
+
+void HttpServerConnector::setDispatcher(RpcDispatcher* dispatcher) {
+	this->dispatcher = dispatcher;
+}
+
+void HttpServerConnector::setLiveStream(LiveStream* liveStream) {
+	this->liveStream = liveStream;
+}
+
+ResponseEncoding HttpServerConnector::acceptedEncoding(const std::string& accept) {
+	if (accept.find("application/msgpack") != std::string::npos
+			|| accept.find("application/x-msgpack") != std::string::npos) {
+		return ResponseEncoding::MSGPACK;
+	}
+	return ResponseEncoding::JSON;
+}
+
+void HttpServerConnector::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
+	//same cors headers as jsonrpc::HttpServer, the web interface may be served from another origin
+	response.set("Access-Control-Allow-Origin", "*");
+
+	if (request.getMethod() == HTTPRequest::HTTP_OPTIONS) {
+		response.set("Access-Control-Allow-Headers", "origin, content-type, accept");
+		response.set("Access-Control-Allow-Methods", "POST, OPTIONS");
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+
+	if (request.getMethod() == HTTPRequest::HTTP_GET && liveStream != nullptr
+			&& Poco::URI(request.getURI()).getPath() == "/live") {
+		serveLiveStream(request, response);
+		return;
+	}
+
+	if (request.getMethod() == HTTPRequest::HTTP_GET && Poco::URI(request.getURI()).getPath() == "/metrics") {
+		RpcResponse metrics;
+		MetricsRegistry::instance().writePrometheus(metrics.head);
+		response.setContentType("text/plain; version=0.0.4");
+		sendResponse(request, response, metrics);
+		return;
+	}
+
+	if (request.getMethod() != HTTPRequest::HTTP_POST) {
+		response.setStatusAndReason(HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+
+	//bodies are read into memory on the connection thread, chunked bodies have no content length
+	std::string body;
+	if ((request.hasContentLength() && request.getContentLength64() > static_cast<Poco::Int64>(maxRequestSize))
+			|| !readLimited(request.stream(), body, maxRequestSize)) {
+		LOG(Warning) << "Rejecting request from " << request.clientAddress().toString()
+				<< ", body exceeds " << maxRequestSize << " bytes";
+		response.setStatusAndReason(HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE);
+		response.setKeepAlive(false); //the rest of the body is not read
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+
+	RpcResponse result;
+	ResponseEncoding encoding = ResponseEncoding::JSON;
+	if (dispatcher != nullptr) {
+		encoding = acceptedEncoding(request.get("Accept", ""));
+		dispatcher->handleRequest(body, encoding, result);
+	} else {
+		ProcessRequest(body, result.head);
+	}
+
+	response.setContentType(encoding == ResponseEncoding::MSGPACK ? "application/msgpack" : "application/json");
+	sendResponse(request, response, result);
+}
+
+void HttpServerConnector::sendResponse(HTTPServerRequest& request, HTTPServerResponse& response,
+		const RpcResponse& body) {
+	response.set("Vary", "Accept-Encoding");
+
+	ContentEncoding contentEncoding = acceptedContentEncoding(request.get("Accept-Encoding", ""));
+	if (contentEncoding != ContentEncoding::IDENTITY && body.size() >= compressMinSize) {
+		std::string compressed = compressResponse(contentEncoding, body.head, body.payload.get(), body.tail);
+		response.set("Content-Encoding", contentEncodingName(contentEncoding));
+		response.setContentLength(compressed.size());
+		response.send().write(compressed.data(), compressed.size());
+		return;
+	}
+
+	response.setContentLength(body.size());
+	std::ostream& out = response.send();
+	out.write(body.head.data(), body.head.size());
+	if (body.payload != nullptr) {
+		out.write(body.payload->data.data(), body.payload->data.size());
+	}
+	out.write(body.tail.data(), body.tail.size());
+}
+
+void HttpServerConnector::serveLiveStream(HTTPServerRequest& request, HTTPServerResponse& response) {
+	std::shared_ptr<LiveStream::Subscription> subscription = liveStream->subscribe(request.get("Last-Event-ID", ""));
+	if (!subscription) {
+		response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		response.setContentLength(0);
+		response.send();
+		return;
+	}
+
+	try {
+		response.setContentType("text/event-stream");
+		response.set("Cache-Control", "no-cache");
+		response.setChunkedTransferEncoding(true);
+
+		std::ostream& out = response.send();
+		out << "retry: 5000\n\n";
+		out.flush();
+
+		//a slow client blocks only this thread, the stream drops its queue and resyncs it
+		std::vector<LiveStream::Frame> frames;
+		while (out.good() && liveStream->wait(*subscription, frames, KEEPALIVE_INTERVAL)) {
+			if (frames.empty()) {
+				out << ": keepalive\n\n";
+			}
+			for (const LiveStream::Frame& frame : frames) {
+				out << *frame;
+			}
+			out.flush();
+		}
+	} catch (const Poco::Exception& ex) {
+		LOG(Debug) << "Live stream closed: " << ex.displayText();
+	}
+
+	liveStream->unsubscribe(subscription);
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_HTTPSERVERCONNECTOR_H_
+#define SRC_PVLOG_HTTPSERVERCONNECTOR_H_
+
+#include <memory>
+#include <string>
+
+#include <jsonrpccpp/server/abstractserverconnector.h>
+
+#include "responseencoding.h"
+#include "utility.h"
+
+namespace Poco {
+	class ThreadPool;
+namespace Net {
+	class HTTPServer;
+	class HTTPServerRequest;
+	class HTTPServerResponse;
+}
+}
+
+class LiveStream;
+class RpcDispatcher;
+struct RpcResponse;
+
+/**
+ * Http connector for json-rpc-cpp servers based on the Poco http server.
+ *
+ * Unlike jsonrpc::HttpServer it gives access to the request headers, the
+ * response encoding is negotiated with the Accept header: application/msgpack
+ * (or application/x-msgpack) returns MessagePack, everything else json.
+ * MessagePack needs a RpcDispatcher, without it all responses are json.
+ *
+ * Responses of at least compressMinSize bytes are compressed with the
+ * content encoding negotiated with Accept-Encoding, precompressed payloads
+ * of the response cache are reused.
+ *
+ * POST bodies larger than maxRequestSize are rejected with 413.
+ *
+ * GET /metrics returns the MetricsRegistry in the Prometheus text format.
+ *
+ * With a LiveStream GET /live returns live spot data as server-sent events.
+ * Every connection uses one of threads, including open live streams.
+ */
+class HttpServerConnector : public jsonrpc::AbstractServerConnector {
+	DISABLE_COPY(HttpServerConnector)
+public:
+	HttpServerConnector(int port, int threads, std::size_t compressMinSize, std::size_t maxRequestSize);
+
+	virtual ~HttpServerConnector();
+
+	virtual bool StartListening() override;
+
+	virtual bool StopListening() override;
+
+	/**
+	 * Requests are passed to dispatcher instead of the handler, has to be
+	 * set before StartListening.
+	 */
+	void setDispatcher(RpcDispatcher* dispatcher);
+
+	/**
+	 * Serve liveStream on /live, has to be set before StartListening.
+	 */
+	void setLiveStream(LiveStream* liveStream);
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+private:
+	static ResponseEncoding acceptedEncoding(const std::string& accept);
+
+	void serveLiveStream(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	void sendResponse(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+			const RpcResponse& body);
+
+	int port;
+	int threads;
+	std::size_t compressMinSize;
+	std::size_t maxRequestSize;
+	RpcDispatcher* dispatcher;
+	LiveStream* liveStream;
+	std::unique_ptr<Poco::ThreadPool> threadPool;
+	std::unique_ptr<Poco::Net::HTTPServer> server;
+};
+
+#endif /* SRC_PVLOG_HTTPSERVERCONNECTOR_H_ */
@@ -0,0 +1,136 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define PVLOG_LOG_MODULE "httpssessionpool"
+
+#include "httpssessionpool.h"
+
+#include <Poco/Net/HTTPSClientSession.h>
+#include <Poco/Net/SecureStreamSocket.h>
+#include <Poco/StreamCopier.h>
+#include <Poco/Timestamp.h>
+
+#include "log.h"
+#include "metrics.h"
+
+using Poco::Net::HTTPRequest;
+using Poco::Net::HTTPResponse;
+using Poco::Net::HTTPSClientSession;
+using Poco::Net::SecureStreamSocket;
+
+static Counter& connections(const std::string& host, const std::string& connection) {
+	return MetricsRegistry::instance().counter("pvlog_https_requests_total",
+			"Https requests by connection: reused keep-alive connection, new connection resuming "
+			"the tls session or new connection with full handshake", {{"host", host}, {"connection", connection}});
+}
+
+HttpsSessionPool::HttpsSessionPool(const std::string& host, uint16_t port, Poco::Net::Context::Ptr context,
+		std::size_t maxIdle, Poco::Timespan keepAlive) :
+		serverHost(host),
+		port(port),
+		context(context),
+		maxIdle(maxIdle),
+		keepAlive(keepAlive),
+		fullHandshakes(connections(host, "full")),
+		resumedHandshakes(connections(host, "resumed")),
+		reusedConnections(connections(host, "reused")) {
+	this->context->enableSessionCache(true);
+}
+
+HttpsSessionPool::~HttpsSessionPool() {
+	//nothing to do
+}
+
+HttpsSessionPool::SessionPtr HttpsSessionPool::acquire() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!idle.empty()) {
+		SessionPtr session = std::move(idle.back().session);
+		//closed before the session reconnects by itself, so connected() tells if the connection is reused
+		if (idle.back().lastRequest.isElapsed(keepAlive.totalMicroseconds())) {
+			session->reset();
+		}
+		idle.pop_back();
+		return session;
+	}
+
+	SessionPtr session(new HTTPSClientSession(serverHost, port, context, tlsSession));
+	session->setKeepAlive(true);
+	session->setKeepAliveTimeout(keepAlive);
+	return session;
+}
+
+void HttpsSessionPool::release(SessionPtr session, Poco::Timestamp lastRequest) {
+	std::lock_guard<std::mutex> lock(mutex);
+	tlsSession = session->sslSession();
+	if (idle.size() < maxIdle) {
+		idle.push_back(Idle{std::move(session), lastRequest});
+	}
+}
+
+std::string HttpsSessionPool::exchange(HTTPSClientSession& session, HTTPRequest& request,
+		const std::string& body, HTTPResponse& response) {
+	bool reused = session.connected();
+
+	request.setKeepAlive(true);
+	std::ostream& out = session.sendRequest(request);
+	out << body;
+
+	std::string result;
+	std::istream& in = session.receiveResponse(response);
+	Poco::StreamCopier::copyToString(in, result);
+
+	if (reused) {
+		reusedConnections.inc();
+	} else if (SecureStreamSocket(session.socket()).sessionWasReused()) {
+		resumedHandshakes.inc();
+	} else {
+		fullHandshakes.inc();
+	}
+
+	if (!response.getKeepAlive()) {
+		session.reset();
+	}
+
+	return result;
+}
+
+std::string HttpsSessionPool::send(HTTPRequest& request, const std::string& body, HTTPResponse& response) {
+	SessionPtr session = acquire();
+	bool connected = session->connected();
+
+	Poco::Timestamp lastRequest;
+	std::string result;
+	try {
+		result = exchange(*session, request, body, response);
+	} catch (const Poco::Exception& ex) {
+		if (!connected) {
+			throw;
+		}
+		LOG(Debug) << "Request on kept alive connection to " << serverHost << " failed, reconnecting: "
+				<< ex.displayText();
+		session->reset();
+		response.clear();
+		lastRequest.update();
+		result = exchange(*session, request, body, response);
+	}
+
+	release(std::move(session), lastRequest);
+	return result;
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SRC_PVLOG_HTTPSSESSIONPOOL_H_
+#define SRC_PVLOG_HTTPSSESSIONPOOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Poco/Net/Context.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/Session.h>
+#include <Poco/Timespan.h>
+#include <Poco/Timestamp.h>
+
+#include "utility.h"
+
+namespace Poco {
+	namespace Net {
+		class HTTPSClientSession;
+	}
+}
+
+class Counter;
+
+/**
+ * Keep-alive https connections to one server.
+ *
+ * Idle connections are kept for keepAlive and reused by the next request.
+ * New connections resume the tls session of the previous one, so only the
+ * first connection and connections after the server dropped the session
+ * need a full handshake.
+ */
+class HttpsSessionPool {
+	DISABLE_COPY(HttpsSessionPool)
+public:
+	HttpsSessionPool(const std::string& host, uint16_t port, Poco::Net::Context::Ptr context,
+			std::size_t maxIdle, Poco::Timespan keepAlive);
+
+	~HttpsSessionPool();
+
+	/**
+	 * Send request with body and return the complete response body.
+	 *
+	 * A request failing on a reused connection, which the server may have
+	 * closed meanwhile, is sent once more on a new connection. Throws
+	 * Poco::Exception if the request failed.
+	 */
+	std::string send(Poco::Net::HTTPRequest& request, const std::string& body,
+			Poco::Net::HTTPResponse& response);
+
+	const std::string& host() const {
+		return serverHost;
+	}
+
+private:
+	using SessionPtr = std::unique_ptr<Poco::Net::HTTPSClientSession>;
+
+	struct Idle {
+		SessionPtr session;
+		Poco::Timestamp lastRequest;
+	};
+
+	SessionPtr acquire();
+	void release(SessionPtr session, Poco::Timestamp lastRequest);
+
+	std::string exchange(Poco::Net::HTTPSClientSession& session, Poco::Net::HTTPRequest& request,
+			const std::string& body, Poco::Net::HTTPResponse& response);
+
+	const std::string serverHost;
+	const uint16_t port;
+	Poco::Net::Context::Ptr context;
+	const std::size_t maxIdle;
+	const Poco::Timespan keepAlive;
+
+	std::mutex mutex;
+	std::vector<Idle> idle;
+	Poco::Net::Session::Ptr tlsSession; //last negotiated tls session, resumed by new connections
+
+	Counter& fullHandshakes;
+	Counter& resumedHandshakes;
+	Counter& reusedConnections;
+};
+
+#endif /* SRC_PVLOG_HTTPSSESSIONPOOL_H_ */
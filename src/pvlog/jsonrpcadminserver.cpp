@@ -21,6 +21,7 @@
 #include <odb/query.hxx>
 #include <odb/database.hxx>
 
+#include "databaseexport.h"
 #include "datalogger.h"
 #include "jsonrpcadminserver.h"
 #include "log.h"
@@ -78,9 +79,11 @@ static Json::Value errorToJson(int num ,std::string message) {
 	return value;
 }
 
-JsonRpcAdminServer::JsonRpcAdminServer(jsonrpc::AbstractServerConnector& conn, Datalogger* datalogger, odb::database* db) :
+JsonRpcAdminServer::JsonRpcAdminServer(jsonrpc::AbstractServerConnector& conn, Datalogger* datalogger,
+		DatabaseExport* databaseExport, odb::database* db) :
 		AbstractAdminServer(conn),
 		datalogger(datalogger),
+		databaseExport(databaseExport),
 		db(db) {
 	//nothing to do
 }
@@ -562,3 +565,73 @@ Json::Value JsonRpcAdminServer::sendTestEmail() {
 
 	return result;
 }
+
+static Json::Value rowCountsToJson(const DatabaseExport::RowCounts& rowCounts) {
+	Json::Value result(Json::ValueType::objectValue);
+	for (const auto& entry : rowCounts) {
+		result[entry.first] = static_cast<Json::Int64>(entry.second);
+	}
+
+	return result;
+}
+
+Json::Value JsonRpcAdminServer::backupDatabase(const std::string& file) {
+	Json::Value result;
+
+	try {
+		LOG(Debug) << "JsonRpcAdminServer::backupDatabase: " << file;
+
+		databaseExport->backup(file);
+		result = Json::Value(Json::ValueType::objectValue);
+	} catch (const std::exception &ex) {
+		LOG(Error) << "backupDatabase: " << ex.what();
+		result = errorToJson(-1, "General error!");
+	}
+
+	return result;
+}
+
+Json::Value JsonRpcAdminServer::dumpPacketTrace(const std::string& file) {
+	Json::Value result;
+
+	LOG(Debug) << "JsonRpcAdminServer::dumpPacketTrace: " << file;
+
+	if (pvlib_dump_packet_trace(file.c_str()) < 0) {
+		LOG(Error) << "dumpPacketTrace: could not write " << file;
+		result = errorToJson(-1, "Could not write packet trace!");
+	} else {
+		result = Json::Value(Json::ValueType::objectValue);
+	}
+
+	return result;
+}
+
+Json::Value JsonRpcAdminServer::exportDatabase(const std::string& directory) {
+	Json::Value result;
+
+	try {
+		LOG(Debug) << "JsonRpcAdminServer::exportDatabase: " << directory;
+
+		result = rowCountsToJson(databaseExport->exportCsv(directory));
+	} catch (const std::exception &ex) {
+		LOG(Error) << "exportDatabase: " << ex.what();
+		result = errorToJson(-1, "General error!");
+	}
+
+	return result;
+}
+
+Json::Value JsonRpcAdminServer::importDatabase(const std::string& directory) {
+	Json::Value result;
+
+	try {
+		LOG(Debug) << "JsonRpcAdminServer::importDatabase: " << directory;
+
+		result = rowCountsToJson(databaseExport->importCsv(directory));
+	} catch (const std::exception &ex) {
+		LOG(Error) << "importDatabase: " << ex.what();
+		result = errorToJson(-1, "General error!");
+	}
+
+	return result;
+}
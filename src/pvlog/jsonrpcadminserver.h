@@ -21,8 +21,10 @@
 #define SRC_PVLOG_JSONRPCADMINSERVER_H_
 
 #include "abstractadminserver.h"
+#include "databaseaccess.h"
 
 class Datalogger;
+class DatabaseExport;
 namespace odb {
 	class database;
 }
@@ -30,9 +32,14 @@ namespace odb {
 class JsonRpcAdminServer : public AbstractAdminServer {
 private:
 	Datalogger* datalogger;
+	DatabaseExport* databaseExport;
 	odb::database* db;
 public:
-	JsonRpcAdminServer(jsonrpc::AbstractServerConnector& conn, Datalogger* datalogger, odb::database* db);
+	//Admin server modifies plants, inverters and configuration
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::WRITE;
+
+	JsonRpcAdminServer(jsonrpc::AbstractServerConnector& conn, Datalogger* datalogger,
+			DatabaseExport* databaseExport, odb::database* db);
 
 	virtual ~JsonRpcAdminServer();
 
@@ -73,6 +80,18 @@ public:
 	virtual Json::Value getEmail() override;
 
 	virtual Json::Value sendTestEmail() override;
+
+	virtual Json::Value backupDatabase(const std::string& file) override;
+
+	/**
+	 * Write the last frames exchanged with the inverters to file in pcap format,
+	 * also possible while no request failed.
+	 */
+	virtual Json::Value dumpPacketTrace(const std::string& file) override;
+
+	virtual Json::Value exportDatabase(const std::string& directory) override;
+
+	virtual Json::Value importDatabase(const std::string& directory) override;
 };
 
 
@@ -19,16 +19,36 @@
 
 #include "jsonrpcserver.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <limits>
 #include <string>
 
+#include <jsoncpp/json/reader.h>
+#include <jsoncpp/json/writer.h>
+#include <jsonrpccpp/common/errors.h>
+#include <jsonrpccpp/common/exception.h>
 #include <odb/database.hxx>
 #include <odb/query.hxx>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/date_time/c_local_time_adjustor.hpp>
 
+#include "arena.h"
 #include "datalogger.h"
+#include "downsampler.h"
+#include "jsonvaluewriter.h"
+#include "jsonwriter.h"
 #include "log.h"
+#include "metrics.h"
+#include "msgpackwriter.h"
+#include "pvlogexception.h"
+#include "rpcworkerpool.h"
+#include "spotdataarchiver.h"
+#include "spotdatacolumns.h"
 #include "timeutil.h"
 
 #include "models/plant.h"
@@ -41,13 +61,17 @@
 #include "models/event_odb.h"
 #include "models/inverter.h"
 #include "models/inverter_odb.h"
+#include "models/querycache.h"
 
 namespace bg = boost::gregorian;
 namespace pt = boost::posix_time;
 namespace dt = boost::date_time;
 
+typedef boost::date_time::c_local_adjustor<pt::ptime> local_adj;
+
 using model::SpotData;
 using model::SpotDataPtr;
+using model::SpotDataPower;
 using model::Inverter;
 using model::InverterPtr;
 using model::toJson;
@@ -63,8 +87,325 @@ using model::LowNMonth;
 using model::DayStats;
 using model::MonthStats;
 
-JsonRpcServer::JsonRpcServer(jsonrpc::AbstractServerConnector &conn, Datalogger* datalogger, odb::database* database) :
-		AbstractPvlogServer(conn), db(database), datalogger(datalogger) {
+namespace {
+
+/**
+ * Arena of the request served by the calling thread, released by the outermost
+ * util::Arena::Scope of the request.
+ */
+util::Arena& requestArena() {
+	static thread_local util::Arena arena;
+	return arena;
+}
+
+struct TimeRange {
+	pt::ptime begin;
+	pt::ptime end;
+};
+
+struct EventPageParams {
+	int64_t inverterId;
+	pt::ptime begin;
+	pt::ptime end;
+	pt::ptime cursorTime; //(time, id) of the last event of the previous page
+	int cursorId;
+	int32_t number;
+	int64_t limit;
+};
+
+//Position after the last event of a page
+struct EventCursor {
+	int64_t inverterId;
+	int64_t time;
+	int id;
+};
+
+const bg::date FIRST_DATE(bg::min_date_time);
+const bg::date LAST_DATE(bg::max_date_time);
+
+const int64_t DEFAULT_EVENT_PAGE_SIZE = 100;
+const int64_t MAX_EVENT_PAGE_SIZE = 1000;
+
+//about ten years, longer ranges are rejected by getSpotDataRange
+const int MAX_SPOT_DATA_RANGE_DAYS = 3660;
+
+bool hasStrings(const Json::Value& params, std::initializer_list<const char*> names) {
+	for (const char* name : names) {
+		if (!params[name].isString()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Same members as toJson(SpotData), Writer is util::JsonWriter or util::JsonValueWriter
+template<typename Writer>
+void writeSpotDataJson(Writer& writer, const SpotData& sd) {
+	writer.key(std::to_string(pt::to_time_t(sd.time))).beginObject();
+	writer.key("power").value(sd.power);
+	if (sd.frequency) {
+		writer.key("frequency").value(sd.frequency.get());
+	}
+	if (sd.dayYield) {
+		writer.key("dayYield").value(sd.dayYield.get());
+	}
+
+	writer.key("phases");
+	if (sd.phases.empty()) {
+		writer.null();
+	} else {
+		writer.beginObject();
+		for (const auto& entry : sd.phases) { //ordered by number
+			const model::Phase& phase = entry.second;
+			writer.key(std::to_string(entry.first)).beginObject();
+			writer.key("power").value(phase.power);
+			if (phase.voltage) {
+				writer.key("voltage").value(phase.voltage.get());
+			}
+			if (phase.current) {
+				writer.key("current").value(phase.current.get());
+			}
+			writer.endObject();
+		}
+		writer.endObject();
+	}
+
+	writer.key("dc_inputs");
+	if (sd.dcInputs.empty()) {
+		writer.null();
+	} else {
+		writer.beginObject();
+		for (const auto& entry : sd.dcInputs) { //ordered by number
+			const model::DcInput& dcInput = entry.second;
+			writer.key(std::to_string(entry.first)).beginObject();
+			if (dcInput.power) {
+				writer.key("power").value(dcInput.power.get());
+			}
+			if (dcInput.voltage) {
+				writer.key("voltage").value(dcInput.voltage.get());
+			}
+			if (dcInput.current) {
+				writer.key("current").value(dcInput.current.get());
+			}
+			writer.endObject();
+		}
+		writer.endObject();
+	}
+
+	writer.endObject();
+}
+
+void invalidParams(const std::string& message) {
+	throw jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_RPC_INVALID_PARAMS, message);
+}
+
+//The cursor is opaque to clients, hex is enough to keep them from building one
+std::string encodeCursor(const EventCursor& cursor) {
+	static const char DIGITS[] = "0123456789abcdef";
+
+	std::string plain = std::to_string(cursor.inverterId) + ":" + std::to_string(cursor.time) + ":"
+			+ std::to_string(cursor.id);
+	std::string encoded;
+	encoded.reserve(plain.size() * 2);
+	for (unsigned char c : plain) {
+		encoded.push_back(DIGITS[c >> 4]);
+		encoded.push_back(DIGITS[c & 0x0f]);
+	}
+	return encoded;
+}
+
+EventCursor decodeCursor(const std::string& encoded) {
+	auto digit = [](char c) -> int {
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	};
+
+	std::string plain;
+	if (encoded.size() % 2 != 0) {
+		invalidParams("Invalid cursor");
+	}
+	for (std::size_t i = 0; i < encoded.size(); i += 2) {
+		int high = digit(encoded[i]);
+		int low  = digit(encoded[i + 1]);
+		if (high < 0 || low < 0) {
+			invalidParams("Invalid cursor");
+		}
+		plain.push_back(static_cast<char>(high << 4 | low));
+	}
+
+	EventCursor cursor;
+	char rest;
+	long long inverterId, time;
+	if (std::sscanf(plain.c_str(), "%lld:%lld:%d%c", &inverterId, &time, &cursor.id, &rest) != 3) {
+		invalidParams("Invalid cursor");
+	}
+	cursor.inverterId = inverterId;
+	cursor.time       = time;
+	return cursor;
+}
+
+int64_t optionalInt(const Json::Value& params, const char* name, int64_t defaultValue) {
+	const Json::Value& value = params[name];
+	if (value.isNull()) {
+		return defaultValue;
+	} else if (!value.isIntegral()) {
+		invalidParams(std::string("Invalid ") + name);
+	}
+	return value.asInt64();
+}
+
+pt::ptime dayBegin(const bg::date& date) {
+	return util::local_to_utc(pt::ptime(date));
+}
+
+int64_t inverterIdOf(const SpotData& sd) {
+	return sd.inverter->id;
+}
+
+int64_t inverterIdOf(const SpotDataPower& sd) {
+	return sd.inverterId;
+}
+
+template<typename T>
+bool inverterTimeLess(const T& a, const T& b) {
+	return inverterIdOf(a) < inverterIdOf(b) || (inverterIdOf(a) == inverterIdOf(b) && a.time < b.time);
+}
+
+/**
+ * Visit rows, archived and pending samples merged by inverter and time, every
+ * inverter is visited once. Every time is visited once per inverter, rows are
+ * preferred over archived and archived over pending samples with the same time.
+ * Samples flushed while reading are both pending and rows, imported rows may
+ * overlap archives.
+ */
+template<typename T, typename Pending>
+void mergeByInverter(odb::result<T>& rows, ArchivedSpotDataReader<T>& archived, Pending& pending,
+		const std::function<void (int64_t)>& beginInverter, const std::function<void (const T&)>& sample,
+		const std::function<void ()>& endInverter) {
+	std::sort(pending.begin(), pending.end(), inverterTimeLess<T>);
+	std::size_t pendingPos = 0;
+
+	//rows are loaded into one instance instead of a session cached object per row
+	T row;
+	auto rowIt = rows.begin();
+	bool hasRow = (rowIt != rows.end());
+	if (hasRow) {
+		rowIt.load(row);
+	}
+
+	bool open = false;
+	int64_t inverterId = 0;
+	bool visited = false;
+	pt::ptime lastTime;
+	for (;;) {
+		enum { ROW, ARCHIVED, PENDING } source = ROW;
+		const T* next = nullptr;
+		if (hasRow) {
+			next = &row;
+		}
+		if (archived.valid() && (next == nullptr || inverterTimeLess(archived.current(), *next))) {
+			next   = &archived.current();
+			source = ARCHIVED;
+		}
+		if (pendingPos < pending.size() && (next == nullptr || inverterTimeLess(pending[pendingPos], *next))) {
+			next   = &pending[pendingPos];
+			source = PENDING;
+		}
+		if (next == nullptr) {
+			break;
+		}
+
+		if (!open || inverterIdOf(*next) != inverterId) {
+			if (open) {
+				endInverter();
+			}
+			inverterId = inverterIdOf(*next);
+			beginInverter(inverterId);
+			open    = true;
+			visited = false;
+		}
+		if (!visited || next->time != lastTime) {
+			sample(*next);
+			lastTime = next->time;
+			visited  = true;
+		}
+
+		if (source == ROW) {
+			++rowIt;
+			hasRow = (rowIt != rows.end());
+			if (hasRow) {
+				rowIt.load(row);
+			}
+		} else if (source == ARCHIVED) {
+			archived.next();
+		} else {
+			++pendingPos;
+		}
+	}
+	if (open) {
+		endInverter();
+	}
+}
+
+using InverterColumns = std::vector<std::pair<int64_t, SpotDataColumns>>;
+
+//T is SpotDataColumns or Downsampler
+template<typename Writer, typename T>
+void writeInverterSeries(Writer& writer, const std::vector<std::pair<int64_t, T>>& inverters) {
+	if (inverters.empty()) {
+		writer.null();
+		return;
+	}
+
+	writer.beginObject(inverters.size());
+	for (const auto& entry : inverters) {
+		writer.key(std::to_string(entry.first));
+		entry.second.write(writer);
+	}
+	writer.endObject();
+}
+
+std::string toMsgPack(const std::string& json) {
+	Json::Reader reader;
+	Json::Value value;
+	if (!reader.parse(json, value, false)) {
+		PVLOG_EXCEPT("Invalid json: " + reader.getFormattedErrorMessages());
+	}
+
+	std::string result;
+	util::MsgPackWriter(result).value(value);
+	return result;
+}
+
+Json::Value toJson(const RpcWorkerPool::LaneStats& stats) {
+	Json::Value json;
+	json["threads"]        = static_cast<Json::UInt64>(stats.threads);
+	json["queued"]         = static_cast<Json::UInt64>(stats.queued);
+	json["completed"]      = static_cast<Json::UInt64>(stats.completed);
+	json["rejected"]       = static_cast<Json::UInt64>(stats.rejected);
+	json["avgQueueTimeUs"] = static_cast<Json::Int64>(stats.completed != 0 ?
+			stats.queueTime.count() / static_cast<int64_t>(stats.completed) : 0);
+	json["maxQueueTimeUs"] = static_cast<Json::Int64>(stats.maxQueueTime.count());
+	json["avgRunTimeUs"]   = static_cast<Json::Int64>(stats.completed != 0 ?
+			stats.runTime.count() / static_cast<int64_t>(stats.completed) : 0);
+	return json;
+}
+
+bg::date parseDate(const Json::Value& value) {
+	bg::date date = bg::from_simple_string(value.asString());
+	if (date.is_special()) {
+		PVLOG_EXCEPT("Invalid date");
+	}
+	return date;
+}
+
+} //namespace {
+
+JsonRpcServer::JsonRpcServer(jsonrpc::AbstractServerConnector &conn, Datalogger* datalogger, odb::database* database,
+		std::size_t responseCacheSize, std::size_t compressMinSize, const RpcWorkerPool* workerPool) :
+		AbstractPvlogServer(conn), db(database), datalogger(datalogger), workerPool(workerPool),
+		responseCache(responseCacheSize), compressMinSize(compressMinSize) {
 	//Nothing to do
 }
 
@@ -74,39 +415,241 @@ JsonRpcServer::~JsonRpcServer() {
 
 Json::Value JsonRpcServer::getSpotData(const std::string& date) {
 	Json::Value result;
-	using Query  = odb::query<SpotData>;
-	using Result = odb::result<SpotData>;
 
 	try {
-		LOG(Debug) << "JsonRpcServer::getSpotData: " << date;
+		bg::date d = bg::from_simple_string(date);
+		if (d.is_not_a_date()) {
+			return result;
+		}
 
+		//same as writeSpotData, no data stays null
+		util::JsonValueWriter writer(result);
+		bool empty = true;
+		writer.beginObject();
+		visitSpotData(dayBegin(d), dayBegin(d + bg::days(1)),
+				[&](int64_t inverterId) {
+					writer.key(std::to_string(inverterId)).beginObject();
+					empty = false;
+				},
+				[&](const SpotData& sd) { writeSpotDataJson(writer, sd); },
+				[&]() { writer.endObject(); });
+		writer.endObject();
+
+		if (empty) {
+			result = Json::Value();
+		}
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Error getting spot data" <<  ex.what();
+		result = Json::Value();
+	}
+
+	return result;
+}
+
+void JsonRpcServer::getSpotDataI(const Json::Value& request, Json::Value& response) {
+	const Json::Value& format = request["format"];
+	if (format.isNull()) {
+		response = getSpotData(request["date"].asString());
+	} else if (format == "columnar") {
+		response = getColumnarSpotData(request["date"].asString());
+	} else {
+		throw jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_RPC_INVALID_PARAMS, "Unknown format");
+	}
+}
+
+Json::Value JsonRpcServer::getColumnarSpotData(const std::string& date) {
+	Json::Value result;
+
+	try {
 		bg::date d = bg::from_simple_string(date);
 		if (d.is_not_a_date()) {
 			return result;
 		}
 
-		pt::ptime begin = util::local_to_utc(pt::ptime(d));
-		pt::ptime end   = begin + pt::hours(24);
+		util::JsonValueWriter writer(result);
+		writeInverterSeries(writer, readColumnarSpotData(d));
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Error getting columnar spot data" <<  ex.what();
+		result = Json::Value();
+	}
 
-		Query filterData(Query::time >= Query::_ref(begin) && Query::time < Query::_ref(end));
-		Query sortResult("ORDER BY" + Query::inverter + "," + Query::time);
+	return result;
+}
 
-		odb::session session; //Session is needed for SpotData
-		odb::transaction t(db->begin());
-		Result r(db->query<SpotData>(filterData + sortResult));
+Json::Value JsonRpcServer::getSpotDataRange(const std::string& from, const std::string& method, int points,
+		const std::string& to) {
+	Json::Value result;
 
-		for (const SpotData& d : r) {
-			result[std::to_string(d.inverter->id)][std::to_string(pt::to_time_t(d.time))] = toJson(d);
+	try {
+		bg::date fromDate = bg::from_simple_string(from);
+		bg::date toDate   = bg::from_simple_string(to);
+		if (fromDate.is_not_a_date() || toDate.is_not_a_date() || points < 0) {
+			return result;
 		}
-		t.commit();
+
+		util::JsonValueWriter writer(result);
+		writeInverterSeries(writer, readSpotDataRange(fromDate, toDate, points, Downsampler::parseMethod(method)));
 	} catch (const std::exception& ex) {
-		LOG(Error) << "Error getting spot data" <<  ex.what();
+		LOG(Error) << "Error getting spot data range" <<  ex.what();
 		result = Json::Value();
 	}
 
 	return result;
 }
 
+void JsonRpcServer::visitSpotData(pt::ptime begin, pt::ptime end, const std::function<void (int64_t)>& beginInverter,
+		const std::function<void (const SpotData&)>& sample, const std::function<void ()>& endInverter) {
+	using Query = odb::query<SpotData>;
+
+	//copied before the read snapshot of the transaction starts, samples flushed in between are
+	//also read from the database and visited once by mergeByInverter
+	std::vector<SpotData> pending = datalogger->getPendingSpotData(begin, end);
+
+	odb::session session; //Session is needed for SpotData
+	odb::transaction t(db->begin());
+
+	ArchivedSpotDataReader<SpotData> archived(db, begin, end);
+
+	TimeRange* range;
+	odb::prepared_query<SpotData> query(model::cachedQuery<SpotData>("jsonrpc-spot-data", range,
+			[](TimeRange& r) {
+				Query filterData(Query::time >= Query::_ref(r.begin) && Query::time < Query::_ref(r.end));
+				Query sortResult("ORDER BY" + Query::inverter + "," + Query::time);
+				return filterData + sortResult;
+			}));
+	range->begin = begin;
+	range->end   = end;
+
+	odb::result<SpotData> r(query.execute());
+	mergeByInverter(r, archived, pending, beginInverter, sample, endInverter);
+
+	t.commit();
+}
+
+void JsonRpcServer::visitSpotDataPower(pt::ptime begin, pt::ptime end,
+		const std::function<void (int64_t)>& beginInverter, const std::function<void (const SpotDataPower&)>& sample,
+		const std::function<void ()>& endInverter) {
+	using Query = odb::query<SpotDataPower>;
+
+	util::Arena::Scope arenaScope(requestArena());
+
+	//copied before the read snapshot starts, see visitSpotData
+	util::ArenaVector<SpotDataPower> pending{util::ArenaAllocator<SpotDataPower>(requestArena())};
+	for (const SpotData& sd : datalogger->getPendingSpotData(begin, end)) {
+		pending.push_back(SpotDataPower{sd.inverter->id, sd.time, sd.power});
+	}
+
+	odb::session session; //Session is needed for archived SpotData
+	odb::transaction t(db->begin());
+
+	//only time and power of archived chunks are decoded, one chunk at a time
+	ArchivedSpotDataReader<SpotDataPower> archived(db, begin, end);
+
+	TimeRange* range;
+	odb::prepared_query<SpotDataPower> query(model::cachedQuery<SpotDataPower>("jsonrpc-spot-data-power", range,
+			[](TimeRange& r) {
+				Query filterData(Query::SpotData::time >= Query::_ref(r.begin) &&
+						Query::SpotData::time < Query::_ref(r.end));
+				Query sortResult("ORDER BY" + Query::Inverter::id + "," + Query::SpotData::time);
+				return filterData + sortResult;
+			}));
+	range->begin = begin;
+	range->end   = end;
+
+	odb::result<SpotDataPower> r(query.execute());
+	mergeByInverter(r, archived, pending, beginInverter, sample, endInverter);
+
+	t.commit();
+}
+
+void JsonRpcServer::writeSpotData(const bg::date& date, std::string& out) {
+	LOG(Debug) << "JsonRpcServer::writeSpotData: " << date;
+
+	std::size_t offset = out.size();
+	util::JsonWriter writer(out);
+	bool empty = true;
+
+	try {
+		writer.beginObject();
+		visitSpotData(dayBegin(date), dayBegin(date + bg::days(1)),
+				[&](int64_t inverterId) {
+					writer.key(std::to_string(inverterId)).beginObject();
+					empty = false;
+				},
+				[&](const SpotData& sd) { writeSpotDataJson(writer, sd); },
+				[&]() { writer.endObject(); });
+		writer.endObject();
+
+		//no data is returned as null like the Json::Value result
+		if (empty) {
+			out.resize(offset);
+			out += "null";
+		}
+	} catch (...) {
+		out.resize(offset);
+		throw;
+	}
+}
+
+InverterColumns JsonRpcServer::readColumnarSpotData(const bg::date& date) {
+	LOG(Debug) << "JsonRpcServer::readColumnarSpotData: " << date;
+
+	//columns of all inverters are collected, the binary encoding needs the number of inverters first
+	InverterColumns inverters;
+	visitSpotData(dayBegin(date), dayBegin(date + bg::days(1)),
+			[&](int64_t inverterId) { inverters.emplace_back(inverterId, SpotDataColumns()); },
+			[&](const SpotData& sd) { inverters.back().second.add(sd); },
+			[]() { /* nothing to do */ });
+
+	return inverters;
+}
+
+void JsonRpcServer::writeColumnarSpotData(const bg::date& date, ResponseEncoding encoding, std::string& out) {
+	InverterColumns inverters = readColumnarSpotData(date);
+
+	if (encoding == ResponseEncoding::MSGPACK) {
+		util::MsgPackWriter writer(out);
+		writeInverterSeries(writer, inverters);
+	} else {
+		util::JsonWriter writer(out);
+		writeInverterSeries(writer, inverters);
+	}
+}
+
+std::vector<std::pair<int64_t, Downsampler>> JsonRpcServer::readSpotDataRange(const bg::date& from,
+		const bg::date& to, std::size_t points, Downsampler::Method method) {
+	LOG(Debug) << "JsonRpcServer::readSpotDataRange: " << from << "->" << to << ", " << points << " points";
+
+	if (to < from || (to - from).days() >= MAX_SPOT_DATA_RANGE_DAYS) {
+		PVLOG_EXCEPT("Spot data range has to be 1 to " + std::to_string(MAX_SPOT_DATA_RANGE_DAYS) + " days");
+	}
+
+	pt::ptime begin = dayBegin(from);
+	pt::ptime end   = dayBegin(to + bg::days(1));
+
+	//the downsampled series are bounded by points, they are collected for the binary encoding
+	std::vector<std::pair<int64_t, Downsampler>> inverters;
+	visitSpotDataPower(begin, end,
+			[&](int64_t inverterId) { inverters.emplace_back(inverterId, Downsampler(method, begin, end, points)); },
+			[&](const SpotDataPower& sd) { inverters.back().second.add(sd.time, sd.power); },
+			[&]() { inverters.back().second.finish(); });
+
+	return inverters;
+}
+
+void JsonRpcServer::writeSpotDataRange(const bg::date& from, const bg::date& to, std::size_t points,
+		Downsampler::Method method, ResponseEncoding encoding, std::string& out) {
+	std::vector<std::pair<int64_t, Downsampler>> inverters = readSpotDataRange(from, to, points, method);
+
+	if (encoding == ResponseEncoding::MSGPACK) {
+		util::MsgPackWriter writer(out);
+		writeInverterSeries(writer, inverters);
+	} else {
+		util::JsonWriter writer(out);
+		writeInverterSeries(writer, inverters);
+	}
+}
+
 Json::Value JsonRpcServer::getLiveSpotData() {
 	Json::Value result;
 
@@ -130,6 +673,30 @@ Json::Value JsonRpcServer::getDataloggerStatus() {
 	Datalogger::Status status = datalogger->getStatus();
 	result["dataloggerStatus"] = status;
 
+	ResponseCache::Stats cacheStats = responseCache.stats();
+	Json::Value cache;
+	cache["hits"]          = static_cast<Json::UInt64>(cacheStats.hits);
+	cache["misses"]        = static_cast<Json::UInt64>(cacheStats.misses);
+	cache["evictions"]     = static_cast<Json::UInt64>(cacheStats.evictions);
+	cache["invalidations"] = static_cast<Json::UInt64>(cacheStats.invalidations);
+	cache["entries"]       = static_cast<Json::UInt64>(cacheStats.entries);
+	cache["bytes"]         = static_cast<Json::UInt64>(cacheStats.bytes);
+	result["responseCache"] = cache;
+
+	SingleFlight::Stats flightStats = singleFlight.stats();
+	Json::Value flights;
+	flights["computed"] = static_cast<Json::UInt64>(flightStats.computed);
+	flights["shared"]   = static_cast<Json::UInt64>(flightStats.shared);
+	flights["inFlight"] = static_cast<Json::UInt64>(flightStats.inFlight);
+	result["singleFlight"] = flights;
+
+	result["metrics"] = MetricsRegistry::instance().toJson();
+
+	if (workerPool != nullptr) {
+		result["rpcWorkers"]["fast"] = toJson(workerPool->stats(RpcWorkerPool::Lane::FAST));
+		result["rpcWorkers"]["slow"] = toJson(workerPool->stats(RpcWorkerPool::Lane::SLOW));
+	}
+
 	return result;
 }
 
@@ -401,7 +968,9 @@ Json::Value JsonRpcServer::getEvents() {
 		odb::session session;
 		odb::transaction t(db->begin());
 		Result r(db->query<Event>("ORDER BY" + Query::inverter + "," + Query::time  + "DESC"));
-		for (const Event e : r) {
+		Event e; //one instance for all rows, its message keeps the capacity
+		for (Result::iterator it = r.begin(); it != r.end(); ++it) {
+			it.load(e);
 			result[std::to_string(e.inverter->id)].append(toJson(e));
 		}
 		t.commit();
@@ -412,3 +981,317 @@ Json::Value JsonRpcServer::getEvents() {
 
 	return result;
 }
+
+void JsonRpcServer::getEventsI(const Json::Value& request, Json::Value& response) {
+	if (!request.isObject() || request.empty()) {
+		response = getEvents();
+	} else {
+		response = getEventPage(request);
+	}
+}
+
+Json::Value JsonRpcServer::getEventPage(const Json::Value& params) {
+	using Query = odb::query<Event>;
+
+	const int64_t MAX_TIME = pt::to_time_t(pt::ptime(LAST_DATE));
+	int64_t from  = optionalInt(params, "from", 0);
+	int64_t to    = optionalInt(params, "to", MAX_TIME);
+	int64_t limit = optionalInt(params, "limit", DEFAULT_EVENT_PAGE_SIZE);
+	if (from < 0 || to > MAX_TIME || from > to) {
+		invalidParams("Invalid time range");
+	}
+	if (limit <= 0 || limit > MAX_EVENT_PAGE_SIZE) {
+		invalidParams("Invalid limit");
+	}
+	bool filterNumber = !params["number"].isNull();
+	int32_t number = static_cast<int32_t>(optionalInt(params, "number", 0));
+	bool filterInverter = !params["inverter"].isNull();
+	int64_t inverterId = optionalInt(params, "inverter", 0);
+
+	//start after the cursor or with the newest event of the first inverter
+	EventCursor cursor{std::numeric_limits<int64_t>::min(), to, std::numeric_limits<int>::max()};
+	if (!params["cursor"].isNull()) {
+		if (!params["cursor"].isString()) {
+			invalidParams("Invalid cursor");
+		}
+		cursor = decodeCursor(params["cursor"].asString());
+		if (cursor.time < from || cursor.time > to) {
+			invalidParams("Invalid cursor");
+		}
+	}
+
+	Json::Value result;
+	try {
+		LOG(Debug) << "JsonRpcServer::getEventPage";
+
+		util::Arena::Scope arenaScope(requestArena());
+		odb::session session;
+		odb::transaction t(db->begin());
+
+		util::ArenaVector<int64_t> inverterIds{util::ArenaAllocator<int64_t>(requestArena())};
+		if (filterInverter) {
+			inverterIds.push_back(inverterId);
+		} else {
+			for (const Inverter& inverter : db->query<Inverter>("ORDER BY" + odb::query<Inverter>::id)) {
+				inverterIds.push_back(inverter.id);
+			}
+		}
+
+		//Events of one inverter newest first, a backward seek on event_inverter_time_i
+		auto makeQuery = [filterNumber](EventPageParams& p) {
+			Query filterEvents(Query::inverter == Query::_ref(p.inverterId) &&
+					Query::time >= Query::_ref(p.begin) && Query::time < Query::_ref(p.end) &&
+					Query::time <= Query::_ref(p.cursorTime) &&
+					(Query::time < Query::_ref(p.cursorTime) || Query::id < Query::_ref(p.cursorId)));
+			if (filterNumber) {
+				filterEvents = filterEvents && Query::number == Query::_ref(p.number);
+			}
+			Query sortResult("ORDER BY" + Query::time + "DESC," + Query::id + "DESC LIMIT" + Query::_ref(p.limit));
+			return filterEvents + sortResult;
+		};
+		EventPageParams* p;
+		odb::prepared_query<Event> query(model::cachedQuery<Event>(
+				filterNumber ? "jsonrpc-event-page-number" : "jsonrpc-event-page", p, makeQuery));
+		p->begin  = pt::from_time_t(from);
+		p->end    = pt::from_time_t(to);
+		p->number = number;
+
+		Json::Value& events = result["events"] = Json::Value(Json::arrayValue);
+		result["cursor"] = Json::Value();
+
+		int64_t remaining = limit;
+		for (auto it = inverterIds.begin(); it != inverterIds.end(); ++it) {
+			if (*it < cursor.inverterId) {
+				continue;
+			}
+
+			bool continued = (*it == cursor.inverterId);
+			p->inverterId  = *it;
+			p->cursorTime  = pt::from_time_t(continued ? cursor.time : to);
+			p->cursorId    = continued ? cursor.id : std::numeric_limits<int>::max();
+			p->limit       = remaining + 1; //one more to know if there is a next page
+
+			int64_t count = 0;
+			odb::result<Event> rows(query.execute());
+			Event e; //one instance for all rows of the inverter
+			for (auto row = rows.begin(); row != rows.end(); ++row) {
+				row.load(e);
+				if (count == remaining) {
+					result["cursor"] = encodeCursor(cursor);
+					break;
+				}
+
+				Json::Value event = toJson(e);
+				event["inverter"] = static_cast<Json::Int64>(*it);
+				events.append(event);
+				cursor = EventCursor{*it, pt::to_time_t(e.time), e.id};
+				++count;
+			}
+
+			remaining -= count;
+			if (remaining == 0) {
+				if (result["cursor"].isNull() && std::next(it) != inverterIds.end()) {
+					result["cursor"] = encodeCursor(cursor);
+				}
+				break;
+			}
+		}
+
+		t.commit();
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Error getting events" << ex.what();
+		result = Json::Value();
+	}
+
+	return result;
+}
+
+bool JsonRpcServer::resultSource(const std::string& method, const Json::Value& params, ResponseEncoding encoding,
+		ResultSource& source) {
+	//key is built from the normalized parameters
+	std::string& key = source.key;
+	bg::date& first  = source.first;
+	bg::date& last   = source.last;
+	source.native    = false;
+
+	try {
+		if (method == "getSpotData" && hasStrings(params, {"date"})) {
+			const Json::Value& format = params["format"];
+			if (!format.isNull() && format != "columnar") {
+				return false;
+			}
+
+			first = last = parseDate(params["date"]);
+			key   = method + "/" + bg::to_iso_extended_string(first);
+			if (format == "columnar") {
+				key   += "/columnar";
+				source.native = true;
+				source.write  = [this, first, encoding](std::string& out) { writeColumnarSpotData(first, encoding, out); };
+			} else {
+				source.write  = [this, first](std::string& out) { writeSpotData(first, out); };
+			}
+		} else if (method == "getSpotDataRange" && hasStrings(params, {"from", "to", "method"})
+				&& params["points"].isIntegral() && params["points"].asInt64() >= 0) {
+			first = parseDate(params["from"]);
+			last  = parseDate(params["to"]);
+			std::size_t points = params["points"].asUInt();
+			Downsampler::Method downsampling = Downsampler::parseMethod(params["method"].asString());
+			key   = method + "/" + bg::to_iso_extended_string(first) + "/" + bg::to_iso_extended_string(last)
+					+ "/" + std::to_string(points) + "/" + params["method"].asString();
+			source.native = true;
+			source.write  = [this, first, last, points, downsampling, encoding](std::string& out) {
+				writeSpotDataRange(first, last, points, downsampling, encoding, out);
+			};
+		} else if (method == "getDayData" && hasStrings(params, {"from", "to"})) {
+			first = parseDate(params["from"]);
+			last  = parseDate(params["to"]);
+			key   = method + "/" + bg::to_iso_extended_string(first) + "/" + bg::to_iso_extended_string(last);
+			source.call  = [this, first, last]() {
+				return getDayData(bg::to_iso_extended_string(first), bg::to_iso_extended_string(last));
+			};
+		} else if (method == "getDayStats" && hasStrings(params, {"from", "to"})) {
+			//statistics over all years
+			bg::date from = parseDate(params["from"]);
+			bg::date to   = parseDate(params["to"]);
+			first = FIRST_DATE;
+			last  = LAST_DATE;
+			key   = method + "/" + bg::to_iso_extended_string(from) + "/" + bg::to_iso_extended_string(to);
+			source.call  = [this, from, to]() {
+				return getDayStats(bg::to_iso_extended_string(from), bg::to_iso_extended_string(to));
+			};
+		} else if (method == "getMonthData" && hasStrings(params, {"year"})) {
+			int year = std::stoi(params["year"].asString());
+			first = bg::date(year, 1, 1);
+			last  = bg::date(year, 12, 31);
+			key   = method + "/" + std::to_string(year);
+			source.call  = [this, year]() { return getMonthData(std::to_string(year)); };
+		} else if (method == "getStatistics") {
+			first = FIRST_DATE;
+			last  = LAST_DATE;
+			key   = method;
+			source.call  = [this]() { return getStatistics(); };
+		} else if (method == "getYearData") {
+			first = FIRST_DATE;
+			last  = LAST_DATE;
+			key   = method;
+			source.call  = [this]() { return getYearData(); };
+		} else {
+			return false;
+		}
+	} catch (const std::exception& ex) {
+		LOG(Debug) << "Not using response cache for " << method << ": " << ex.what();
+		return false;
+	}
+
+	if (encoding == ResponseEncoding::MSGPACK) {
+		key = "msgpack:" + key;
+	}
+
+	return true;
+}
+
+
+PayloadPtr JsonRpcServer::cachedResult(const std::string& method, const Json::Value& params,
+		ResponseEncoding encoding) {
+	ResultSource source;
+	if (!resultSource(method, params, encoding, source)) {
+		return nullptr;
+	}
+
+	ResponseCache::Value cached = responseCache.get(source.key);
+	if (cached != nullptr) {
+		LOG(Trace) << "Response cache hit: " << source.key;
+	}
+	return cached;
+}
+
+PayloadPtr JsonRpcServer::serializedResult(const std::string& method, const Json::Value& params,
+		ResponseEncoding encoding) {
+	ResultSource source;
+	if (!resultSource(method, params, encoding, source)) {
+		return nullptr;
+	}
+	const std::string& key = source.key;
+	bool binary = (encoding == ResponseEncoding::MSGPACK);
+
+	ResponseCache::Value cached = responseCache.get(key);
+	if (cached != nullptr) {
+		LOG(Trace) << "Response cache hit: " << key;
+		return cached;
+	}
+
+	//Concurrent identical requests wait for the first one and share its result.
+	//Only computations started after the last invalidation are joined.
+	uint64_t generation = responseCache.generation();
+	bool shared = true;
+	SingleFlight::Result result = singleFlight.run(key + "@" + std::to_string(generation), [&]() {
+		shared = false;
+
+		auto startTime = std::chrono::steady_clock::now();
+		std::string serialized;
+		bool valid = true;
+
+		try {
+			if (source.write) {
+				source.write(serialized);
+			} else {
+				Json::Value value = source.call();
+
+				Json::FastWriter writer;
+				serialized = writer.write(value);
+				serialized.pop_back(); //FastWriter appends a newline
+
+				//errors are returned as null
+				valid = !value.isNull();
+			}
+
+			if (binary && !source.native) {
+				serialized = toMsgPack(serialized);
+			}
+		} catch (const std::exception& ex) {
+			LOG(Error) << "Error writing " << method << ": " << ex.what();
+			serialized.clear();
+			if (binary) {
+				util::MsgPackWriter(serialized).null();
+			} else {
+				serialized = "null";
+			}
+			valid = false;
+		}
+
+		auto encodeTime = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - startTime);
+		LOG(Debug) << "Encoded " << key << ": " << serialized.size() << " bytes in " << encodeTime.count() << "us";
+
+		//results of past days rarely change, compress them once for all later responses
+		bool precompress = valid && serialized.size() >= compressMinSize && source.last < bg::day_clock::local_day();
+		PayloadPtr payload = makePayload(std::move(serialized), precompress);
+		if (valid) {
+			responseCache.put(key, payload, source.first, source.last, generation);
+		}
+
+		return payload;
+	});
+
+	if (shared) {
+		LOG(Trace) << "Shared in-flight result: " << key;
+	}
+
+	return result;
+}
+
+void JsonRpcServer::spotDataChanged(const std::vector<SpotData>& spotDatas) {
+	for (const SpotData& sd : spotDatas) {
+		responseCache.invalidate(local_adj::utc_to_local(sd.time).date());
+	}
+}
+
+void JsonRpcServer::dayDataChanged(const std::vector<DayData>& dayDatas) {
+	for (const DayData& dd : dayDatas) {
+		responseCache.invalidate(dd.date);
+	}
+}
+
+void JsonRpcServer::dataImported() {
+	responseCache.invalidateAll();
+}
@@ -20,14 +20,24 @@
 #ifndef SRC_JSONRPCSERVER_H_
 #define SRC_JSONRPCSERVER_H_
 
+#include <functional>
 #include <unordered_map>
+#include <vector>
 
 #include <abstractpvlogserver.h>
+#include <databaseaccess.h>
+#include <downsampler.h>
 #include <inverter.h>
+#include <responsecache.h>
+#include <responseencoding.h>
+#include <singleflight.h>
+#include <spotdatacolumns.h>
 
+#include <daydata.h>
 #include <spotdata.h>
 
 class Datalogger;
+class RpcWorkerPool;
 
 namespace odb {
 	class database;
@@ -38,13 +48,113 @@ class JsonRpcServer: public AbstractPvlogServer {
 	using InverterSpotData = std::unordered_map<model::InverterPtr, std::vector<model::SpotDataPtr>>;
 
 	Datalogger* datalogger;
+	const RpcWorkerPool* workerPool;
+	ResponseCache responseCache;
+	SingleFlight singleFlight;
+	std::size_t compressMinSize;
+
+	//How to produce the result of a cacheable method
+	struct ResultSource {
+		std::string key;
+		boost::gregorian::date first; //dates the result depends on
+		boost::gregorian::date last;
+		std::function<Json::Value ()> call;
+		std::function<void (std::string&)> write;
+		bool native; //write produces the requested encoding, json otherwise
+	};
+
+	bool resultSource(const std::string& method, const Json::Value& params, ResponseEncoding encoding,
+			ResultSource& source);
 
 	InverterSpotData readSpotData(const boost::gregorian::date& date);
+
+	/**
+	 * Visit spot data with begin <= time < end from the database, the archive and
+	 * the write buffer merged by inverter and ordered by time.
+	 */
+	void visitSpotData(boost::posix_time::ptime begin, boost::posix_time::ptime end,
+			const std::function<void (int64_t)>& beginInverter,
+			const std::function<void (const model::SpotData&)>& sample, const std::function<void ()>& endInverter);
+
+	/**
+	 * Same as visitSpotData, without loading phases and dc inputs. Memory usage does
+	 * not depend on the time range, archives are decoded one chunk at a time.
+	 */
+	void visitSpotDataPower(boost::posix_time::ptime begin, boost::posix_time::ptime end,
+			const std::function<void (int64_t)>& beginInverter,
+			const std::function<void (const model::SpotDataPower&)>& sample,
+			const std::function<void ()>& endInverter);
+
+	/**
+	 * Append spot data of date as json to out, streamed from the result cursor.
+	 */
+	void writeSpotData(const boost::gregorian::date& date, std::string& out);
+
+	/**
+	 * Spot data of date in columnar layout, one SpotDataColumns per inverter.
+	 */
+	std::vector<std::pair<int64_t, SpotDataColumns>> readColumnarSpotData(const boost::gregorian::date& date);
+
+	/**
+	 * Append spot data of date in columnar layout (see SpotDataColumns) to out.
+	 */
+	void writeColumnarSpotData(const boost::gregorian::date& date, ResponseEncoding encoding, std::string& out);
+
+	/**
+	 * Power of all inverters from the start of day from to the end of day to,
+	 * downsampled to points per inverter. Throws PvlogException for ranges
+	 * longer than about ten years.
+	 */
+	std::vector<std::pair<int64_t, Downsampler>> readSpotDataRange(const boost::gregorian::date& from,
+			const boost::gregorian::date& to, std::size_t points, Downsampler::Method method);
+
+	/**
+	 * Append the result of readSpotDataRange to out.
+	 */
+	void writeSpotDataRange(const boost::gregorian::date& from, const boost::gregorian::date& to,
+			std::size_t points, Downsampler::Method method, ResponseEncoding encoding, std::string& out);
+
+	Json::Value getColumnarSpotData(const std::string& date);
+
+	/**
+	 * Page of events filtered by time range [from, to), inverter and event number,
+	 * ordered by inverter and newest first. Continues after cursor if given.
+	 */
+	Json::Value getEventPage(const Json::Value& params);
 public:
-	JsonRpcServer(jsonrpc::AbstractServerConnector &conn, Datalogger* datalogger, odb::database* database);
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::READ;
+
+	JsonRpcServer(jsonrpc::AbstractServerConnector &conn, Datalogger* datalogger, odb::database* database,
+			std::size_t responseCacheSize, std::size_t compressMinSize, const RpcWorkerPool* workerPool);
 	virtual ~JsonRpcServer();
 
+	/**
+	 * Serialized result of method for cacheable methods. Returns nullptr if
+	 * method has no cached path or params are invalid, the request has to be
+	 * handled by the json-rpc-cpp handler then.
+	 *
+	 * Results of past days of at least compressMinSize bytes are precompressed.
+	 */
+	PayloadPtr serializedResult(const std::string& method, const Json::Value& params, ResponseEncoding encoding);
+
+	/**
+	 * Same as serializedResult but only for results in the response cache,
+	 * never accesses the database.
+	 */
+	PayloadPtr cachedResult(const std::string& method, const Json::Value& params, ResponseEncoding encoding);
+
+	//Invalidate cached results depending on changed data
+	void spotDataChanged(const std::vector<model::SpotData>& spotDatas);
+	void dayDataChanged(const std::vector<model::DayData>& dayDatas);
+	void dataImported();
+
+	//optional param format: "columnar" returns the columnar layout of SpotDataColumns.
+	//Optional params are not in jsonrpc-interface.json, jsonrpcstub would make them required.
+	virtual void getSpotDataI(const Json::Value& request, Json::Value& response) override;
+
 	virtual Json::Value getSpotData(const std::string& date) override;
+	virtual Json::Value getSpotDataRange(const std::string& from, const std::string& method, int points,
+			const std::string& to) override;
 	virtual Json::Value getStatistics() override;
 	virtual Json::Value getLiveSpotData() override;
 	virtual Json::Value getDataloggerStatus() override;
@@ -55,6 +165,10 @@ public:
 	virtual Json::Value getYearData() override;
 	virtual Json::Value getInverters() override;
 	virtual Json::Value getPlants() override;
+	//optional params cursor, from, inverter, limit, number, to return a page of events,
+	//see getEventPage. Without params the events of all inverters are keyed by inverter id.
+	virtual void getEventsI(const Json::Value& request, Json::Value& response) override;
+
 	virtual Json::Value getEvents() override;
 };
 
@@ -0,0 +1,189 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "livestream.h"
+
+#include <algorithm>
+
+#include <jsoncpp/json/writer.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "log.h"
+
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+
+namespace {
+
+//samples older than this are not part of a snapshot, same as getLiveSpotData
+const pt::time_duration MAX_AGE = pt::minutes(5);
+
+std::string frame(uint64_t sequence, const char* event, const Json::Value& data) {
+	Json::FastWriter writer;
+	std::string json = writer.write(data);
+	json.pop_back(); //FastWriter appends a newline
+
+	return "id: " + std::to_string(sequence) + "\nevent: " + event + "\ndata: " + json + "\n\n";
+}
+
+} //namespace {
+
+LiveStream::LiveStream(std::size_t maxSubscribers, std::size_t queueSize) :
+		maxSubscribers(maxSubscribers),
+		queueSize(std::max<std::size_t>(queueSize, 1)),
+		closed(false),
+		sequence(0),
+		snapshotSequence(0),
+		resyncs(0) {
+	//nothing to do
+}
+
+LiveStream::~LiveStream() {
+	close();
+}
+
+void LiveStream::publish(const SpotData& spotData) {
+	Json::Value data;
+	data[std::to_string(spotData.inverter->id)][std::to_string(pt::to_time_t(spotData.time))] = toJson(spotData);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	latest[spotData.inverter->id] = spotData;
+
+	//serialized once, shared by all subscribers
+	Frame f = std::make_shared<const std::string>(frame(++sequence, "spotData", data));
+
+	recentFrames.emplace_back(sequence, f);
+	if (recentFrames.size() > queueSize) {
+		recentFrames.pop_front();
+	}
+
+	for (const auto& subscription : subscriptions) {
+		if (subscription->resync) {
+			continue; //gets a snapshot anyway
+		}
+
+		if (subscription->frames.size() >= queueSize) {
+			subscription->frames.clear();
+			subscription->resync = true;
+			++resyncs;
+		} else {
+			subscription->frames.push_back(f);
+		}
+	}
+
+	frameAvailable.notify_all();
+}
+
+LiveStream::Frame LiveStream::snapshot() {
+	if (snapshotFrame && snapshotSequence == sequence) {
+		return snapshotFrame;
+	}
+
+	Json::Value data(Json::objectValue);
+	pt::ptime now = pt::second_clock::universal_time();
+	for (const auto& entry : latest) {
+		const SpotData& sd = entry.second;
+		if (now - sd.time < MAX_AGE) {
+			data[std::to_string(entry.first)][std::to_string(pt::to_time_t(sd.time))] = toJson(sd);
+		}
+	}
+
+	snapshotFrame    = std::make_shared<const std::string>(frame(sequence, "snapshot", data));
+	snapshotSequence = sequence;
+	return snapshotFrame;
+}
+
+std::shared_ptr<LiveStream::Subscription> LiveStream::subscribe(const std::string& lastEventId) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (closed || subscriptions.size() >= maxSubscribers) {
+		return nullptr;
+	}
+
+	auto subscription = std::make_shared<Subscription>();
+	subscription->resync = true;
+
+	if (!lastEventId.empty()) {
+		try {
+			uint64_t last = std::stoull(lastEventId);
+			//missed frames are only replayed if none of them was dropped
+			if (last == sequence || (!recentFrames.empty() && recentFrames.front().first <= last + 1
+					&& last < sequence)) {
+				for (const auto& entry : recentFrames) {
+					if (entry.first > last) {
+						subscription->frames.push_back(entry.second);
+					}
+				}
+				subscription->resync = false;
+			}
+		} catch (const std::exception&) {
+			LOG(Debug) << "Invalid Last-Event-ID: " << lastEventId;
+		}
+	}
+
+	subscriptions.push_back(subscription);
+	LOG(Debug) << "Live stream subscribed, " << subscriptions.size() << " subscribers";
+
+	return subscription;
+}
+
+void LiveStream::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	subscriptions.remove(subscription);
+	LOG(Debug) << "Live stream unsubscribed, " << subscriptions.size() << " subscribers";
+}
+
+bool LiveStream::wait(Subscription& subscription, std::vector<Frame>& frames, std::chrono::milliseconds timeout) {
+	frames.clear();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	frameAvailable.wait_for(lock, timeout, [&]() {
+		return closed || subscription.resync || !subscription.frames.empty();
+	});
+
+	if (closed) {
+		return false;
+	}
+
+	if (subscription.resync) {
+		frames.push_back(snapshot());
+		subscription.resync = false;
+	} else {
+		frames.assign(subscription.frames.begin(), subscription.frames.end());
+		subscription.frames.clear();
+	}
+
+	return true;
+}
+
+void LiveStream::close() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	closed = true;
+	frameAvailable.notify_all();
+}
+
+LiveStream::Stats LiveStream::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return Stats{subscriptions.size(), sequence, resyncs};
+}
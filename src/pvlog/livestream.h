@@ -0,0 +1,116 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_LIVESTREAM_H_
+#define SRC_PVLOG_LIVESTREAM_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utility.h"
+
+#include "models/spotdata.h"
+
+/**
+ * Pushes live spot data to subscribers as server-sent events.
+ *
+ * Every published sample is serialized once into a frame that is shared by
+ * all subscribers. A frame contains only the new sample (event spotData), new
+ * subscribers first get the latest sample of every inverter (event snapshot).
+ * Data has the same format as getLiveSpotData.
+ *
+ * Every subscriber has a bounded queue. If a slow subscriber falls behind by
+ * more than queueSize frames its queue is dropped and it gets a new snapshot
+ * once it catches up, so memory does not grow with slow clients.
+ * Reconnecting clients sending Last-Event-ID get the missed frames if they
+ * are still available, a snapshot otherwise.
+ */
+class LiveStream {
+	DISABLE_COPY(LiveStream)
+public:
+	using Frame = std::shared_ptr<const std::string>;
+
+	class Subscription {
+		friend class LiveStream;
+
+		std::deque<Frame> frames;
+		bool resync = false;
+	};
+
+	struct Stats {
+		std::size_t subscribers;
+		uint64_t published;
+		uint64_t resyncs;
+	};
+
+	LiveStream(std::size_t maxSubscribers, std::size_t queueSize);
+
+	~LiveStream();
+
+	void publish(const model::SpotData& spotData);
+
+	/**
+	 * Returns nullptr if the maximum number of subscribers is reached or the stream is closed.
+	 */
+	std::shared_ptr<Subscription> subscribe(const std::string& lastEventId);
+
+	void unsubscribe(const std::shared_ptr<Subscription>& subscription);
+
+	/**
+	 * Wait for frames of subscription. Returns false if the stream is closed,
+	 * frames is empty if timeout expired.
+	 */
+	bool wait(Subscription& subscription, std::vector<Frame>& frames, std::chrono::milliseconds timeout);
+
+	/**
+	 * Wake up and end all waiting subscribers.
+	 */
+	void close();
+
+	Stats stats() const;
+
+private:
+	Frame snapshot();
+
+	const std::size_t maxSubscribers;
+	const std::size_t queueSize;
+
+	mutable std::mutex mutex;
+	std::condition_variable frameAvailable;
+	bool closed;
+
+	uint64_t sequence;
+	std::unordered_map<int64_t, model::SpotData> latest;
+	std::deque<std::pair<uint64_t, Frame>> recentFrames; //for reconnecting clients
+	Frame snapshotFrame;
+	uint64_t snapshotSequence;
+
+	std::list<std::shared_ptr<Subscription>> subscriptions;
+	uint64_t resyncs;
+};
+
+#endif /* SRC_PVLOG_LIVESTREAM_H_ */
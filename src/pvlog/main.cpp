@@ -17,11 +17,14 @@
  * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 
+#include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/log/trivial.hpp>
@@ -47,15 +50,26 @@
 #include <jsonrpccpp/server/connectors/httpserver.h>
 
 #include "pvlogconfig.h"
+#include "asynclogsink.h"
 #include "configreader.h"
+#include "databaseexport.h"
+#include "databasepool.h"
 #include "datalogger.h"
 #include "jsonrpcadminserver.h"
 #include "jsonrpcserver.h"
+#include "livestream.h"
 #include "log.h"
 #include "emailnotification.h"
 #include "daysummarymessage.h"
+#include "httpserverconnector.h"
 #include "messagefilter.h"
+#include "metrics.h"
 #include "pvoutputuploader.h"
+#include "rpcdispatcher.h"
+#include "rpcworkerpool.h"
+#include "spotdataarchiver.h"
+#include "spotdatabuffer.h"
+#include "sqliteprofile.h"
 
 #include "models/config.h"
 #include "models/config_odb.h"
@@ -71,23 +85,9 @@ namespace bttrivial = boost::log::trivial;
 namespace po = boost::program_options;
 namespace phoenix = boost::phoenix;
 
-static std::unique_ptr<odb::core::database> openDatabase(const std::string& configFile) {
-	LOG(Info) << "Reading database configuration file.";
-	ConfigReader configReader(configFile);
-	configReader.parse();
-
-	std::string databaseType = configReader.getValue("database_type");
-	std::string databaseName = configReader.getValue("database_name");
-	std::string hostname = configReader.getValue("hostname");
-	std::string port = configReader.getValue("port");
-	std::string username = configReader.getValue("username");
-	std::string password = configReader.getValue("password");
-	LOG(Info) << "Successfully parsed database configuration file.";
-
-	LOG(Info) << "Opening/creating database: " << databaseName;
-	return std::unique_ptr<odb::database>(new odb::sqlite::database(databaseName,
-			SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, true));
-}
+//connection threads of the rpc server without live streams, they only parse requests
+//and wait for the worker pool
+static const int RPC_THREADS = 16;
 
 static void createDefaultConfig(odb::database* db) {
 	Config timeout("timeout", "300");
@@ -140,7 +140,20 @@ bool logFilter(const btlog::value_ref<const char*, tag::module_attr>& module,
 	return severity >= targetSeverity && (targetModules.empty() || targetModules.count(moduleName) != 0);
 }
 
-static void initLogging(const std::string& file,  bttrivial::severity_level severity, const std::vector<std::string>& modules) {
+//records below are dropped before any attribute of the pvlib log bridge is set
+static bttrivial::severity_level pvlibLogThreshold = bttrivial::trace;
+
+static boost::shared_ptr<AsyncLogSink> asyncLogSink;
+
+static void stopAsyncLog() {
+	asyncLogSink->stop();
+}
+
+/**
+ * With flushInterval > 0 records are written asynchronously every flushInterval.
+ */
+static void initLogging(const std::string& file,  bttrivial::severity_level severity, const std::vector<std::string>& modules,
+		std::chrono::milliseconds flushInterval, std::size_t queueSize) {
 	btlog::core::get()->add_global_attribute("Module",
 			btattrs::mutable_constant<const char *>("global"));
 	btlog::core::get()->add_global_attribute("File",
@@ -164,7 +177,13 @@ static void initLogging(const std::string& file,  bttrivial::severity_level seve
 	btlog::formatter logFmt = btexpr::format("%1%[%2% %3%:%4%] %5%")
 			% fmtSeverity % fmtTimeStamp % fmtFile % fmtLine % btexpr::message;
 
-	if (!file.empty()) {
+	pvlibLogThreshold = severity;
+
+	if (flushInterval.count() > 0) {
+		asyncLogSink = boost::make_shared<AsyncLogSink>(file, logFmt, queueSize, flushInterval);
+		btlog::core::get()->add_sink(asyncLogSink);
+		std::atexit(stopAsyncLog);
+	} else if (!file.empty()) {
 		auto fsSink = btlog::add_file_log(btkeywords::file_name = file);
 		fsSink->set_formatter(logFmt);
 		fsSink->locked_backend()->auto_flush(true);
@@ -199,6 +218,10 @@ void pvlibLogFunc(const char* module, const char *file, int line, pvlib_log_leve
 		assert("Invalid severity level!");
 	}
 
+	if (sev < pvlibLogThreshold) {
+		return;
+	}
+
 	BOOST_LOG_STREAM_WITH_PARAMS(
 			(boost::log::trivial::logger::get()),
 			(logging::setGetAttrib("Module", module))
@@ -214,12 +237,22 @@ int main(int argc, char **argv) {
 	std::string logPath;
 	std::string configPath;
 	std::vector<std::string> modules;
+	int logFlushInterval;
+	std::size_t logQueueSize;
+	std::string packetTracePath;
 	po::options_description desc("Allowed options");
 	desc.add_options()
 			("help,h", "produce help message")
 			("loglevel,l",po::value<std::string>(&logLevel)->default_value("warning"), "log level can be error, warning, info, debug, trace")
 			("logmodules,m",po::value<std::vector<std::string>>(&modules), "modules logging is enabled default all modules")
 			("logpath,p", po::value<std::string>(&logPath), "log file location")
+			("logflushinterval", po::value<int>(&logFlushInterval)->default_value(0),
+					"milliseconds between asynchronous writes of the log, 0 writes every record immediately")
+			("logqueuesize", po::value<std::size_t>(&logQueueSize)->default_value(8192),
+					"log records queued for asynchronous writing, further records are dropped")
+			("packettrace", po::value<std::string>(&packetTracePath),
+					"file the last inverter packets are written to in pcap format if a request fails, "
+					"the admin rpc dumpPacketTrace writes them on demand")
 			("configpath,c", po::value<std::string>(&configPath)->default_value(CONFIG_FILE), "config file location");
 
 	po::variables_map vm;
@@ -255,46 +288,101 @@ int main(int argc, char **argv) {
 	}
 
 	//Initialize logging
-	initLogging(logPath, logSeverity, modules);
+	initLogging(logPath, logSeverity, modules, std::chrono::milliseconds(logFlushInterval), logQueueSize);
 
 	//Initialize pvlib
 	pvlib_init(pvlibLogFunc, nullptr, pvlibLogSeverity);
+	if (!packetTracePath.empty()) {
+		pvlib_set_packet_trace_file(packetTracePath.c_str());
+	}
 
 
 	//Open and initialize/migrate database
+	LOG(Info) << "Reading database configuration file.";
+	ConfigReader configReader(configPath);
+	configReader.parse();
+	LOG(Info) << "Successfully parsed database configuration file.";
+
 	LOG(Info) << "Opening database.";
-	std::unique_ptr<odb::database> db = openDatabase(configPath);
+	DatabasePool databasePool(SqliteProfile::read(configReader));
 	LOG(Info) << "Successfully opened database.";
 
+	//Serve datalogger status and live data while the database is migrated
+	SpotDataBuffer spotDataBuffer(databasePool.databaseFor<Datalogger>(), SpotDataBuffer::Settings::read(configReader));
+	Datalogger datalogger(databasePool.databaseFor<Datalogger>(), &spotDataBuffer);
+
+	std::size_t liveMaxClients = configReader.getSizeValue("live_max_clients", "8", 0, 1024);
+	LiveStream liveStream(liveMaxClients, configReader.getSizeValue("live_queue_size", "16", 1, 65536));
+	datalogger.liveDataSig.connect(std::bind(&LiveStream::publish, &liveStream, std::placeholders::_1));
+
+	RpcWorkerPool rpcWorkerPool(configReader.getSizeValue("rpc_fast_threads", "2", 1, 256),
+			configReader.getSizeValue("rpc_slow_threads", "2", 1, 256),
+			configReader.getSizeValue("rpc_max_queued", "64", 1, 65536));
+
+	//start json server
+	std::size_t compressMinSize = configReader.getSizeValue("http_compress_min_size", "1024", 0,
+			std::numeric_limits<std::size_t>::max());
+	std::size_t maxRequestSize = configReader.getSizeValue("http_max_request_size", "1048576", 1024,
+			1024 * 1024 * 1024);
+	HttpServerConnector httpserver(8383, RPC_THREADS + liveMaxClients, compressMinSize, maxRequestSize);
+	httpserver.setLiveStream(&liveStream);
+	JsonRpcServer server(httpserver, &datalogger, databasePool.databaseFor<JsonRpcServer>(),
+			configReader.getSizeValue("response_cache_size", "4194304", 0, 1024 * 1024 * 1024), compressMinSize, &rpcWorkerPool);
+	RpcDispatcher rpcDispatcher(httpserver, &server, &rpcWorkerPool);
+	datalogger.spotDataSig.connect(std::bind(&JsonRpcServer::spotDataChanged, &server, std::placeholders::_1));
+	datalogger.dayDataSig.connect(std::bind(&JsonRpcServer::dayDataChanged, &server, std::placeholders::_1));
+	//scoped, spotDataBuffer flushes once more when it is destroyed after server
+	boost::signals2::scoped_connection flushConnection(spotDataBuffer.flushSig.connect(
+			std::bind(&JsonRpcServer::spotDataChanged, &server, std::placeholders::_1)));
+	server.StartListening();
+
 	//Initialze/migrate database
-	if (initDatabase(db.get()) < 0) {
+	auto databaseStart = std::chrono::steady_clock::now();
+	if (initDatabase(databasePool.writer()) < 0) {
+		server.StopListening();
 		return EXIT_FAILURE;
 	}
+	optimizeDatabase(databasePool.writer());
+
+	//Commit spot data left in the journal by a crash or power loss
+	spotDataBuffer.recover();
 
-	Datalogger datalogger(db.get());
-	DaySummaryMessage daySummaryMessage(db.get());
-	EmailNotification emailNotification(db.get());
-	PvoutputUploader pvoutputUploader(db.get());
+	rpcDispatcher.setDatabaseReady();
+	MetricsRegistry::instance().gauge("pvlog_startup_database_milliseconds",
+			"Time to migrate the database and recover the spot data journal at startup").set(
+			std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - databaseStart).count());
+	LOG(Info) << "Database ready.";
+
+	DaySummaryMessage daySummaryMessage(databasePool.databaseFor<DaySummaryMessage>());
+	EmailNotification emailNotification(databasePool.databaseFor<EmailNotification>(),
+			EmailNotification::Settings::read(configReader));
+	PvoutputUploader pvoutputUploader(databasePool.databaseFor<PvoutputUploader>(),
+			PvoutputUploader::Settings::read(configReader));
 
 	datalogger.dayEndSig.connect(std::bind(&DaySummaryMessage::generateDaySummaryMessage, &daySummaryMessage));
+	SpotDataArchiver spotDataArchiver(databasePool.databaseFor<SpotDataArchiver>(),
+			configReader.getSizeValue("archive_after_days", "0", 0, 36600));
+	datalogger.dayEndSig.connect(std::bind(&SpotDataArchiver::archive, &spotDataArchiver));
+	datalogger.dayEndSig.connect(std::bind(&optimizeDatabase, databasePool.writer()));
 	daySummaryMessage.newDaySummarySignal.connect(std::bind(&EmailNotification::sendMessage,
 			&emailNotification, std::placeholders::_1));
 
 	MessageFilter messageFilter;
 	datalogger.errorSig.connect(std::bind(&MessageFilter::addMessage, &messageFilter, std::placeholders::_1));
-	messageFilter.newMessageSignal.connect(std::bind(&EmailNotification::sendMessage,
+	messageFilter.newMessageSignal.connect(std::bind(&EmailNotification::sendError,
 			&emailNotification, std::placeholders::_1));
 
 	datalogger.spotDataSig.connect(std::bind(&PvoutputUploader::uploadSpotData,
 			&pvoutputUploader, std::placeholders::_1));
+	datalogger.dayEndSig.connect(std::bind(&PvoutputUploader::flush, &pvoutputUploader));
 
-	//start json server
-	jsonrpc::HttpServer httpserver(8383);
-	JsonRpcServer server(httpserver, &datalogger, db.get());
-	server.StartListening();
+	DatabaseExport databaseExport(&databasePool);
+	databaseExport.importSig.connect(std::bind(&JsonRpcServer::dataImported, &server));
 
-	jsonrpc::HttpServer adminHttpserver(8384);
-	JsonRpcAdminServer adminServer(adminHttpserver, &datalogger, db.get());
+	//admin requests are rare but long running (backup, export), they do not need many threads
+	jsonrpc::HttpServer adminHttpserver(8384, "", "", configReader.getSizeValue("admin_rpc_threads", "2", 1, 64));
+	JsonRpcAdminServer adminServer(adminHttpserver, &datalogger, &databaseExport,
+			databasePool.databaseFor<JsonRpcAdminServer>());
 	adminServer.StartListening();
 
 
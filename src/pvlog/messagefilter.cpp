@@ -19,24 +19,145 @@
 
 #include "messagefilter.h"
 
-#include <ctime>
+#include <algorithm>
 
-MessageFilter::MessageFilter(time_t timeout) : timeout(timeout) {
-	//nothing to do
+const std::size_t MessageFilter::SLOTS;
+const uint32_t MessageFilter::NIL;
+
+MessageFilter::MessageFilter(time_t timeout, std::size_t capacity) :
+		tickLength(std::max<Clock::duration>(std::chrono::seconds(timeout) / SLOTS, Clock::duration(1))),
+		start(Clock::now()),
+		currentTick(0),
+		entries(std::max<std::size_t>(capacity, 1)),
+		slots(SLOTS, NIL),
+		freeList(0),
+		lruHead(NIL),
+		lruTail(NIL) {
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		entries[i].lruNext = (i + 1 < entries.size()) ? i + 1 : NIL;
+	}
+	index.reserve(entries.size());
+}
+
+uint64_t MessageFilter::hash(const std::string& message) {
+	//FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for (char c : message) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ULL;
+	}
+	return h;
 }
 
 void MessageFilter::addMessage(const std::string& message) {
-	auto it = messages.find(message);
-	time_t curTime = time(nullptr);
+	addMessage(message, Clock::now());
+}
 
-	if (it == messages.end()) {
-		messages.emplace(message, curTime);
-		newMessageSignal(message);
-	} else {
-		time_t t = it->second;
-		if (curTime - t > timeout) {
-			it->second = curTime;
-			newMessageSignal(message);
+void MessageFilter::addMessage(const std::string& message, Clock::time_point now) {
+	advance(std::max<Clock::duration>(now - start, Clock::duration(0)) / tickLength);
+
+	uint64_t key = hash(message);
+	auto it = index.find(key);
+	if (it != index.end()) {
+		//still suppressed, only its lru position changes
+		unlinkLru(it->second);
+		linkLru(it->second);
+		return;
+	}
+
+	uint32_t i = allocate();
+	Entry& entry = entries[i];
+	entry.key    = key;
+	//a full rotation, the entry expires when the wheel is back at its slot
+	entry.expiry = currentTick + SLOTS;
+	linkLru(i);
+	linkSlot(i);
+	index.emplace(key, i);
+
+	newMessageSignal(message);
+}
+
+void MessageFilter::advance(uint64_t tick) {
+	if (tick <= currentTick) {
+		return;
+	}
+
+	uint64_t first = std::max(currentTick + 1, tick >= SLOTS ? tick - SLOTS + 1 : 0);
+	for (uint64_t t = first; t <= tick; ++t) {
+		uint32_t i = slots[t % SLOTS];
+		while (i != NIL) {
+			uint32_t next = entries[i].slotNext;
+			if (entries[i].expiry <= tick) {
+				remove(i);
+			}
+			i = next;
 		}
 	}
+	currentTick = tick;
+}
+
+uint32_t MessageFilter::allocate() {
+	if (freeList == NIL) {
+		remove(lruTail);
+	}
+
+	uint32_t i = freeList;
+	freeList = entries[i].lruNext;
+	return i;
+}
+
+void MessageFilter::remove(uint32_t i) {
+	unlinkLru(i);
+	unlinkSlot(i);
+	index.erase(entries[i].key);
+
+	entries[i].lruNext = freeList;
+	freeList = i;
+}
+
+void MessageFilter::linkLru(uint32_t i) {
+	entries[i].lruPrev = NIL;
+	entries[i].lruNext = lruHead;
+	if (lruHead != NIL) {
+		entries[lruHead].lruPrev = i;
+	} else {
+		lruTail = i;
+	}
+	lruHead = i;
+}
+
+void MessageFilter::unlinkLru(uint32_t i) {
+	Entry& entry = entries[i];
+	if (entry.lruPrev != NIL) {
+		entries[entry.lruPrev].lruNext = entry.lruNext;
+	} else {
+		lruHead = entry.lruNext;
+	}
+	if (entry.lruNext != NIL) {
+		entries[entry.lruNext].lruPrev = entry.lruPrev;
+	} else {
+		lruTail = entry.lruPrev;
+	}
+}
+
+void MessageFilter::linkSlot(uint32_t i) {
+	uint32_t& head = slots[entries[i].expiry % SLOTS];
+	entries[i].slotPrev = NIL;
+	entries[i].slotNext = head;
+	if (head != NIL) {
+		entries[head].slotPrev = i;
+	}
+	head = i;
+}
+
+void MessageFilter::unlinkSlot(uint32_t i) {
+	Entry& entry = entries[i];
+	if (entry.slotPrev != NIL) {
+		entries[entry.slotPrev].slotNext = entry.slotNext;
+	} else {
+		slots[entry.expiry % SLOTS] = entry.slotNext;
+	}
+	if (entry.slotNext != NIL) {
+		entries[entry.slotNext].slotPrev = entry.slotPrev;
+	}
 }
@@ -20,25 +20,82 @@
 #ifndef MESSAGE_FILTER_H
 #define MESSAGE_FILTER_H
 
+#include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
+/**
+ * Passes each distinct message at most once per timeout.
+ *
+ * Messages are identified by a 64 bit hash. At most capacity messages are
+ * remembered, the least recently seen one is forgotten if a new one arrives.
+ * Expiry uses a hashed timing wheel with SLOTS slots of timeout / SLOTS, so
+ * memory is constant and every message costs O(1).
+ */
 class MessageFilter {
 public:
+	using Clock = std::chrono::steady_clock;
+
+	static const std::size_t SLOTS = 64;
+
 	boost::signals2::signal<void (const std::string&)> newMessageSignal;
 
 	/**
 	 * @timeout timeout in seconds.
+	 * @capacity maximum number of remembered messages.
 	 */
-	MessageFilter(time_t timeout = 60 * 60);
+	MessageFilter(time_t timeout = 60 * 60, std::size_t capacity = 1024);
 
 	void addMessage(const std::string& message);
 
+	void addMessage(const std::string& message, Clock::time_point now);
+
+	std::size_t size() const {
+		return index.size();
+	}
+
 private:
-	std::unordered_map<std::string, time_t> messages;
-	time_t timeout;
+	static const uint32_t NIL = UINT32_MAX;
+
+	struct Entry {
+		uint64_t key;
+		uint64_t expiry;  //tick the entry expires
+		uint32_t lruPrev; //towards the most recently seen entry
+		uint32_t lruNext;
+		uint32_t slotPrev;
+		uint32_t slotNext;
+	};
+
+	static uint64_t hash(const std::string& message);
+
+	/**
+	 * Expire the entries of all slots passed since the last call.
+	 */
+	void advance(uint64_t tick);
+
+	uint32_t allocate();
+	void remove(uint32_t i);
+
+	void linkLru(uint32_t i);
+	void unlinkLru(uint32_t i);
+	void linkSlot(uint32_t i);
+	void unlinkSlot(uint32_t i);
+
+	Clock::duration tickLength;
+	Clock::time_point start;
+	uint64_t currentTick;
+
+	std::vector<Entry> entries;
+	std::vector<uint32_t> slots;  //first entry of each slot
+	std::unordered_map<uint64_t, uint32_t> index;
+	uint32_t freeList;            //unused entries linked by lruNext
+	uint32_t lruHead;             //most recently seen
+	uint32_t lruTail;             //least recently seen
 };
 
 #endif //#ifndef MESSAGE_FILTER_H
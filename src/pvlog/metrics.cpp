@@ -0,0 +1,246 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "pvlogexception.h"
+
+namespace {
+
+const double QUANTILES[] = { 0.5, 0.9, 0.99 };
+
+int highestBit(uint64_t value) {
+	return 63 - __builtin_clzll(value);
+}
+
+//label set in the Prometheus format: name="value",...
+std::string formatLabels(const MetricsRegistry::Labels& labels) {
+	std::string out;
+	for (const auto& label : labels) {
+		if (!out.empty()) {
+			out += ',';
+		}
+		out += label.first + "=\"";
+		for (char c : label.second) {
+			switch (c) {
+			case '\\': out += "\\\\"; break;
+			case '"':  out += "\\\""; break;
+			case '\n': out += "\\n"; break;
+			default:   out += c;
+			}
+		}
+		out += '"';
+	}
+	return out;
+}
+
+std::string sample(const std::string& name, const std::string& labels, const std::string& extraLabel = "") {
+	std::string all = labels;
+	if (!extraLabel.empty()) {
+		all += (all.empty() ? "" : ",") + extraLabel;
+	}
+	return all.empty() ? name : name + "{" + all + "}";
+}
+
+std::string seconds(uint64_t us) {
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.6f", us / 1e6);
+	return buf;
+}
+
+} //namespace {
+
+Histogram::Histogram() : sum(0), max(0) {
+	for (auto& b : buckets) {
+		b.store(0, std::memory_order_relaxed);
+	}
+}
+
+int Histogram::bucket(uint64_t value) {
+	if (value < SUB_BUCKETS) {
+		return static_cast<int>(value);
+	}
+
+	int exponent = highestBit(value);
+	if (exponent >= MAX_EXPONENT) {
+		return BUCKETS - 1;
+	}
+	int shift = exponent - SUB_BUCKET_BITS;
+	int sub   = static_cast<int>(value >> shift) - SUB_BUCKETS;
+	return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(int bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+
+	int shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+	int sub   = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+	return ((static_cast<uint64_t>(SUB_BUCKETS + sub + 1)) << shift) - 1;
+}
+
+void Histogram::record(uint64_t us) {
+	buckets[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(us, std::memory_order_relaxed);
+
+	uint64_t prev = max.load(std::memory_order_relaxed);
+	while (us > prev && !max.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+		//retry with updated prev
+	}
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+	Snapshot s;
+	s.count = 0;
+	for (int i = 0; i < BUCKETS; ++i) {
+		s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+		s.count += s.buckets[i];
+	}
+	s.sum = sum.load(std::memory_order_relaxed);
+	s.max = max.load(std::memory_order_relaxed);
+	return s;
+}
+
+uint64_t Histogram::Snapshot::quantile(double q) const {
+	if (count == 0) {
+		return 0;
+	}
+
+	uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; ++i) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return std::min(bucketUpperBound(i), max);
+		}
+	}
+	return max;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+	static MetricsRegistry registry;
+	return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, Type type) {
+	auto it = families.find(name);
+	if (it == families.end()) {
+		it = families.emplace(name, Family()).first;
+		it->second.type = type;
+		it->second.help = help;
+	} else if (it->second.type != type) {
+		PVLOG_EXCEPT("Metric " + name + " registered with another type");
+	}
+	return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_ptr<Counter>& metric = family(name, help, Type::COUNTER).counters[formatLabels(labels)];
+	if (!metric) {
+		metric.reset(new Counter());
+	}
+	return *metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_ptr<Gauge>& metric = family(name, help, Type::GAUGE).gauges[formatLabels(labels)];
+	if (!metric) {
+		metric.reset(new Gauge());
+	}
+	return *metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_ptr<Histogram>& metric = family(name, help, Type::HISTOGRAM).histograms[formatLabels(labels)];
+	if (!metric) {
+		metric.reset(new Histogram());
+	}
+	return *metric;
+}
+
+void MetricsRegistry::writePrometheus(std::string& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& entry : families) {
+		const std::string& name = entry.first;
+		const Family& family    = entry.second;
+
+		static const char* TYPES[] = { "counter", "gauge", "summary" };
+		out += "# HELP " + name + " " + family.help + "\n";
+		out += "# TYPE " + name + " " + TYPES[static_cast<int>(family.type)] + "\n";
+
+		for (const auto& metric : family.counters) {
+			out += sample(name, metric.first) + " " + std::to_string(metric.second->get()) + "\n";
+		}
+		for (const auto& metric : family.gauges) {
+			out += sample(name, metric.first) + " " + std::to_string(metric.second->get()) + "\n";
+		}
+		for (const auto& metric : family.histograms) {
+			Histogram::Snapshot s = metric.second->snapshot();
+			for (double q : QUANTILES) {
+				char quantile[32];
+				std::snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+				out += sample(name, metric.first, quantile) + " " + seconds(s.quantile(q)) + "\n";
+			}
+			out += sample(name, metric.first, "quantile=\"1\"") + " " + seconds(s.max) + "\n";
+			out += sample(name + "_sum", metric.first) + " " + seconds(s.sum) + "\n";
+			out += sample(name + "_count", metric.first) + " " + std::to_string(s.count) + "\n";
+		}
+	}
+}
+
+Json::Value MetricsRegistry::toJson() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Json::Value json(Json::objectValue);
+	for (const auto& entry : families) {
+		const std::string& name = entry.first;
+		const Family& family    = entry.second;
+
+		for (const auto& metric : family.counters) {
+			json[sample(name, metric.first)] = static_cast<Json::UInt64>(metric.second->get());
+		}
+		for (const auto& metric : family.gauges) {
+			json[sample(name, metric.first)] = static_cast<Json::Int64>(metric.second->get());
+		}
+		for (const auto& metric : family.histograms) {
+			Histogram::Snapshot s = metric.second->snapshot();
+			Json::Value h;
+			h["count"] = static_cast<Json::UInt64>(s.count);
+			h["p50Us"] = static_cast<Json::UInt64>(s.quantile(0.5));
+			h["p90Us"] = static_cast<Json::UInt64>(s.quantile(0.9));
+			h["p99Us"] = static_cast<Json::UInt64>(s.quantile(0.99));
+			h["maxUs"] = static_cast<Json::UInt64>(s.max);
+			json[sample(name, metric.first)] = h;
+		}
+	}
+	return json;
+}
+
+Histogram& commitTimeHistogram(const std::string& writer) {
+	return MetricsRegistry::instance().histogram("pvlog_db_commit_duration_seconds",
+			"Time to commit a database write transaction", {{"writer", writer}});
+}
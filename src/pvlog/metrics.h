@@ -0,0 +1,207 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_METRICS_H_
+#define SRC_PVLOG_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jsoncpp/json/value.h>
+
+#include "utility.h"
+
+/**
+ * Monotonic counter.
+ */
+class Counter {
+	DISABLE_COPY(Counter)
+public:
+	Counter() : value(0) {}
+
+	void inc(uint64_t n = 1) {
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	uint64_t get() const {
+		return value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> value;
+};
+
+/**
+ * Value that can go up and down.
+ */
+class Gauge {
+	DISABLE_COPY(Gauge)
+public:
+	Gauge() : value(0) {}
+
+	void set(int64_t v) {
+		value.store(v, std::memory_order_relaxed);
+	}
+
+	void add(int64_t n) {
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	int64_t get() const {
+		return value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> value;
+};
+
+/**
+ * Latency histogram in microseconds with HDR style log-linear buckets.
+ *
+ * Values below 16 have exact buckets, every power of two above is split
+ * into 16 buckets. So quantiles are within 6.25% of the recorded values
+ * over the whole range, recording is a few relaxed atomic increments.
+ */
+class Histogram {
+	DISABLE_COPY(Histogram)
+public:
+	static const int SUB_BUCKET_BITS = 4;
+	static const int SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+	static const int MAX_EXPONENT    = 40; //about 12 days
+	static const int BUCKETS         = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+	/**
+	 * Records the time from construction to destruction.
+	 */
+	class Timer {
+		DISABLE_COPY(Timer)
+	public:
+		explicit Timer(Histogram& histogram) :
+				histogram(histogram),
+				start(std::chrono::steady_clock::now()) {}
+
+		~Timer() {
+			histogram.record(std::chrono::steady_clock::now() - start);
+		}
+
+	private:
+		Histogram& histogram;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	struct Snapshot {
+		uint64_t count;
+		uint64_t sum;
+		uint64_t max;
+		std::array<uint64_t, BUCKETS> buckets;
+
+		/**
+		 * Upper bound of the bucket containing quantile q (0 <= q <= 1).
+		 */
+		uint64_t quantile(double q) const;
+	};
+
+	Histogram();
+
+	void record(uint64_t us);
+
+	void record(std::chrono::steady_clock::duration duration) {
+		record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+	}
+
+	Snapshot snapshot() const;
+
+	static int bucket(uint64_t value);
+
+	static uint64_t bucketUpperBound(int bucket);
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKETS> buckets;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+};
+
+/**
+ * Process wide registry of named metrics.
+ *
+ * Metrics are identified by name and labels, they are created on first
+ * use and live as long as the process. Lookup takes a lock, hot paths
+ * keep the returned reference. Exported in the Prometheus text format,
+ * histograms as summaries with quantiles.
+ */
+class MetricsRegistry {
+	DISABLE_COPY(MetricsRegistry)
+public:
+	using Labels = std::vector<std::pair<std::string, std::string>>;
+
+	static MetricsRegistry& instance();
+
+	Counter& counter(const std::string& name, const std::string& help, const Labels& labels = Labels());
+
+	Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = Labels());
+
+	/**
+	 * Histogram of durations, exported in seconds. name should end with _seconds.
+	 */
+	Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = Labels());
+
+	void writePrometheus(std::string& out) const;
+
+	/**
+	 * All metrics as json object, keyed by name and labels.
+	 */
+	Json::Value toJson() const;
+
+private:
+	enum class Type {
+		COUNTER,
+		GAUGE,
+		HISTOGRAM
+	};
+
+	struct Family {
+		Type type;
+		std::string help;
+		std::map<std::string, std::unique_ptr<Counter>> counters;
+		std::map<std::string, std::unique_ptr<Gauge>> gauges;
+		std::map<std::string, std::unique_ptr<Histogram>> histograms;
+	};
+
+	MetricsRegistry() = default;
+
+	Family& family(const std::string& name, const std::string& help, Type type);
+
+	mutable std::mutex mutex;
+	std::map<std::string, Family> families;
+};
+
+/**
+ * Histogram of the database commit times of writer.
+ */
+Histogram& commitTimeHistogram(const std::string& writer);
+
+#endif /* SRC_PVLOG_METRICS_H_ */
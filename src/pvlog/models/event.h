@@ -44,6 +44,9 @@ struct Event {
 	int32_t number;
 	std::string message;
 
+	//keyset pagination of events and lookup of existing events
+	#pragma db index("event_inverter_time_i") members(inverter, time)
+
 	Event(InverterPtr inverter, boost::posix_time::ptime time, int32_t number, std::string message) :
 			id(0),
 			inverter(inverter),
@@ -0,0 +1,241 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_MODELS_FIXEDMAP_H_
+#define SRC_PVLOG_MODELS_FIXEDMAP_H_
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include <odb/container-traits.hxx>
+
+#include "pvlogexception.h"
+
+namespace model {
+
+/**
+ * Map of the numbers 1..N to values, stored in place without heap allocations.
+ *
+ * Entries are indexed by number, iteration is in ascending number order.
+ * The interface is the subset of std::map used for phases and dc inputs,
+ * numbers out of range throw PvlogException.
+ */
+template<typename T, std::size_t N>
+class FixedMap {
+public:
+	using key_type    = int;
+	using mapped_type = T;
+	using value_type  = std::pair<int, T>;
+	using size_type   = std::size_t;
+
+	template<typename Value>
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = Value;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = Value*;
+		using reference         = Value&;
+
+		Iterator(Value* pos, Value* end) : pos(pos), end(end) {
+			skipEmpty();
+		}
+
+		//iterator to const_iterator
+		template<typename Other>
+		Iterator(const Iterator<Other>& other) : pos(other.pos), end(other.end) {}
+
+		reference operator*() const {
+			return *pos;
+		}
+
+		pointer operator->() const {
+			return pos;
+		}
+
+		Iterator& operator++() {
+			++pos;
+			skipEmpty();
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator it(*this);
+			++*this;
+			return it;
+		}
+
+		friend bool operator==(const Iterator& a, const Iterator& b) {
+			return a.pos == b.pos;
+		}
+
+		friend bool operator!=(const Iterator& a, const Iterator& b) {
+			return a.pos != b.pos;
+		}
+
+	private:
+		template<typename> friend class Iterator;
+
+		void skipEmpty() {
+			while (pos != end && pos->first == 0) {
+				++pos;
+			}
+		}
+
+		Value* pos;
+		Value* end;
+	};
+
+	using iterator       = Iterator<value_type>;
+	using const_iterator = Iterator<const value_type>;
+
+	FixedMap() : entries(), used(0) {}
+
+	iterator begin() {
+		return iterator(entries.data(), entries.data() + N);
+	}
+
+	iterator end() {
+		return iterator(entries.data() + N, entries.data() + N);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(entries.data(), entries.data() + N);
+	}
+
+	const_iterator end() const {
+		return const_iterator(entries.data() + N, entries.data() + N);
+	}
+
+	size_type size() const {
+		return used;
+	}
+
+	bool empty() const {
+		return used == 0;
+	}
+
+	void clear() {
+		for (value_type& entry : entries) {
+			entry.first = 0;
+		}
+		used = 0;
+	}
+
+	size_type count(int key) const {
+		return inRange(key) && entries[key - 1].first != 0;
+	}
+
+	iterator find(int key) {
+		return count(key) != 0 ? iterator(&entries[key - 1], entries.data() + N) : end();
+	}
+
+	const_iterator find(int key) const {
+		return count(key) != 0 ? const_iterator(&entries[key - 1], entries.data() + N) : end();
+	}
+
+	T& at(int key) {
+		if (count(key) == 0) {
+			PVLOG_EXCEPT("No entry " + std::to_string(key));
+		}
+		return entries[key - 1].second;
+	}
+
+	const T& at(int key) const {
+		if (count(key) == 0) {
+			PVLOG_EXCEPT("No entry " + std::to_string(key));
+		}
+		return entries[key - 1].second;
+	}
+
+	/**
+	 * Insert value as number key if there is no entry for key yet.
+	 */
+	std::pair<iterator, bool> emplace(int key, const T& value) {
+		if (!inRange(key)) {
+			PVLOG_EXCEPT("Number " + std::to_string(key) + " out of range 1.." + std::to_string(N));
+		}
+
+		value_type& entry = entries[key - 1];
+		bool inserted = (entry.first == 0);
+		if (inserted) {
+			entry.first  = key;
+			entry.second = value;
+			++used;
+		}
+		return std::make_pair(iterator(&entry, entries.data() + N), inserted);
+	}
+
+private:
+	static bool inRange(int key) {
+		return key >= 1 && static_cast<std::size_t>(key) <= N;
+	}
+
+	std::array<value_type, N> entries; //first is 0 for empty entries
+	size_type used;
+};
+
+} //namespace model {
+
+namespace odb {
+
+//Stored like std::map<int, T>: one row per entry with number as key
+template<typename T, std::size_t N>
+class access::container_traits<model::FixedMap<T, N>> {
+public:
+	static const container_kind kind = ck_map;
+	static const bool smart = false;
+
+	using container_type = model::FixedMap<T, N>;
+	using key_type       = int;
+	using value_type     = T;
+	using functions      = map_functions<key_type, value_type>;
+
+	static void persist(const container_type& c, const functions& f) {
+		for (const auto& entry : c) {
+			f.insert(entry.first, entry.second);
+		}
+	}
+
+	static void load(container_type& c, bool more, const functions& f) {
+		c.clear();
+		while (more) {
+			key_type key;
+			value_type value;
+			more = f.select(key, value);
+			c.emplace(key, value);
+		}
+	}
+
+	static void update(const container_type& c, const functions& f) {
+		f.delete_();
+		persist(c, f);
+	}
+
+	static void erase(const functions& f) {
+		f.delete_();
+	}
+};
+
+} //namespace odb {
+
+#endif /* SRC_PVLOG_MODELS_FIXEDMAP_H_ */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_MODELS_QUERYCACHE_H_
+#define SRC_PVLOG_MODELS_QUERYCACHE_H_
+
+#include <memory>
+
+#include <odb/connection.hxx>
+#include <odb/prepared-query.hxx>
+#include <odb/query.hxx>
+#include <odb/transaction.hxx>
+
+namespace model {
+
+/**
+ * Lookup prepared query name on the connection of the current transaction.
+ * If it is not cached yet it is prepared using makeQuery and cached.
+ *
+ * makeQuery gets the parameter object and has to bind it using query::_ref,
+ * params points to it afterwards. Set the parameters before executing the query.
+ */
+template<typename T, typename P, typename F>
+odb::prepared_query<T> cachedQuery(const char* name, P*& params, F makeQuery) {
+	odb::connection& connection = odb::transaction::current().connection();
+
+	odb::prepared_query<T> query(connection.lookup_query<T>(name, params));
+	if (!query) {
+		std::unique_ptr<P> p(new P());
+		params = p.get();
+		query = connection.prepare_query<T>(name, makeQuery(*params));
+		connection.cache_query(query, std::move(p));
+	}
+
+	return query;
+}
+
+} //namespace model {
+
+#endif /* SRC_PVLOG_MODELS_QUERYCACHE_H_ */
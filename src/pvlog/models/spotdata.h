@@ -20,8 +20,8 @@
 #ifndef SRC_PVLOG_MODELS_SPOTDATA_H_
 #define SRC_PVLOG_MODELS_SPOTDATA_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <unordered_map>
 #include <memory>
 #include <ostream>
 
@@ -37,10 +37,18 @@
 
 #include "phase.h"
 #include "dcinput.h"
+#include "fixedmap.h"
 #include "inverter.h"
 
 namespace model {
 
+//phases and dc inputs are numbered from 1 like in pvlib
+const std::size_t MAX_PHASES    = 3;
+const std::size_t MAX_DC_INPUTS = 3;
+
+using Phases   = FixedMap<Phase, MAX_PHASES>;
+using DcInputs = FixedMap<DcInput, MAX_DC_INPUTS>;
+
 #pragma db object
 struct SpotData {
 	#pragma db id auto
@@ -62,14 +70,14 @@ struct SpotData {
 	           id_column("id")     \
 	           key_column("phase") \
 	           value_column("")
-	std::unordered_map<int, Phase> phases;
+	Phases phases;
 
 
 	#pragma db table("dc_input")   \
 	        id_column("id")        \
 	        key_column("input") \
 	        value_column("")
-	std::unordered_map<int, DcInput> dcInputs;
+	DcInputs dcInputs;
 
 	friend std::ostream& operator<< (std::ostream& o, const SpotData& sd) {
 		o << "Inverter: " << sd.inverter->id << ": \n";
@@ -93,6 +101,22 @@ struct SpotData {
 
 using SpotDataPtr = std::shared_ptr<SpotData>;
 
+/**
+ * Power of spot data without phases and dc inputs, for reading long time
+ * ranges without loading the containers.
+ */
+#pragma db view object(SpotData) object(Inverter)
+struct SpotDataPower {
+	#pragma db column(Inverter::id)
+	int64_t inverterId;
+
+	#pragma db column(SpotData::time) type("INTEGER")
+	boost::posix_time::ptime time;
+
+	#pragma db column(SpotData::power)
+	int32_t power;
+};
+
 inline Json::Value toJson(const SpotData& spotData) {
 	Json::Value json;
 
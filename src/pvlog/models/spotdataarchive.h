@@ -0,0 +1,75 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_MODELS_SPOTDATAARCHIVE_H_
+#define SRC_PVLOG_MODELS_SPOTDATAARCHIVE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <odb/core.hxx>
+
+#include "version.h"
+
+#include "inverter.h"
+
+namespace model {
+
+/**
+ * Spot data of one inverter and one (local) day, encoded by encodeSpotData.
+ */
+#pragma db object
+struct SpotDataArchive {
+	#pragma db id auto
+	int id;
+
+	#pragma db not_null
+	std::shared_ptr<Inverter> inverter;
+
+	boost::gregorian::date date;
+
+	#pragma db type("INTEGER")
+	boost::posix_time::ptime firstTime;
+
+	#pragma db type("INTEGER")
+	boost::posix_time::ptime lastTime;
+
+	int32_t sampleCount;
+
+	#pragma db type("BLOB")
+	std::vector<char> data;
+
+	#pragma db index("spot_data_archive_inverter_date_i") unique members(inverter, date)
+	#pragma db index("spot_data_archive_time_i") members(firstTime, lastTime)
+
+	SpotDataArchive() :
+			id(0),
+			sampleCount(0) {
+		//nothing to do
+	}
+};
+
+using SpotDataArchivePtr = std::shared_ptr<SpotDataArchive>;
+
+} //namespace model {
+
+#endif /* SRC_PVLOG_MODELS_SPOTDATAARCHIVE_H_ */
@@ -0,0 +1,78 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SRC_PVLOG_MODELS_UPLOAD_H_
+#define SRC_PVLOG_MODELS_UPLOAD_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include <boost/optional.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <odb/core.hxx>
+
+#include "version.h"
+
+namespace model {
+
+enum class UploadKind : int32_t {
+	STATUS = 0, //live data interval, addstatus.jsp
+	OUTPUT = 1  //day yield, addoutput.jsp
+};
+
+/**
+ * Data waiting for upload to pvoutput.org, removed when it was uploaded.
+ */
+#pragma db object table("upload_outbox")
+struct Upload {
+	#pragma db id auto
+	int64_t id;
+
+	UploadKind kind;
+
+	#pragma db type("INTEGER")
+	boost::posix_time::ptime time; //start of the day for OUTPUT
+
+	int32_t power; //power in W, 0 for OUTPUT
+
+	boost::optional<int32_t> energy; //day yield in Wh
+
+	#pragma db index("upload_outbox_kind_time_i") members(kind, time)
+
+	Upload() :
+			id(0),
+			kind(UploadKind::STATUS),
+			power(0) {
+		//nothing to do
+	}
+};
+
+using UploadPtr = std::shared_ptr<Upload>;
+
+#pragma db view object(Upload)
+struct UploadCount {
+	#pragma db column("count(" + Upload::id + ")")
+	std::size_t count;
+};
+
+} //namespace model {
+
+#endif /* SRC_PVLOG_MODELS_UPLOAD_H_ */
@@ -170,6 +170,7 @@ pvlib_plant* connectPlant(const std::string& connection,
 	}
 
 	if (pvlib_connect(pvlibPlant, connectionParam.c_str(), protocolParam.c_str(), nullptr, nullptr) < 0) {
+		pvlib_close(pvlibPlant);
 		PVLOG_EXCEPT("Error connecting to plant!");
 	}
 
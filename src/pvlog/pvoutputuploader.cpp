@@ -17,28 +17,39 @@
  * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #define PVLOG_LOG_MODULE "pvoutputuploader"
 
 #include "pvoutputuploader.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <exception>
+#include <map>
+#include <sstream>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <odb/database.hxx>
+#include <odb/transaction.hxx>
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/HTTPResponse.h>
-#include <Poco/Net/HTTPSClientSession.h>
 #include <Poco/Net/HTTPMessage.h>
 #include <Poco/Net/HTMLForm.h>
 #include <Poco/Net/NetException.h>
 #include <Poco/Net/SSLManager.h>
 #include <Poco/Net/AcceptCertificateHandler.h>
 
+#include "configreader.h"
 #include "log.h"
+#include "metrics.h"
+#include "pvlogexception.h"
 #include "models/configservice.h"
+#include "models/upload_odb.h"
 
 using Poco::Net::HTTPRequest;
 using Poco::Net::HTTPMessage;
 using Poco::Net::HTMLForm;
-using Poco::Net::HTTPSClientSession;
 using Poco::Net::HTTPResponse;
 using Poco::SharedPtr;
 using Poco::Net::InvalidCertificateHandler;
@@ -51,11 +62,32 @@ namespace pt = boost::posix_time;
 
 using model::SpotData;
 using model::DayData;
+using model::Upload;
+using model::UploadCount;
+using model::UploadKind;
 
 static const std::string LIVE_DATA_PATH = "/service/r2/addstatus.jsp";
+static const std::string BATCH_LIVE_DATA_PATH = "/service/r2/addbatchstatus.jsp";
 static const std::string DAY_DATA_PATH = "/service/r2/addoutput.jsp";
-static const std::string PVOUTPUT_HOST = "pvoutput.org";
-static const int PVOUTPUT_PORT = 443;
+static const std::string BATCH_DAY_DATA_PATH = "/service/r2/addbatchoutput.jsp";
+
+//pvoutput.org accepts 30 entries per batch, 100 for donation accounts
+static const std::size_t MAX_BATCH_SIZE = 100;
+
+static const std::chrono::minutes MIN_BACKOFF(1);
+static const std::chrono::minutes MAX_BACKOFF(60);
+
+static Histogram& uploadTime(const std::string& endpoint) {
+	return MetricsRegistry::instance().histogram("pvlog_upload_duration_seconds",
+			"Time of an upload to pvoutput.org", {{"endpoint", endpoint}});
+}
+
+static std::string timeString(const pt::ptime& time) {
+	char str[6];
+	std::snprintf(str, sizeof(str), "%02d:%02d", static_cast<int>(time.time_of_day().hours()),
+			static_cast<int>(time.time_of_day().minutes()));
+	return str;
+}
 
 void readIdApiKey(odb::database* db, std::string& id, std::string& apiKey) {
 	try {
@@ -68,7 +100,45 @@ void readIdApiKey(odb::database* db, std::string& id, std::string& apiKey) {
 	}
 }
 
-PvoutputUploader::PvoutputUploader(odb::database* db) : db(db) {
+PvoutputUploader::Settings::Settings() :
+		host("pvoutput.org"),
+		port(443),
+		batchSize(30),
+		batchDelay(pt::minutes(0)),
+		keepAlive(pt::seconds(30)),
+		requestsPerHour(60),
+		maxAge(14) {
+	//nothing to do
+}
+
+PvoutputUploader::Settings PvoutputUploader::Settings::read(const ConfigReader& configReader) {
+	Settings settings;
+
+	settings.host            = configReader.getValue("pvoutput_host", settings.host);
+	settings.port            = configReader.getSizeValue("pvoutput_port", "443", 1, 65535);
+	settings.batchSize       = configReader.getSizeValue("pvoutput_batch_size", "30", 1, MAX_BATCH_SIZE);
+	settings.batchDelay      = pt::minutes(configReader.getSizeValue("pvoutput_batch_delay", "0", 0, 24 * 60));
+	settings.keepAlive       = pt::seconds(configReader.getSizeValue("pvoutput_keep_alive", "30", 0, 3600));
+	settings.requestsPerHour = configReader.getSizeValue("pvoutput_requests_per_hour", "60", 1, 3600);
+	settings.maxAge          = bg::days(configReader.getSizeValue("pvoutput_max_age", "14", 1, 90));
+
+	return settings;
+}
+
+PvoutputUploader::PvoutputUploader(odb::database* db, Settings settings) :
+		db(db),
+		settings(settings),
+		stopped(false),
+		flushRequested(false),
+		queued(0),
+		notBefore(Clock::now()),
+		failures(0),
+		requests(settings.requestsPerHour),
+		lastRefill(Clock::now()),
+		queueDepth(MetricsRegistry::instance().gauge("pvlog_upload_queue_depth",
+				"Entries in the outbox waiting for upload to pvoutput.org")),
+		failed(MetricsRegistry::instance().counter("pvlog_upload_failures_total",
+				"Failed uploads to pvoutput.org")) {
 	SharedPtr<InvalidCertificateHandler> ptrHandler =
 			new AcceptCertificateHandler(false);
 
@@ -77,67 +147,340 @@ PvoutputUploader::PvoutputUploader(odb::database* db) : db(db) {
 			"ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
 
 	SSLManager::instance().initializeClient(0, ptrHandler, ptrContext);
+
+	//all uploads are sent by the worker thread, one connection is enough
+	sessionPool.reset(new HttpsSessionPool(settings.host, settings.port, ptrContext, 1,
+			Poco::Timespan(settings.keepAlive.total_seconds(), 0)));
+
+	odb::transaction t(db->begin());
+	queued = db->query_value<UploadCount>().count;
+	t.commit();
+
+	if (queued > 0) {
+		LOG(Info) << queued << " entries left in the pvoutput.org outbox, uploading them";
+		oldestQueued = pt::ptime(pt::min_date_time);
+	}
+	queueDepth.set(queued);
+
+	worker = std::thread(&PvoutputUploader::work, this);
 }
 
-void PvoutputUploader::uploadSpotDataSum(pt::ptime datetime, int32_t power, int32_t yield,
-		const std::string& systemId, const std::string& apiKey) {
-	LOG(Debug) << "Uploading live data. Time: " << datetime << " power: "
-			<< power << "W, dayYield: " << yield << "Wh";
+PvoutputUploader::~PvoutputUploader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	wakeUp.notify_all();
+	worker.join();
+}
 
-	HTTPRequest request(HTTPRequest::HTTP_POST, LIVE_DATA_PATH, HTTPMessage::HTTP_1_1);
+void PvoutputUploader::enqueue(const Upload& upload) {
+	Upload u(upload);
+	odb::transaction t(db->begin());
+	db->persist(u);
+	t.commit();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++queued;
+	if (u.kind == UploadKind::STATUS && oldestQueued.is_not_a_date_time()) {
+		oldestQueued = u.time;
+	} else if (u.kind == UploadKind::OUTPUT) {
+		flushRequested = true; //day data is not held back for a batch
+	}
+	queueDepth.set(queued);
+	wakeUp.notify_one();
+}
 
-	request.add("X-Pvoutput-SystemId", systemId);
-	request.add("X-Pvoutput-Apikey", apiKey);
+void PvoutputUploader::flush() {
+	std::lock_guard<std::mutex> lock(mutex);
+	flushRequested = true;
+	wakeUp.notify_one();
+}
 
-	HTMLForm form;
-	form.add("d", bg::to_iso_string(datetime.date()));
-	int hours   = datetime.time_of_day().hours();
-	int minutes = datetime.time_of_day().minutes();
-	form.add("t", std::to_string(hours) + ":" + std::to_string(minutes));
-	if (yield >= 0) {
-		form.add("v1", std::to_string(yield));
+PvoutputUploader::Clock::time_point PvoutputUploader::nextRequest() const {
+	if (queued == 0) {
+		return Clock::time_point::max();
 	}
-	form.add("v2", std::to_string(power));
-	form.prepareSubmit(request);
 
-	HTTPSClientSession session(PVOUTPUT_HOST, PVOUTPUT_PORT, ptrContext);
-	std::ostream& send = session.sendRequest(request);
-	form.write(send);
+	//after a failure or restart everything queued is sent as soon as possible
+	if (flushRequested || failures > 0 || queued >= settings.batchSize) {
+		return notBefore;
+	}
+	if (oldestQueued.is_not_a_date_time()) {
+		return Clock::time_point::max();
+	}
 
-	HTTPResponse response;
-	std::istream& rs = session.receiveResponse(response);
+	pt::time_duration wait = oldestQueued + settings.batchDelay - pt::second_clock::universal_time();
+	if (wait.is_negative()) {
+		return notBefore;
+	}
+	return std::max(notBefore, Clock::now() + std::chrono::seconds(wait.total_seconds()));
+}
+
+void PvoutputUploader::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopped) {
+		Clock::time_point due = nextRequest();
+		if (due == Clock::time_point::max()) {
+			wakeUp.wait(lock);
+			continue;
+		} else if (Clock::now() < due) {
+			wakeUp.wait_until(lock, due);
+			continue;
+		}
+
+		bool partial = flushRequested || failures > 0 || oldestQueued.is_special() ||
+				oldestQueued + settings.batchDelay <= pt::second_clock::universal_time();
+		lock.unlock();
+
+		bool done = false;
+		try {
+			done = drain(UploadKind::OUTPUT, true) && drain(UploadKind::STATUS, partial);
+		} catch (const std::exception& ex) {
+			LOG(Error) << "Reading pvoutput.org outbox failed: " << ex.what();
+			lock.lock();
+			retryLater(Clock::now() + MIN_BACKOFF);
+			continue;
+		}
+
+		lock.lock();
+		if (done) {
+			flushRequested = false;
+		}
+	}
+}
+
+bool PvoutputUploader::drain(UploadKind kind, bool partial) {
+	for (;;) {
+		std::vector<Upload> batch = loadBatch(kind);
+		if (kind == UploadKind::STATUS && (batch.empty() || (!partial && batch.size() < settings.batchSize))) {
+			//read under the lock, an interval enqueued after loadBatch is either found
+			//or sets oldestQueued itself after it
+			std::lock_guard<std::mutex> lock(mutex);
+			oldestQueued = oldestStatus();
+			return true;
+		} else if (batch.empty()) {
+			return true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (stopped || !takeRequest()) {
+				return false;
+			}
+		}
+
+		Result result = send(kind, batch);
+		if (result == Result::RETRY) {
+			std::lock_guard<std::mutex> lock(mutex);
+			failed.inc();
+			++failures;
+			std::chrono::minutes backoff = std::min(MAX_BACKOFF, MIN_BACKOFF * (1 << std::min(failures - 1, 6)));
+			LOG(Info) << "Retrying upload to pvoutput.org in " << backoff.count() << " minutes";
+			retryLater(Clock::now() + backoff);
+			return false;
+		}
+
+		if (result == Result::REJECTED) {
+			failed.inc();
+		}
+		remove(batch);
 
-	if (response.getStatus() != HTTPResponse::HTTP_OK) {
-		LOG(Error) << "Error sending live power data. HTTP error: " << response.getStatus()
-				<< " " << rs.rdbuf();
+		std::lock_guard<std::mutex> lock(mutex);
+		failures = 0;
 	}
 }
 
-void PvoutputUploader::uploadDayDataSum(bg::date date, int32_t yield,
-		const std::string& systemId, const std::string& apiKey) {
-	LOG(Debug) << "Uploading day energy data. Date: " << date<< " yield: " << yield << "Wh";
+std::vector<Upload> PvoutputUploader::loadBatch(UploadKind kind) {
+	using Query = odb::query<Upload>;
+
+	std::vector<Upload> batch;
+	odb::transaction t(db->begin());
+
+	if (kind == UploadKind::STATUS) {
+		pt::ptime expired = pt::second_clock::universal_time() - settings.maxAge;
+		std::size_t erased = db->erase_query<Upload>(Query::kind == kind && Query::time < expired);
+		if (erased > 0) {
+			LOG(Warning) << "Dropped " << erased << " live data intervals older than " << settings.maxAge.days()
+					<< " days from the pvoutput.org outbox";
+			std::lock_guard<std::mutex> lock(mutex);
+			queued -= std::min(queued, erased);
+			queueDepth.set(queued);
+		}
+	}
+
+	Query query(Query::kind == kind);
+	query += "ORDER BY" + Query::time + "," + Query::id + "LIMIT" + Query::_val(settings.batchSize);
+	for (const Upload& upload : db->query<Upload>(query)) {
+		batch.push_back(upload);
+	}
+
+	t.commit();
+	return batch;
+}
 
-	HTTPRequest request(HTTPRequest::HTTP_POST, DAY_DATA_PATH, HTTPMessage::HTTP_1_1);
+pt::ptime PvoutputUploader::oldestStatus() {
+	using Query = odb::query<Upload>;
+
+	pt::ptime oldest;
+	odb::transaction t(db->begin());
+	Query query(Query::kind == UploadKind::STATUS);
+	query += "ORDER BY" + Query::time + "LIMIT 1";
+	for (const Upload& upload : db->query<Upload>(query)) {
+		oldest = upload.time;
+	}
+	t.commit();
+
+	return oldest;
+}
+
+void PvoutputUploader::remove(const std::vector<Upload>& batch) {
+	odb::transaction t(db->begin());
+	for (const Upload& upload : batch) {
+		db->erase<Upload>(upload.id);
+	}
+	t.commit();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	queued -= std::min(queued, batch.size());
+	queueDepth.set(queued);
+}
+
+std::string PvoutputUploader::post(const std::string& path, HTMLForm& form, const std::string& systemId,
+		const std::string& apiKey, HTTPResponse& response) {
+	HTTPRequest request(HTTPRequest::HTTP_POST, path, HTTPMessage::HTTP_1_1);
 
 	request.add("X-Pvoutput-SystemId", systemId);
 	request.add("X-Pvoutput-Apikey", apiKey);
+	request.add("X-Rate-Limit", "1");
+	form.prepareSubmit(request);
+
+	std::ostringstream body;
+	form.write(body);
+
+	return sessionPool->send(request, body.str(), response);
+}
+
+PvoutputUploader::Result PvoutputUploader::send(UploadKind kind, const std::vector<Upload>& batch) {
+	std::string id;
+	std::string apiKey;
+
+	readIdApiKey(db, id, apiKey);
+	if (id == "" || apiKey == "") {
+		LOG(Warning) << "pvoutput.org upload disabled, dropping " << batch.size() << " queued entries";
+		return Result::REJECTED;
+	}
+
+	bool status = (kind == UploadKind::STATUS);
+	bool batched = (settings.batchSize > 1);
 
 	HTMLForm form;
-	form.add("d", bg::to_iso_string(date));
-	form.add("g", std::to_string(yield));
-	form.prepareSubmit(request);
+	if (batched) {
+		std::string data;
+		for (const Upload& upload : batch) {
+			if (!data.empty()) {
+				data += ";";
+			}
+			data += bg::to_iso_string(upload.time.date()) + ",";
+			if (status) {
+				data += timeString(upload.time) + ",";
+				if (upload.energy) {
+					data += std::to_string(*upload.energy);
+				}
+				data += "," + std::to_string(upload.power);
+			} else {
+				data += std::to_string(upload.energy.get_value_or(0));
+			}
+		}
+		form.add("data", data);
+	} else {
+		const Upload& upload = batch.front();
+		form.add("d", bg::to_iso_string(upload.time.date()));
+		if (status) {
+			form.add("t", timeString(upload.time));
+			if (upload.energy) {
+				form.add("v1", std::to_string(*upload.energy));
+			}
+			form.add("v2", std::to_string(upload.power));
+		} else {
+			form.add("g", std::to_string(upload.energy.get_value_or(0)));
+		}
+	}
 
-	HTTPSClientSession session(PVOUTPUT_HOST, PVOUTPUT_PORT, ptrContext);
-	std::ostream& send = session.sendRequest(request);
-	form.write(send);
+	const std::string& path = status ? (batched ? BATCH_LIVE_DATA_PATH : LIVE_DATA_PATH) :
+			(batched ? BATCH_DAY_DATA_PATH : DAY_DATA_PATH);
+	LOG(Debug) << "Uploading " << batch.size() << " entries from " << batch.front().time << " to " << path;
 
 	HTTPResponse response;
-	std::istream& rs = session.receiveResponse(response);
+	std::string result;
+	try {
+		Histogram::Timer timer(uploadTime(path.substr(path.rfind('/') + 1)));
+		result = post(path, form, id, apiKey, response);
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Uploading to pvoutput.org failed: " << ex.what();
+		return Result::RETRY;
+	}
+
+	//quota exhausted, pvoutput.org accepts requests again at the reset time
+	try {
+		if (response.has("X-Rate-Limit-Remaining") && std::stol(response.get("X-Rate-Limit-Remaining")) <= 0 &&
+				response.has("X-Rate-Limit-Reset")) {
+			long wait = std::stol(response.get("X-Rate-Limit-Reset")) - std::time(nullptr);
+			LOG(Info) << "pvoutput.org request limit reached, pausing uploads for " << wait << " seconds";
+			std::lock_guard<std::mutex> lock(mutex);
+			retryLater(Clock::now() + std::chrono::seconds(std::max(wait, 0L)));
+		}
+	} catch (const std::logic_error& ex) {
+		LOG(Debug) << "Invalid pvoutput.org rate limit header: " << ex.what();
+	}
 
-	if (response.getStatus() != HTTPResponse::HTTP_OK) {
-		LOG(Error) << "Error sending day yield data. HTTP error: " << response.getStatus()
-				<< " " << rs.rdbuf();
+	HTTPResponse::HTTPStatus httpStatus = response.getStatus();
+	if (httpStatus == HTTPResponse::HTTP_FORBIDDEN || httpStatus >= HTTPResponse::HTTP_INTERNAL_SERVER_ERROR) {
+		//rate limit exceeded or server error, the data itself was not rejected
+		LOG(Error) << "Uploading to pvoutput.org failed. HTTP error: " << httpStatus << " " << result;
+		return Result::RETRY;
+	} else if (httpStatus != HTTPResponse::HTTP_OK) {
+		LOG(Error) << "pvoutput.org rejected " << batch.size() << " entries. HTTP error: " << httpStatus
+				<< " " << result;
+		return Result::REJECTED;
 	}
+
+	if (batched) {
+		//one entry per uploaded entry ending in 1 if it was added, 0 if not
+		std::size_t rejected = 0;
+		std::istringstream entries(result);
+		std::string entry;
+		while (std::getline(entries, entry, ';')) {
+			rejected += (!entry.empty() && entry.back() == '0');
+		}
+		if (rejected > 0) {
+			LOG(Warning) << "pvoutput.org did not add " << rejected << " of " << batch.size() << " entries";
+		}
+	}
+
+	return Result::SENT;
+}
+
+bool PvoutputUploader::takeRequest() {
+	Clock::time_point now = Clock::now();
+	double perSecond = settings.requestsPerHour / 3600.0;
+
+	requests = std::min<double>(settings.requestsPerHour,
+			requests + std::chrono::duration<double>(now - lastRefill).count() * perSecond);
+	lastRefill = now;
+
+	if (requests < 1) {
+		retryLater(now + std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double>((1 - requests) / perSecond)));
+		return false;
+	}
+
+	requests -= 1;
+	return true;
+}
+
+void PvoutputUploader::retryLater(Clock::time_point time) {
+	notBefore = std::max(notBefore, time);
 }
 
 void PvoutputUploader::uploadSpotData(const std::vector<SpotData>& spotDatas) {
@@ -163,10 +506,20 @@ void PvoutputUploader::uploadSpotData(const std::vector<SpotData>& spotDatas) {
 			yield = -1;
 		}
 	}
+
+	Upload upload;
+	upload.kind  = UploadKind::STATUS;
+	upload.time  = spotDatas.begin()->time;
+	upload.power = power;
+	if (yield >= 0) {
+		upload.energy = yield;
+	}
+
 	try {
-		uploadSpotDataSum(spotDatas.begin()->time, power, yield, id, apiKey);
+		enqueue(upload);
 	} catch (const std::exception& ex) {
-		LOG(Error) << "Uploading spot data to pvoutput failed: " << ex.what();
+		LOG(Error) << "Queueing spot data for pvoutput.org failed: " << ex.what();
+		failed.inc();
 	}
 }
 
@@ -181,14 +534,21 @@ void PvoutputUploader::uploadDayData(const std::vector<DayData>& dayDatas) {
 		return;
 	}
 
-	int32_t yield = 0;
-	for (const DayData& sd : dayDatas) {
-		yield += sd.dayYield;
+	std::map<bg::date, int32_t> yields;
+	for (const DayData& dd : dayDatas) {
+		yields[dd.date] += dd.dayYield;
 	}
 
 	try {
-		uploadDayDataSum(dayDatas.begin()->date, yield, id, apiKey);
+		for (const auto& yield : yields) {
+			Upload upload;
+			upload.kind   = UploadKind::OUTPUT;
+			upload.time   = pt::ptime(yield.first);
+			upload.energy = yield.second;
+			enqueue(upload);
+		}
 	} catch (const std::exception& ex) {
-		LOG(Error) << "Uploading day data to pvoutput failed: " << ex.what();
+		LOG(Error) << "Queueing day data for pvoutput.org failed: " << ex.what();
+		failed.inc();
 	}
 }
@@ -17,37 +17,157 @@
  * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #ifndef PVOUTPUT_UPLOADER_H
 #define PVOUTPUT_UPLOADER_H
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <boost/date_time/gregorian/gregorian.hpp>
-#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <Poco/Net/Context.h>
 
+#include "databaseaccess.h"
+#include "httpssessionpool.h"
+#include "utility.h"
+
 #include "models/spotdata.h"
 #include "models/daydata.h"
+#include "models/upload.h"
 
 namespace odb {
 	class database;
 }
 
+namespace Poco {
+	namespace Net {
+		class HTMLForm;
+	}
+}
+
+class ConfigReader;
+class Counter;
+class Gauge;
+
+/**
+ * Uploads live and day data to pvoutput.org.
+ *
+ * Data is stored in the upload_outbox table and uploaded by a background
+ * thread, so nothing is lost while pvoutput.org is unreachable or pvlog is
+ * restarted. Consecutive entries are sent batchSize at a time to the batch
+ * endpoints, a batch size of 1 sends every entry on its own to addstatus.jsp
+ * and addoutput.jsp.
+ *
+ * Failed uploads are retried with exponential backoff, requests are limited to
+ * requestsPerHour and the rate limit reported by pvoutput.org.
+ */
 class PvoutputUploader {
+	DISABLE_COPY(PvoutputUploader)
 public:
-	PvoutputUploader(odb::database* db);
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::WRITE;
+
+	struct Settings {
+		std::string host;
+		uint16_t port;
+		std::size_t batchSize; //entries per batch request, 1 uses addstatus.jsp and addoutput.jsp
+		boost::posix_time::time_duration batchDelay; //maximum time a live data interval waits for its batch
+		boost::posix_time::time_duration keepAlive;
+		std::size_t requestsPerHour;
+		boost::gregorian::date_duration maxAge; //older live data is not accepted by pvoutput.org
+
+		Settings();
+
+		static Settings read(const ConfigReader& configReader);
+	};
+
+	PvoutputUploader(odb::database* db, Settings settings);
+
+	~PvoutputUploader();
 
 	void uploadSpotData(const std::vector<model::SpotData>& spotDatas);
 
 	void uploadDayData(const std::vector<model::DayData>& dayData);
 
-protected:
-	void uploadSpotDataSum(boost::posix_time::ptime time, int32_t power, int32_t yield,
-			const std::string& systemId, const std::string& apiKey);
+	/**
+	 * Upload all queued data without waiting for full batches.
+	 */
+	void flush();
 
-	void uploadDayDataSum(boost::gregorian::date date, int32_t yield,
-			const std::string& systemId, const std::string& apiKey);
 private:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Result {
+		SENT,
+		REJECTED, //rejected by pvoutput.org, sending it again does not help
+		RETRY
+	};
+
+	void enqueue(const model::Upload& upload);
+
+	void work();
+
+	/**
+	 * Time the next request is due, Clock::time_point::max() if there is
+	 * nothing to send.
+	 */
+	Clock::time_point nextRequest() const;
+
+	/**
+	 * Send queued entries of kind, partial batches only if partial is set.
+	 * Returns false if sending has to be continued later.
+	 */
+	bool drain(model::UploadKind kind, bool partial);
+
+	std::vector<model::Upload> loadBatch(model::UploadKind kind);
+
+	//Time of the oldest queued live data interval, not_a_date_time if there is none
+	boost::posix_time::ptime oldestStatus();
+
+	void remove(const std::vector<model::Upload>& batch);
+
+	Result send(model::UploadKind kind, const std::vector<model::Upload>& batch);
+
+	/**
+	 * Post form to path, returns the response body. Throws Poco::Exception if
+	 * the request failed.
+	 */
+	std::string post(const std::string& path, Poco::Net::HTMLForm& form, const std::string& systemId,
+			const std::string& apiKey, Poco::Net::HTTPResponse& response);
+
+	/**
+	 * Take a request from the hourly quota. Returns false and sets notBefore
+	 * if it is exhausted.
+	 */
+	bool takeRequest();
+
+	void retryLater(Clock::time_point time);
+
 	odb::database* db;
+	Settings settings;
 	Poco::Net::Context::Ptr ptrContext;
+	std::unique_ptr<HttpsSessionPool> sessionPool;
+
+	mutable std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopped;
+	bool flushRequested;
+	std::size_t queued;                       //entries in the outbox
+	boost::posix_time::ptime oldestQueued;    //oldest live data interval, not_a_date_time if unknown
+	Clock::time_point notBefore;              //backoff or rate limit
+	int failures;                             //consecutive failed requests
+	double requests;                          //requests left of the hourly quota
+	Clock::time_point lastRefill;
+
+	Gauge& queueDepth;
+	Counter& failed;
+	std::thread worker;
 };
 
 #endif //#ifndef PVOUTPUT_UPLOADER_H
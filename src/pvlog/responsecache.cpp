@@ -0,0 +1,114 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "responsecache.h"
+
+namespace bg = boost::gregorian;
+
+ResponseCache::ResponseCache(std::size_t maxBytes) :
+		maxBytes(maxBytes),
+		bytes(0),
+		gen(0),
+		hits(0),
+		misses(0),
+		evictions(0),
+		invalidations(0) {
+	//nothing to do
+}
+
+ResponseCache::Value ResponseCache::get(const std::string& key) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = index.find(key);
+	if (it == index.end()) {
+		++misses;
+		return nullptr;
+	}
+
+	entries.splice(entries.begin(), entries, it->second);
+	++hits;
+	return it->second->value;
+}
+
+uint64_t ResponseCache::generation() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return gen;
+}
+
+void ResponseCache::put(const std::string& key, Value value, bg::date first, bg::date last,
+		uint64_t generation) {
+	std::size_t size = key.size() + value->bytes();
+	if (size > maxBytes) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (generation != gen) {
+		return;
+	}
+
+	auto it = index.find(key);
+	if (it != index.end()) {
+		erase(it->second);
+	}
+
+	entries.push_front(Entry{key, std::move(value), first, last});
+	index.emplace(key, entries.begin());
+	bytes += size;
+
+	while (bytes > maxBytes) {
+		erase(std::prev(entries.end()));
+		++evictions;
+	}
+}
+
+void ResponseCache::invalidate(bg::date date) {
+	std::lock_guard<std::mutex> lock(mutex);
+	++gen;
+
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		auto next = std::next(it);
+		if (it->first <= date && date <= it->last) {
+			erase(it);
+			++invalidations;
+		}
+		it = next;
+	}
+}
+
+void ResponseCache::invalidateAll() {
+	std::lock_guard<std::mutex> lock(mutex);
+	++gen;
+
+	invalidations += entries.size();
+	entries.clear();
+	index.clear();
+	bytes = 0;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return Stats{hits, misses, evictions, invalidations, entries.size(), bytes};
+}
+
+void ResponseCache::erase(Entries::iterator it) {
+	bytes -= it->key.size() + it->value->bytes();
+	index.erase(it->key);
+	entries.erase(it);
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_RESPONSECACHE_H_
+#define SRC_PVLOG_RESPONSECACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+
+#include "compression.h"
+#include "utility.h"
+
+/**
+ * Memory bounded LRU cache of serialized RPC results, the memory of their
+ * precompressed forms is included.
+ *
+ * Every entry covers a range of (local) dates, invalidate removes all
+ * entries whose range contains the changed date.
+ */
+class ResponseCache {
+	DISABLE_COPY(ResponseCache)
+public:
+	using Value = PayloadPtr;
+
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		uint64_t invalidations;
+		std::size_t entries;
+		std::size_t bytes;
+	};
+
+	explicit ResponseCache(std::size_t maxBytes);
+
+	/**
+	 * Cached value of key or nullptr.
+	 */
+	Value get(const std::string& key);
+
+	/**
+	 * Current generation, incremented by every invalidation.
+	 */
+	uint64_t generation() const;
+
+	/**
+	 * Insert value covering first to last, if the cache was not invalidated
+	 * since generation was read. So results computed while their data changed
+	 * are never cached.
+	 */
+	void put(const std::string& key, Value value, boost::gregorian::date first,
+	         boost::gregorian::date last, uint64_t generation);
+
+	void invalidate(boost::gregorian::date date);
+
+	void invalidateAll();
+
+	Stats stats() const;
+
+private:
+	struct Entry {
+		std::string key;
+		Value value;
+		boost::gregorian::date first;
+		boost::gregorian::date last;
+	};
+	using Entries = std::list<Entry>;
+
+	void erase(Entries::iterator it);
+
+	std::size_t maxBytes;
+
+	mutable std::mutex mutex;
+	Entries entries; //most recently used first
+	std::unordered_map<std::string, Entries::iterator> index;
+	std::size_t bytes;
+	uint64_t gen;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	uint64_t evictions;
+	uint64_t invalidations;
+};
+
+#endif /* SRC_PVLOG_RESPONSECACHE_H_ */
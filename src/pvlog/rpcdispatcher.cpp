@@ -0,0 +1,351 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rpcdispatcher.h"
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <set>
+#include <vector>
+
+#include <jsoncpp/json/reader.h>
+#include <jsoncpp/json/writer.h>
+
+#include "httpserverconnector.h"
+#include "jsonrpcserver.h"
+#include "log.h"
+#include "metrics.h"
+#include "msgpackwriter.h"
+#include "pvlogexception.h"
+
+//json-rpc implementation defined server errors
+static const int SERVER_BUSY     = -32000;
+static const int SERVER_STARTING = -32001;
+
+static const char* REQUEST_TIME_NAME = "pvlog_rpc_request_duration_seconds";
+static const char* REQUEST_TIME_HELP = "Time from receiving a rpc request till its response is ready";
+
+//methods of jsonrpc-interface.json
+static const char* METHODS[] = {
+	"getSpotData",
+	"getSpotDataRange",
+	"getLiveSpotData",
+	"getDataloggerStatus",
+	"getDayData",
+	"getDayStats",
+	"getMonthData",
+	"getMonthStats",
+	"getStatistics",
+	"getYearData",
+	"getInverters",
+	"getPlants",
+	"getEvents"
+};
+
+static bool isCacheable(const Json::Value& req) {
+	return req.isObject() && req["jsonrpc"] == "2.0" && req["method"].isString() && req.isMember("id")
+			&& (req["id"].isString() || req["id"].isIntegral() || req["id"].isNull())
+			&& (req["params"].isNull() || req["params"].isObject());
+}
+
+static void writeResponse(const Json::Value& value, ResponseEncoding encoding, std::string& out) {
+	if (encoding == ResponseEncoding::MSGPACK) {
+		util::MsgPackWriter(out).value(value);
+	} else {
+		Json::FastWriter writer;
+		out += writer.write(value);
+	}
+}
+
+static void serverError(const Json::Value& request, int code, const char* message, ResponseEncoding encoding,
+		std::string& out) {
+	Json::Value error;
+	error["jsonrpc"] = "2.0";
+	error["id"] = request.isObject() ? request["id"] : Json::Value();
+	error["error"]["code"] = code;
+	error["error"]["message"] = message;
+	writeResponse(error, encoding, out);
+}
+
+static void busyError(const Json::Value& request, ResponseEncoding encoding, std::string& out) {
+	serverError(request, SERVER_BUSY, "Server busy", encoding, out);
+}
+
+static void startingError(const Json::Value& request, ResponseEncoding encoding, std::string& out) {
+	serverError(request, SERVER_STARTING, "Server starting, database not ready", encoding, out);
+}
+
+static void envelopeBegin(const Json::Value& id, ResponseEncoding encoding, std::string& out) {
+	if (encoding == ResponseEncoding::MSGPACK) {
+		util::MsgPackWriter writer(out);
+		writer.beginObject(3);
+		writer.key("id").value(id);
+		writer.key("jsonrpc").value("2.0");
+		writer.key("result");
+		return;
+	}
+
+	Json::FastWriter writer;
+	std::string idString = writer.write(id);
+	idString.pop_back(); //FastWriter appends a newline
+
+	out += "{\"id\":" + idString + ",\"jsonrpc\":\"2.0\",\"result\":";
+}
+
+static void envelopeEnd(ResponseEncoding encoding, std::string& out) {
+	if (encoding == ResponseEncoding::JSON) {
+		out += '}';
+	}
+}
+
+std::size_t RpcResponse::size() const {
+	return head.size() + (payload != nullptr ? payload->data.size() : 0) + tail.size();
+}
+
+std::string RpcResponse::str() const {
+	return payload != nullptr ? head + payload->data + tail : head + tail;
+}
+
+RpcDispatcher::RpcDispatcher(HttpServerConnector& connector, JsonRpcServer* server, RpcWorkerPool* workerPool) :
+		connector(connector),
+		handler(connector.GetHandler()),
+		server(server),
+		workerPool(workerPool),
+		databaseReady(false),
+		otherRequestTime(MetricsRegistry::instance().histogram(REQUEST_TIME_NAME, REQUEST_TIME_HELP,
+				{{"method", "other"}})) {
+	PVLOG_NOT_NULL(handler);
+	PVLOG_NOT_NULL(server);
+	PVLOG_NOT_NULL(workerPool);
+
+	for (const char* method : METHODS) {
+		requestTimes[method] = &MetricsRegistry::instance().histogram(REQUEST_TIME_NAME, REQUEST_TIME_HELP,
+				{{"method", method}});
+	}
+
+	connector.SetHandler(this);
+	connector.setDispatcher(this);
+}
+
+RpcDispatcher::~RpcDispatcher() {
+	connector.setDispatcher(nullptr);
+	connector.SetHandler(handler);
+}
+
+void RpcDispatcher::HandleRequest(const std::string& request, std::string& retValue) {
+	RpcResponse response;
+	handleRequest(request, ResponseEncoding::JSON, response);
+	retValue = response.str();
+}
+
+Histogram& RpcDispatcher::requestTime(const Json::Value& request) const {
+	if (request.isObject() && request["method"].isString()) {
+		auto it = requestTimes.find(request["method"].asString());
+		if (it != requestTimes.end()) {
+			return *it->second;
+		}
+	}
+	return otherRequestTime;
+}
+
+void RpcDispatcher::setDatabaseReady() {
+	databaseReady = true;
+}
+
+bool RpcDispatcher::needsDatabase(const Json::Value& request) const {
+	static const std::set<std::string> memoryMethods = {
+		"getDataloggerStatus",
+		"getLiveSpotData"
+	};
+
+	if (databaseReady) {
+		return false;
+	}
+	return !(request.isObject() && request["method"].isString()
+			&& memoryMethods.count(request["method"].asString()) != 0);
+}
+
+RpcWorkerPool::Lane RpcDispatcher::lane(const Json::Value& request) {
+	static const std::set<std::string> fastMethods = {
+		"getDataloggerStatus",
+		"getLiveSpotData",
+		"getInverters",
+		"getPlants"
+	};
+
+	if (request.isObject() && request["method"].isString() && fastMethods.count(request["method"].asString()) != 0) {
+		return RpcWorkerPool::Lane::FAST;
+	}
+	return RpcWorkerPool::Lane::SLOW;
+}
+
+void RpcDispatcher::handleRequest(const std::string& request, ResponseEncoding encoding, RpcResponse& response) {
+	Json::Reader reader;
+	Json::Value req;
+	if (!reader.parse(request, req, false)) {
+		req = Json::Value(); //invalid json is answered by the handler
+	}
+
+	if (req.isArray() && req.size() != 0) {
+		executeBatch(req, encoding, response);
+		return;
+	}
+
+	Histogram::Timer timer(requestTime(req));
+	if (cachedResponse(req, encoding, response)) {
+		return;
+	}
+	if (needsDatabase(req)) {
+		startingError(req, encoding, response.head);
+		return;
+	}
+
+	std::future<void> result = workerPool->submit(lane(req), [&]() {
+		execute(req, request, encoding, response);
+	});
+	if (!result.valid()) {
+		busyError(req, encoding, response.head);
+		return;
+	}
+	result.get();
+}
+
+bool RpcDispatcher::cachedResponse(const Json::Value& request, ResponseEncoding encoding, RpcResponse& response) {
+	if (!isCacheable(request)) {
+		return false;
+	}
+
+	response.payload = server->cachedResult(request["method"].asString(), request["params"], encoding);
+	if (response.payload == nullptr) {
+		return false;
+	}
+	envelopeBegin(request["id"], encoding, response.head);
+	envelopeEnd(encoding, response.tail);
+	return true;
+}
+
+void RpcDispatcher::execute(const Json::Value& request, const std::string& requestString, ResponseEncoding encoding,
+		RpcResponse& response) {
+	if (isCacheable(request)) {
+		//the envelope is built around the serialized result
+		response.payload = server->serializedResult(request["method"].asString(), request["params"], encoding);
+		if (response.payload != nullptr) {
+			envelopeBegin(request["id"], encoding, response.head);
+			envelopeEnd(encoding, response.tail);
+			return;
+		}
+	}
+
+	std::string& result = response.head;
+	handler->HandleRequest(requestString, result);
+
+	//notifications have no response
+	if (encoding == ResponseEncoding::MSGPACK && !result.empty()) {
+		Json::Reader reader;
+		Json::Value value;
+		if (!reader.parse(result, value, false)) {
+			PVLOG_EXCEPT("Invalid json-rpc response: " + reader.getFormattedErrorMessages());
+		}
+		result.clear();
+		util::MsgPackWriter(result).value(value);
+	}
+}
+
+void RpcDispatcher::executeBatch(const Json::Value& batch, ResponseEncoding encoding, RpcResponse& response) {
+	Json::FastWriter writer;
+	std::vector<RpcResponse> responses(batch.size());
+	std::vector<std::future<void>> results(batch.size());
+	auto start = std::chrono::steady_clock::now();
+
+	for (Json::ArrayIndex i = 0; i < batch.size(); ++i) {
+		const Json::Value& request = batch[i];
+		if (cachedResponse(request, encoding, responses[i])) {
+			requestTime(request).record(std::chrono::steady_clock::now() - start);
+			continue;
+		}
+		if (needsDatabase(request)) {
+			startingError(request, encoding, responses[i].head);
+			continue;
+		}
+
+		std::string requestString = writer.write(request);
+		results[i] = workerPool->submit(lane(request),
+				[this, &request, requestString, encoding, &responses, i, start]() {
+			execute(request, requestString, encoding, responses[i]);
+			requestTime(request).record(std::chrono::steady_clock::now() - start);
+		});
+		if (!results[i].valid()) {
+			busyError(request, encoding, responses[i].head);
+		}
+	}
+
+	//all tasks have to finish before returning, they reference batch and responses
+	std::exception_ptr exception;
+	for (std::future<void>& result : results) {
+		if (result.valid()) {
+			try {
+				result.get();
+			} catch (...) {
+				exception = std::current_exception();
+			}
+		}
+	}
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+
+	//notifications have no response, a batch of notifications has none at all
+	std::size_t count = 0;
+	for (const RpcResponse& r : responses) {
+		count += (r.size() != 0);
+	}
+	if (count == 0) {
+		return;
+	}
+
+	std::string& out = response.head;
+	if (encoding == ResponseEncoding::MSGPACK) {
+		util::MsgPackWriter(out).beginArray(count);
+	} else {
+		out += '[';
+	}
+
+	bool first = true;
+	for (const RpcResponse& r : responses) {
+		if (r.size() == 0) {
+			continue;
+		}
+		std::string s = r.str();
+		if (encoding == ResponseEncoding::JSON) {
+			if (!first) {
+				out += ',';
+			}
+			//handler responses end with a newline
+			out.append(s, 0, s.find_last_not_of('\n') + 1);
+		} else {
+			out += s;
+		}
+		first = false;
+	}
+
+	if (encoding == ResponseEncoding::JSON) {
+		out += ']';
+	}
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_RPCDISPATCHER_H_
+#define SRC_PVLOG_RPCDISPATCHER_H_
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+#include <jsoncpp/json/value.h>
+#include <jsonrpccpp/server/iclientconnectionhandler.h>
+
+#include "compression.h"
+#include "responseencoding.h"
+#include "rpcworkerpool.h"
+#include "utility.h"
+
+class Histogram;
+class HttpServerConnector;
+class JsonRpcServer;
+
+/**
+ * Body of a rpc response, payload is sent between head and tail without
+ * copying it.
+ */
+struct RpcResponse {
+	std::string head;
+	PayloadPtr payload;
+	std::string tail;
+
+	std::size_t size() const;
+
+	std::string str() const;
+};
+
+/**
+ * Connection handler in front of the json-rpc-cpp handler of a JsonRpcServer.
+ *
+ * Single requests of methods the server can answer with an already serialized
+ * result are answered directly, the envelope is built around the result string.
+ * Everything else, including batches and invalid requests, is passed on.
+ *
+ * Responses of passed on requests are converted if another encoding than json
+ * is requested, cached results are stored in the requested encoding.
+ *
+ * Results in the response cache are returned from the connection thread,
+ * all other requests are executed by the worker pool: cheap methods in the
+ * fast lane, everything else in the slow lane. The elements of batch requests
+ * are executed in parallel.
+ *
+ * The time from receiving a request till its response is ready is recorded
+ * per method in the metrics registry.
+ *
+ * Until setDatabaseReady is called only methods answered from memory
+ * (datalogger status and live data) are executed, all others get an error.
+ * So the server can listen while the database is migrated at startup.
+ */
+class RpcDispatcher : public jsonrpc::IClientConnectionHandler {
+	DISABLE_COPY(RpcDispatcher)
+public:
+	/**
+	 * Installs itself as handler of connector, server has to be
+	 * constructed with the same connector before.
+	 */
+	RpcDispatcher(HttpServerConnector& connector, JsonRpcServer* server, RpcWorkerPool* workerPool);
+
+	virtual ~RpcDispatcher();
+
+	virtual void HandleRequest(const std::string& request, std::string& retValue) override;
+
+	void handleRequest(const std::string& request, ResponseEncoding encoding, RpcResponse& response);
+
+	//Database is migrated and can be queried
+	void setDatabaseReady();
+
+private:
+	static RpcWorkerPool::Lane lane(const Json::Value& request);
+
+	//request needs the database and it is not ready yet
+	bool needsDatabase(const Json::Value& request) const;
+
+	//Latency histogram of the method of request
+	Histogram& requestTime(const Json::Value& request) const;
+
+	bool cachedResponse(const Json::Value& request, ResponseEncoding encoding, RpcResponse& response);
+
+	/**
+	 * Execute single request, request is the parsed form of requestString if it is valid json.
+	 */
+	void execute(const Json::Value& request, const std::string& requestString, ResponseEncoding encoding,
+			RpcResponse& response);
+
+	void executeBatch(const Json::Value& batch, ResponseEncoding encoding, RpcResponse& response);
+
+	HttpServerConnector& connector;
+	jsonrpc::IClientConnectionHandler* handler;
+	JsonRpcServer* server;
+	RpcWorkerPool* workerPool;
+	std::atomic<bool> databaseReady;
+
+	//per method, unknown methods share one histogram
+	std::unordered_map<std::string, Histogram*> requestTimes;
+	Histogram& otherRequestTime;
+};
+
+#endif /* SRC_PVLOG_RPCDISPATCHER_H_ */
@@ -0,0 +1,120 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rpcworkerpool.h"
+
+#include <algorithm>
+
+#include "log.h"
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+RpcWorkerPool::RpcWorkerPool(std::size_t fastThreads, std::size_t slowThreads, std::size_t maxQueued) :
+		maxQueued(maxQueued),
+		stopped(false),
+		fast(),
+		slow() {
+	LOG(Info) << "Rpc worker pool: " << fastThreads << " fast threads, " << slowThreads << " slow threads";
+
+	fast.stats.threads = std::max<std::size_t>(fastThreads, 1);
+	slow.stats.threads = std::max<std::size_t>(slowThreads, 1);
+
+	for (Queue* q : {&fast, &slow}) {
+		for (std::size_t i = 0; i < q->stats.threads; ++i) {
+			q->threads.emplace_back(&RpcWorkerPool::work, this, std::ref(*q));
+		}
+	}
+}
+
+RpcWorkerPool::~RpcWorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	fast.taskAvailable.notify_all();
+	slow.taskAvailable.notify_all();
+
+	for (Queue* q : {&fast, &slow}) {
+		for (std::thread& thread : q->threads) {
+			thread.join();
+		}
+	}
+}
+
+RpcWorkerPool::Queue& RpcWorkerPool::queue(Lane lane) {
+	return lane == Lane::FAST ? fast : slow;
+}
+
+std::future<void> RpcWorkerPool::submit(Lane lane, std::function<void ()> task) {
+	Queue& q = queue(lane);
+	std::future<void> future;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopped || q.tasks.size() >= maxQueued) {
+			++q.stats.rejected;
+			return future;
+		}
+
+		Task t{std::packaged_task<void ()>(std::move(task)), steady_clock::now()};
+		future = t.task.get_future();
+		q.tasks.push_back(std::move(t));
+	}
+	q.taskAvailable.notify_one();
+
+	return future;
+}
+
+void RpcWorkerPool::work(Queue& q) {
+	for (;;) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			q.taskAvailable.wait(lock, [&]() { return stopped || !q.tasks.empty(); });
+
+			//queued tasks are executed before stopping, their callers wait for them
+			if (q.tasks.empty()) {
+				return;
+			}
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+		}
+
+		steady_clock::time_point start = steady_clock::now();
+		task.task();
+		steady_clock::time_point end = steady_clock::now();
+
+		microseconds queueTime = std::chrono::duration_cast<microseconds>(start - task.queued);
+		std::lock_guard<std::mutex> lock(mutex);
+		++q.stats.completed;
+		q.stats.queueTime   += queueTime;
+		q.stats.maxQueueTime = std::max(q.stats.maxQueueTime, queueTime);
+		q.stats.runTime     += std::chrono::duration_cast<microseconds>(end - start);
+	}
+}
+
+RpcWorkerPool::LaneStats RpcWorkerPool::stats(Lane lane) const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const Queue& q = (lane == Lane::FAST) ? fast : slow;
+	LaneStats stats = q.stats;
+	stats.queued = q.tasks.size();
+	return stats;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_RPCWORKERPOOL_H_
+#define SRC_PVLOG_RPCWORKERPOOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utility.h"
+
+/**
+ * Worker threads executing rpc requests.
+ *
+ * Requests are queued in one of two lanes with their own threads, so slow
+ * database queries can not delay cheap requests in the fast lane. Queues are
+ * bounded, requests exceeding the queue size are rejected.
+ */
+class RpcWorkerPool {
+	DISABLE_COPY(RpcWorkerPool)
+public:
+	enum class Lane {
+		FAST,
+		SLOW
+	};
+
+	struct LaneStats {
+		std::size_t threads;
+		std::size_t queued;
+		uint64_t completed;
+		uint64_t rejected;
+		std::chrono::microseconds queueTime;    //sum over all completed tasks
+		std::chrono::microseconds maxQueueTime;
+		std::chrono::microseconds runTime;      //sum over all completed tasks
+	};
+
+	RpcWorkerPool(std::size_t fastThreads, std::size_t slowThreads, std::size_t maxQueued);
+
+	~RpcWorkerPool();
+
+	/**
+	 * Queue task in lane. The returned future is invalid if the queue is full,
+	 * exceptions of task are rethrown by the future.
+	 */
+	std::future<void> submit(Lane lane, std::function<void ()> task);
+
+	LaneStats stats(Lane lane) const;
+
+private:
+	struct Task {
+		std::packaged_task<void ()> task;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	struct Queue {
+		std::deque<Task> tasks;
+		std::condition_variable taskAvailable;
+		std::vector<std::thread> threads;
+		LaneStats stats;
+	};
+
+	Queue& queue(Lane lane);
+
+	void work(Queue& queue);
+
+	const std::size_t maxQueued;
+
+	mutable std::mutex mutex;
+	bool stopped;
+	Queue fast;
+	Queue slow;
+};
+
+#endif /* SRC_PVLOG_RPCWORKERPOOL_H_ */
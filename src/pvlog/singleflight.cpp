@@ -0,0 +1,64 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "singleflight.h"
+
+SingleFlight::SingleFlight() :
+		computed(0),
+		shared(0) {
+	//nothing to do
+}
+
+SingleFlight::Result SingleFlight::run(const std::string& key, const std::function<Result ()>& compute) {
+	std::promise<Result> promise;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto it = calls.find(key);
+		if (it != calls.end()) {
+			std::shared_future<Result> call = it->second;
+			++shared;
+			lock.unlock();
+			return call.get();
+		}
+		calls.emplace(key, promise.get_future().share());
+		++computed;
+	}
+
+	//remove the call before publishing the result, later callers compute a new one
+	auto finish = [this, &key]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		calls.erase(key);
+	};
+
+	try {
+		Result result = compute();
+		finish();
+		promise.set_value(result);
+		return result;
+	} catch (...) {
+		finish();
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+SingleFlight::Stats SingleFlight::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return Stats{computed, shared, calls.size()};
+}
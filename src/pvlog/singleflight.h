@@ -0,0 +1,70 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SINGLEFLIGHT_H_
+#define SRC_PVLOG_SINGLEFLIGHT_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "compression.h"
+#include "utility.h"
+
+/**
+ * Coalesces concurrent computations of the same key.
+ *
+ * The first caller of run computes the result, callers with the same key
+ * arriving while it is in flight wait for it and share the result instead of
+ * computing it again. Nothing is kept after the computation completed, caching
+ * is left to the caller.
+ */
+class SingleFlight {
+	DISABLE_COPY(SingleFlight)
+public:
+	using Result = PayloadPtr;
+
+	struct Stats {
+		uint64_t computed; //results computed
+		uint64_t shared;   //calls served by an in-flight computation
+		std::size_t inFlight;
+	};
+
+	SingleFlight();
+
+	/**
+	 * Result of compute for key, computed once for all concurrent callers.
+	 * Exceptions of compute are rethrown to all of them.
+	 */
+	Result run(const std::string& key, const std::function<Result ()>& compute);
+
+	Stats stats() const;
+
+private:
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, std::shared_future<Result>> calls;
+	uint64_t computed;
+	uint64_t shared;
+};
+
+#endif /* SRC_PVLOG_SINGLEFLIGHT_H_ */
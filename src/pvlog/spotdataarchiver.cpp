@@ -0,0 +1,296 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define PVLOG_LOG_MODULE "spotdataarchiver"
+
+#include "spotdataarchiver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <odb/database.hxx>
+#include <odb/session.hxx>
+#include <odb/transaction.hxx>
+
+#include "log.h"
+#include "pvlogexception.h"
+#include "spotdatacodec.h"
+#include "timeutil.h"
+
+#include "models/inverter.h"
+#include "models/inverter_odb.h"
+#include "models/querycache.h"
+#include "models/spotdata.h"
+#include "models/spotdata_odb.h"
+#include "models/spotdataarchive.h"
+#include "models/spotdataarchive_odb.h"
+
+namespace bg = boost::gregorian;
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+using model::SpotDataPtr;
+using model::SpotDataPower;
+using model::SpotDataArchive;
+using model::SpotDataArchivePtr;
+using model::InverterPtr;
+
+typedef boost::date_time::c_local_adjustor<pt::ptime> local_adj;
+
+namespace {
+
+struct TimeRange {
+	pt::ptime begin;
+	pt::ptime end;
+};
+
+template<typename Map>
+bool sameValues(const Map& a, const Map& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+
+	for (const auto& entry : a) {
+		auto it = b.find(entry.first);
+		if (it == b.end() || entry.second.power != it->second.power
+				|| entry.second.voltage != it->second.voltage || entry.second.current != it->second.current) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool sameSpotData(const std::vector<SpotData>& a, const std::vector<SpotData>& b) {
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const SpotData& x, const SpotData& y) {
+		return x.time == y.time && x.power == y.power && x.dayYield == y.dayYield && x.frequency == y.frequency
+				&& sameValues(x.phases, y.phases) && sameValues(x.dcInputs, y.dcInputs);
+	});
+}
+
+pt::ptime dayBegin(bg::date date) {
+	return util::local_to_utc(pt::ptime(date));
+}
+
+double perSecond(size_t count, std::chrono::microseconds duration) {
+	return duration.count() == 0 ? 0 : count * 1e6 / duration.count();
+}
+
+void decode(const SpotDataArchive& archive, std::vector<SpotData>& spotDatas) {
+	spotDatas = decodeSpotData(archive.data, archive.inverter);
+}
+
+void decode(const SpotDataArchive& archive, std::vector<SpotDataPower>& spotDatas) {
+	spotDatas = decodeSpotDataPower(archive.data, archive.inverter->id);
+}
+
+} //namespace {
+
+SpotDataArchiver::SpotDataArchiver(odb::database* db, int archiveAfterDays) :
+		db(db),
+		archiveAfterDays(archiveAfterDays) {
+	PVLOG_NOT_NULL(db);
+
+	if (archiveAfterDays < 0) {
+		PVLOG_EXCEPT("archive_after_days must not be negative");
+	}
+}
+
+void SpotDataArchiver::archive() {
+	using Query = odb::query<SpotData>;
+
+	if (archiveAfterDays == 0) {
+		return;
+	}
+
+	pt::ptime cutoff = dayBegin(bg::day_clock::local_day() - bg::days(archiveAfterDays));
+	LOG(Debug) << "Archiving spot data before " << cutoff;
+
+	for (;;) {
+		bg::date date;
+		{
+			odb::session session;
+			odb::transaction t(db->begin());
+			SpotDataPtr oldest(db->query_one<SpotData>((Query::time < cutoff)
+					+ "ORDER BY" + Query::time + "LIMIT 1"));
+			t.commit();
+
+			if (oldest == nullptr) {
+				return;
+			}
+			date = local_adj::utc_to_local(oldest->time).date();
+		}
+
+		try {
+			archiveDay(date);
+		} catch (const std::exception& ex) {
+			LOG(Error) << "Archiving spot data of " << date << " failed: " << ex.what();
+			return;
+		}
+	}
+}
+
+void SpotDataArchiver::archiveDay(bg::date date) {
+	using Query        = odb::query<SpotData>;
+	using ArchiveQuery = odb::query<SpotDataArchive>;
+
+	pt::ptime begin = dayBegin(date);
+	pt::ptime end   = dayBegin(date + bg::days(1));
+
+	odb::session session;
+	odb::transaction t(db->begin());
+
+	std::map<int64_t, std::vector<SpotData>> inverterSpotData;
+	odb::result<SpotData> r(db->query<SpotData>((Query::time >= begin && Query::time < end)
+			+ "ORDER BY" + Query::time));
+	for (const SpotData& sd : r) {
+		inverterSpotData[sd.inverter->id].push_back(sd);
+	}
+
+	for (auto& entry : inverterSpotData) {
+		std::vector<SpotData>& spotDatas = entry.second;
+		InverterPtr inverter = spotDatas.front().inverter;
+
+		//merge rows written after the day was archived, e.g. by an import
+		SpotDataArchivePtr archive(db->query_one<SpotDataArchive>(
+				ArchiveQuery::inverter == inverter->id && ArchiveQuery::date == date));
+		if (archive != nullptr) {
+			for (SpotData& sd : decodeSpotData(archive->data, inverter)) {
+				spotDatas.push_back(std::move(sd));
+			}
+			std::stable_sort(spotDatas.begin(), spotDatas.end(), [](const SpotData& a, const SpotData& b) {
+				return a.time < b.time;
+			});
+			spotDatas.erase(std::unique(spotDatas.begin(), spotDatas.end(), [](const SpotData& a, const SpotData& b) {
+				return a.time == b.time;
+			}), spotDatas.end());
+		} else {
+			archive = std::make_shared<SpotDataArchive>();
+			archive->inverter = inverter;
+			archive->date     = date;
+		}
+
+		std::vector<char> data = encodeSpotData(spotDatas);
+
+		//never drop rows which can not be restored
+		auto decodeStart = std::chrono::steady_clock::now();
+		std::vector<SpotData> decoded = decodeSpotData(data, inverter);
+		auto decodeTime = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - decodeStart);
+		if (!sameSpotData(spotDatas, decoded)) {
+			PVLOG_EXCEPT("Decoded spot data differs from original");
+		}
+
+		size_t rawSize = rowSize(spotDatas);
+		LOG(Info) << inverter->name << " archived " << date << ": " << spotDatas.size() << " samples, "
+				<< rawSize << " -> " << data.size() << " bytes (ratio "
+				<< static_cast<double>(rawSize) / data.size() << "), decoded in " << decodeTime.count()
+				<< "us (" << perSecond(spotDatas.size(), decodeTime) << " samples/s)";
+
+		archive->firstTime   = spotDatas.front().time;
+		archive->lastTime    = spotDatas.back().time;
+		archive->sampleCount = spotDatas.size();
+		archive->data        = std::move(data);
+		if (archive->id == 0) {
+			db->persist(archive);
+		} else {
+			db->update(archive);
+		}
+	}
+
+	//phase and dc input rows are deleted by ON DELETE CASCADE
+	db->erase_query<SpotData>(Query::time >= begin && Query::time < end);
+	t.commit();
+}
+
+template<typename T>
+struct ArchivedSpotDataReader<T>::Chunks {
+	odb::prepared_query<SpotDataArchive> query;
+	odb::result<SpotDataArchive> result;
+	odb::result<SpotDataArchive>::iterator it;
+	SpotDataArchive archive; //chunks are loaded into one instance
+};
+
+template<typename T>
+ArchivedSpotDataReader<T>::ArchivedSpotDataReader(odb::database* db, pt::ptime begin, pt::ptime end) :
+		begin(begin),
+		end(end),
+		pos(0),
+		decoded(0),
+		decodeTime(0) {
+	using Query = odb::query<SpotDataArchive>;
+
+	TimeRange* range;
+	odb::prepared_query<SpotDataArchive> query(model::cachedQuery<SpotDataArchive>("archived-spot-data", range,
+			[](TimeRange& r) {
+				Query filterChunks(Query::firstTime < Query::_ref(r.end) && Query::lastTime >= Query::_ref(r.begin));
+				Query sortChunks("ORDER BY" + Query::inverter + "," + Query::firstTime);
+				return filterChunks + sortChunks;
+			}));
+	range->begin = begin;
+	range->end   = end;
+
+	chunks.reset(new Chunks{query, query.execute(), {}, {}});
+	chunks->it = chunks->result.begin();
+	skipToRange();
+}
+
+template<typename T>
+ArchivedSpotDataReader<T>::~ArchivedSpotDataReader() {
+	if (decoded != 0) {
+		LOG(Debug) << "Decoded " << decoded << " archived spot data in " << decodeTime.count()
+				<< "us (" << perSecond(decoded, decodeTime) << " samples/s)";
+	}
+}
+
+template<typename T>
+void ArchivedSpotDataReader<T>::next() {
+	++pos;
+	skipToRange();
+}
+
+template<typename T>
+void ArchivedSpotDataReader<T>::skipToRange() {
+	for (;;) {
+		for (; pos < samples.size(); ++pos) {
+			if (samples[pos].time >= begin && samples[pos].time < end) {
+				return;
+			}
+		}
+
+		if (chunks->it == chunks->result.end()) {
+			return;
+		}
+		chunks->it.load(chunks->archive);
+		++chunks->it;
+
+		auto decodeStart = std::chrono::steady_clock::now();
+		decode(chunks->archive, samples);
+		decodeTime += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - decodeStart);
+		decoded += samples.size();
+		pos = 0;
+	}
+}
+
+template class ArchivedSpotDataReader<SpotData>;
+template class ArchivedSpotDataReader<SpotDataPower>;
@@ -0,0 +1,109 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SPOTDATAARCHIVER_H_
+#define SRC_PVLOG_SPOTDATAARCHIVER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "databaseaccess.h"
+#include "utility.h"
+
+#include "models/spotdata.h"
+
+namespace odb {
+	class database;
+}
+
+/**
+ * Moves spot data of closed days into compressed per inverter and day chunks.
+ */
+class SpotDataArchiver {
+	DISABLE_COPY(SpotDataArchiver)
+public:
+	//Archiver replaces spot data rows by archive chunks
+	static constexpr DatabaseAccess DATABASE_ACCESS = DatabaseAccess::WRITE;
+
+	/**
+	 * Archive days older than archiveAfterDays, 0 disables archiving.
+	 */
+	SpotDataArchiver(odb::database* db, int archiveAfterDays);
+
+	/**
+	 * Archive all spot data rows of days older than archiveAfterDays.
+	 */
+	void archive();
+
+private:
+	void archiveDay(boost::gregorian::date date);
+
+	odb::database* db;
+	int archiveAfterDays;
+};
+
+/**
+ * Reads archived spot data with begin <= time < end ordered by inverter and time.
+ *
+ * Only one archive chunk is decoded at a time, memory usage does not depend on
+ * the time range. T is SpotData or SpotDataPower, for SpotDataPower only time and
+ * power are decoded. Has to be used inside a transaction and session.
+ */
+template<typename T>
+class ArchivedSpotDataReader {
+	DISABLE_COPY(ArchivedSpotDataReader)
+public:
+	ArchivedSpotDataReader(odb::database* db, boost::posix_time::ptime begin, boost::posix_time::ptime end);
+
+	~ArchivedSpotDataReader();
+
+	bool valid() const {
+		return pos < samples.size();
+	}
+
+	/**
+	 * Current sample, only if valid.
+	 */
+	const T& current() const {
+		return samples[pos];
+	}
+
+	void next();
+
+private:
+	struct Chunks;
+
+	//Advance to the next sample in the time range, decoding chunks as needed
+	void skipToRange();
+
+	boost::posix_time::ptime begin;
+	boost::posix_time::ptime end;
+	std::unique_ptr<Chunks> chunks;
+	std::vector<T> samples; //of the current chunk
+	std::size_t pos;
+	std::size_t decoded;
+	std::chrono::microseconds decodeTime;
+};
+
+#endif /* SRC_PVLOG_SPOTDATAARCHIVER_H_ */
@@ -0,0 +1,429 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define PVLOG_LOG_MODULE "spotdatabuffer"
+
+#include "spotdatabuffer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <odb/database.hxx>
+#include <odb/session.hxx>
+#include <odb/transaction.hxx>
+
+#include "configreader.h"
+#include "log.h"
+#include "metrics.h"
+#include "pvlogexception.h"
+
+#include "models/inverter.h"
+#include "models/inverter_odb.h"
+#include "models/querycache.h"
+#include "models/spotdata.h"
+#include "models/spotdata_odb.h"
+
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+using model::Phase;
+using model::DcInput;
+using model::Inverter;
+using model::InverterPtr;
+
+namespace {
+
+const uint32_t RECORD_MAGIC = 0x50564a31; //"PVJ1"
+
+enum : uint8_t {
+	HAS_VALUE_1 = 1,
+	HAS_VALUE_2 = 2,
+	HAS_VALUE_3 = 4
+};
+
+struct SpotDataKey {
+	pt::ptime time;
+	int64_t inverterId;
+};
+
+//Journal records are stored in host byte order, the journal is never moved to another machine
+template<typename T>
+void put(std::string& buf, T value) {
+	buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putOptional(std::string& buf, const boost::optional<int32_t>& value) {
+	put<int32_t>(buf, value.get_value_or(0));
+}
+
+uint8_t flags(const boost::optional<int32_t>& v1, const boost::optional<int32_t>& v2,
+		const boost::optional<int32_t>& v3) {
+	return (v1 ? HAS_VALUE_1 : 0) | (v2 ? HAS_VALUE_2 : 0) | (v3 ? HAS_VALUE_3 : 0);
+}
+
+class Reader {
+public:
+	Reader(const char* data, size_t size) : data(data), size(size), pos(0) {}
+
+	template<typename T>
+	T get() {
+		if (size - pos < sizeof(T)) {
+			PVLOG_EXCEPT("Truncated journal record");
+		}
+		T value;
+		memcpy(&value, data + pos, sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+
+	boost::optional<int32_t> getOptional(uint8_t flags, uint8_t flag) {
+		int32_t value = get<int32_t>();
+		return (flags & flag) ? boost::optional<int32_t>(value) : boost::none;
+	}
+
+	bool atEnd() const {
+		return pos == size;
+	}
+
+private:
+	const char* data;
+	size_t size;
+	size_t pos;
+};
+
+void serialize(std::string& buf, const SpotData& sd) {
+	put<int64_t>(buf, sd.inverter->id);
+	put<int64_t>(buf, pt::to_time_t(sd.time));
+	put<int32_t>(buf, sd.power);
+	put<uint8_t>(buf, flags(sd.dayYield, sd.frequency, boost::none));
+	putOptional(buf, sd.dayYield);
+	putOptional(buf, sd.frequency);
+
+	put<uint8_t>(buf, sd.phases.size());
+	for (const auto& entry : sd.phases) {
+		const Phase& phase = entry.second;
+		put<uint8_t>(buf, entry.first);
+		put<int32_t>(buf, phase.power);
+		put<uint8_t>(buf, flags(phase.voltage, phase.current, boost::none));
+		putOptional(buf, phase.voltage);
+		putOptional(buf, phase.current);
+	}
+
+	put<uint8_t>(buf, sd.dcInputs.size());
+	for (const auto& entry : sd.dcInputs) {
+		const DcInput& dcInput = entry.second;
+		put<uint8_t>(buf, entry.first);
+		put<uint8_t>(buf, flags(dcInput.power, dcInput.voltage, dcInput.current));
+		putOptional(buf, dcInput.power);
+		putOptional(buf, dcInput.voltage);
+		putOptional(buf, dcInput.current);
+	}
+}
+
+//Returns inverter id of record, inverter of spot data is not set
+int64_t deserialize(Reader& reader, SpotData& sd) {
+	int64_t inverterId = reader.get<int64_t>();
+	sd.time  = pt::from_time_t(reader.get<int64_t>());
+	sd.power = reader.get<int32_t>();
+	uint8_t f = reader.get<uint8_t>();
+	sd.dayYield  = reader.getOptional(f, HAS_VALUE_1);
+	sd.frequency = reader.getOptional(f, HAS_VALUE_2);
+
+	int phaseNum = reader.get<uint8_t>();
+	for (int i = 0; i < phaseNum; ++i) {
+		Phase phase;
+		int num = reader.get<uint8_t>();
+		phase.power = reader.get<int32_t>();
+		f = reader.get<uint8_t>();
+		phase.voltage = reader.getOptional(f, HAS_VALUE_1);
+		phase.current = reader.getOptional(f, HAS_VALUE_2);
+		sd.phases.emplace(num, phase);
+	}
+
+	int dcInputNum = reader.get<uint8_t>();
+	for (int i = 0; i < dcInputNum; ++i) {
+		DcInput dcInput;
+		int num = reader.get<uint8_t>();
+		f = reader.get<uint8_t>();
+		dcInput.power   = reader.getOptional(f, HAS_VALUE_1);
+		dcInput.voltage = reader.getOptional(f, HAS_VALUE_2);
+		dcInput.current = reader.getOptional(f, HAS_VALUE_3);
+		sd.dcInputs.emplace(num, dcInput);
+	}
+
+	return inverterId;
+}
+
+uint32_t crc(const char* data, size_t size) {
+	boost::crc_32_type crc;
+	crc.process_bytes(data, size);
+	return crc.checksum();
+}
+
+} //namespace {
+
+SpotDataBuffer::Settings::Settings() :
+		flushInterval(pt::minutes(0)),
+		syncInterval(pt::seconds(0)) {
+	//nothing to do
+}
+
+SpotDataBuffer::Settings SpotDataBuffer::Settings::read(const ConfigReader& configReader) {
+	Settings settings;
+
+	try {
+		settings.journalFile   = configReader.getValue("spot_data_journal", "");
+		settings.flushInterval = pt::minutes(std::stoi(configReader.getValue("spot_data_flush_interval", "60")));
+		settings.syncInterval  = pt::seconds(std::stoi(configReader.getValue("spot_data_sync_interval", "0")));
+	} catch (const std::logic_error& ex) {
+		PVLOG_EXCEPT(std::string("Invalid spot data buffer setting: ") + ex.what());
+	}
+
+	if (settings.flushInterval.is_negative() || settings.syncInterval.is_negative()) {
+		PVLOG_EXCEPT("Spot data flush and sync interval must not be negative");
+	}
+
+	return settings;
+}
+
+SpotDataBuffer::SpotDataBuffer(odb::database* db, Settings settings) :
+		db(db),
+		settings(std::move(settings)),
+		journalFd(-1),
+		lastFlush(pt::second_clock::universal_time()),
+		lastSync(pt::second_clock::universal_time()) {
+	PVLOG_NOT_NULL(db);
+
+	if (isBuffered()) {
+		journalFd = ::open(this->settings.journalFile.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if (journalFd < 0) {
+			PVLOG_EXCEPT("Could not open spot data journal " + this->settings.journalFile + ": " + strerror(errno));
+		}
+
+		LOG(Info) << "Buffering spot data in " << this->settings.journalFile << ", flush interval: "
+				<< this->settings.flushInterval << ", sync interval: " << this->settings.syncInterval;
+	}
+}
+
+SpotDataBuffer::~SpotDataBuffer() {
+	try {
+		flush();
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Flushing spot data failed, will be recovered from journal: " << ex.what();
+	}
+
+	if (journalFd >= 0) {
+		::close(journalFd);
+	}
+}
+
+bool SpotDataBuffer::isBuffered() const {
+	return !settings.journalFile.empty();
+}
+
+void SpotDataBuffer::add(const std::vector<SpotData>& spotDatas) {
+	if (!isBuffered()) {
+		persist(spotDatas, false);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	appendJournal(spotDatas);
+	buffer.insert(buffer.end(), spotDatas.begin(), spotDatas.end());
+	lock.unlock();
+
+	if (pt::second_clock::universal_time() - lastFlush >= settings.flushInterval) {
+		flush();
+	}
+}
+
+void SpotDataBuffer::flush() {
+	std::vector<SpotData> flushed;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	lastFlush = pt::second_clock::universal_time();
+	if (buffer.empty()) {
+		return;
+	}
+
+	LOG(Debug) << "Flushing " << buffer.size() << " buffered spot data";
+	persist(buffer, false);
+	flushed.swap(buffer);
+	truncateJournal();
+	lock.unlock();
+
+	flushSig(flushed);
+}
+
+void SpotDataBuffer::recover() {
+	if (!isBuffered()) {
+		return;
+	}
+
+	std::ifstream journal(settings.journalFile, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+	if (data.empty()) {
+		return;
+	}
+
+	LOG(Info) << "Replaying spot data journal " << settings.journalFile;
+
+	std::vector<SpotData> spotDatas;
+	odb::session session;
+	odb::transaction t(db->begin());
+
+	size_t pos = 0;
+	const size_t headerSize = 2 * sizeof(uint32_t);
+	while (data.size() - pos >= headerSize + sizeof(uint32_t)) {
+		uint32_t magic;
+		uint32_t size;
+		memcpy(&magic, &data[pos], sizeof(magic));
+		memcpy(&size, &data[pos + sizeof(magic)], sizeof(size));
+		if (magic != RECORD_MAGIC || data.size() - pos - headerSize - sizeof(uint32_t) < size) {
+			break; //torn write at end of journal
+		}
+
+		const char* payload = &data[pos + headerSize];
+		uint32_t checksum;
+		memcpy(&checksum, payload + size, sizeof(checksum));
+		if (checksum != crc(payload, size)) {
+			break;
+		}
+		pos += headerSize + size + sizeof(uint32_t);
+
+		try {
+			Reader reader(payload, size);
+			while (!reader.atEnd()) {
+				SpotData sd;
+				int64_t inverterId = deserialize(reader, sd);
+				sd.inverter = db->find<Inverter>(inverterId);
+				if (sd.inverter == nullptr) {
+					LOG(Warning) << "Dropping journaled spot data of unknown inverter " << inverterId;
+					continue;
+				}
+				spotDatas.push_back(sd);
+			}
+		} catch (const PvlogException& ex) {
+			LOG(Error) << "Invalid journal record: " << ex.what();
+			break;
+		}
+	}
+	t.commit();
+
+	if (pos != data.size()) {
+		LOG(Warning) << "Ignoring " << data.size() - pos << " bytes of incomplete journal data";
+	}
+
+	persist(spotDatas, true);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	truncateJournal();
+	LOG(Info) << "Recovered " << spotDatas.size() << " spot data from journal";
+}
+
+std::vector<SpotData> SpotDataBuffer::pending(pt::ptime begin, pt::ptime end) const {
+	std::vector<SpotData> result;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const SpotData& sd : buffer) {
+		if (sd.time >= begin && sd.time < end) {
+			result.push_back(sd);
+		}
+	}
+
+	return result;
+}
+
+void SpotDataBuffer::persist(const std::vector<SpotData>& spotDatas, bool skipExisting) {
+	using Query = odb::query<SpotData>;
+
+	odb::transaction t(db->begin());
+	for (SpotData sd : spotDatas) {
+		if (skipExisting) {
+			//journal may contain data already committed before the crash
+			SpotDataKey* key;
+			odb::prepared_query<SpotData> query(model::cachedQuery<SpotData>("spot-data-buffer-exists", key,
+					[](SpotDataKey& k) {
+						return (Query::time == Query::_ref(k.time)) && (Query::inverter == Query::_ref(k.inverterId));
+					}));
+			key->time       = sd.time;
+			key->inverterId = sd.inverter->id;
+			if (!query.execute().empty()) {
+				continue;
+			}
+		}
+
+		LOG(Info) << "Persisting spot data: " << sd;
+		db->persist(sd);
+	}
+
+	Histogram::Timer timer(commitTimeHistogram("spotDataBuffer"));
+	t.commit();
+}
+
+void SpotDataBuffer::appendJournal(const std::vector<SpotData>& spotDatas) {
+	std::string payload;
+	for (const SpotData& sd : spotDatas) {
+		serialize(payload, sd);
+	}
+
+	std::string record;
+	record.reserve(payload.size() + 3 * sizeof(uint32_t));
+	put<uint32_t>(record, RECORD_MAGIC);
+	put<uint32_t>(record, payload.size());
+	record += payload;
+	put<uint32_t>(record, crc(payload.data(), payload.size()));
+
+	size_t written = 0;
+	while (written < record.size()) {
+		ssize_t ret = ::write(journalFd, record.data() + written, record.size() - written);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PVLOG_EXCEPT(std::string("Writing spot data journal failed: ") + strerror(errno));
+		}
+		written += ret;
+	}
+
+	pt::ptime now = pt::second_clock::universal_time();
+	if (now - lastSync >= settings.syncInterval) {
+		if (::fdatasync(journalFd) < 0) {
+			LOG(Error) << "Syncing spot data journal failed: " << strerror(errno);
+		}
+		lastSync = now;
+	}
+}
+
+void SpotDataBuffer::truncateJournal() {
+	if (journalFd < 0) {
+		return;
+	}
+
+	if (::ftruncate(journalFd, 0) < 0 || ::fdatasync(journalFd) < 0) {
+		LOG(Error) << "Truncating spot data journal failed: " << strerror(errno);
+	}
+}
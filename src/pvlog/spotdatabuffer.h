@@ -0,0 +1,109 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SPOTDATABUFFER_H_
+#define SRC_PVLOG_SPOTDATABUFFER_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/signals2.hpp>
+
+#include "utility.h"
+
+#include "models/spotdata.h"
+
+class ConfigReader;
+
+namespace odb {
+	class database;
+}
+
+/**
+ * Write buffer for spot data.
+ *
+ * Without journal file every sample is committed to the database immediately.
+ * With journal file samples are kept in memory and appended to the journal
+ * with a single write. They are committed to the database in one transaction
+ * every flushInterval or when flush is called. After a crash recover replays
+ * the journal, so at most syncInterval of data is lost.
+ */
+class SpotDataBuffer {
+	DISABLE_COPY(SpotDataBuffer)
+public:
+	struct Settings {
+		std::string journalFile; //empty disables buffering
+		boost::posix_time::time_duration flushInterval;
+		boost::posix_time::time_duration syncInterval; //0 syncs every write
+
+		Settings();
+
+		static Settings read(const ConfigReader& configReader);
+	};
+
+	//samples committed by flush, they are no longer returned by pending
+	boost::signals2::signal<void (const std::vector<model::SpotData>&)> flushSig;
+
+	SpotDataBuffer(odb::database* db, Settings settings);
+
+	~SpotDataBuffer();
+
+	/**
+	 * Add samples of one logging interval.
+	 */
+	void add(const std::vector<model::SpotData>& spotDatas);
+
+	/**
+	 * Commit all buffered samples to the database and truncate the journal.
+	 */
+	void flush();
+
+	/**
+	 * Replay journal left over by a crash.
+	 */
+	void recover();
+
+	/**
+	 * Buffered samples not yet committed with begin <= time < end.
+	 */
+	std::vector<model::SpotData> pending(boost::posix_time::ptime begin,
+	                                     boost::posix_time::ptime end) const;
+
+	bool isBuffered() const;
+
+private:
+	void persist(const std::vector<model::SpotData>& spotDatas, bool skipExisting);
+
+	void appendJournal(const std::vector<model::SpotData>& spotDatas);
+
+	void truncateJournal();
+
+	odb::database* db;
+	Settings settings;
+	int journalFd;
+
+	mutable std::mutex mutex;
+	std::vector<model::SpotData> buffer;
+	boost::posix_time::ptime lastFlush;
+	boost::posix_time::ptime lastSync;
+};
+
+#endif /* SRC_PVLOG_SPOTDATABUFFER_H_ */
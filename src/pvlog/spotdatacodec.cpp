@@ -0,0 +1,387 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spotdatacodec.h"
+
+#include <cstdint>
+#include <set>
+
+#include <boost/date_time/posix_time/conversion.hpp>
+
+#include "pvlogexception.h"
+
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+using model::SpotDataPower;
+using model::Phase;
+using model::DcInput;
+using model::InverterPtr;
+
+using Channel = std::vector<boost::optional<int32_t>>;
+
+namespace {
+
+const uint8_t FORMAT_VERSION = 1;
+
+enum Presence : uint8_t {
+	NONE_PRESENT = 0,
+	ALL_PRESENT,
+	BITMAP
+};
+
+uint64_t zigzag(int64_t value) {
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class Encoder {
+public:
+	void putByte(uint8_t byte) {
+		data.push_back(static_cast<char>(byte));
+	}
+
+	void putVarint(uint64_t value) {
+		while (value >= 0x80) {
+			putByte(static_cast<uint8_t>(value) | 0x80);
+			value >>= 7;
+		}
+		putByte(static_cast<uint8_t>(value));
+	}
+
+	void putSigned(int64_t value) {
+		putVarint(zigzag(value));
+	}
+
+	void putPresence(const std::vector<bool>& present) {
+		size_t count = 0;
+		for (bool p : present) {
+			count += p;
+		}
+
+		if (count == 0) {
+			putByte(NONE_PRESENT);
+		} else if (count == present.size()) {
+			putByte(ALL_PRESENT);
+		} else {
+			putByte(BITMAP);
+			for (size_t i = 0; i < present.size(); i += 8) {
+				uint8_t bits = 0;
+				for (size_t j = i; j < present.size() && j < i + 8; ++j) {
+					bits |= present[j] << (j - i);
+				}
+				putByte(bits);
+			}
+		}
+	}
+
+	void putChannel(const Channel& channel) {
+		std::vector<bool> present;
+		present.reserve(channel.size());
+		for (const auto& value : channel) {
+			present.push_back(static_cast<bool>(value));
+		}
+		putPresence(present);
+
+		int64_t prev = 0;
+		for (const auto& value : channel) {
+			if (value) {
+				putSigned(static_cast<int64_t>(value.get()) - prev);
+				prev = value.get();
+			}
+		}
+	}
+
+	std::vector<char> data;
+};
+
+class Decoder {
+public:
+	explicit Decoder(const std::vector<char>& data) : data(data), pos(0) {}
+
+	uint8_t getByte() {
+		if (pos >= data.size()) {
+			PVLOG_EXCEPT("Truncated spot data archive");
+		}
+		return static_cast<uint8_t>(data[pos++]);
+	}
+
+	uint64_t getVarint() {
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t byte = getByte();
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		PVLOG_EXCEPT("Invalid varint in spot data archive");
+	}
+
+	int64_t getSigned() {
+		return unzigzag(getVarint());
+	}
+
+	std::vector<bool> getPresence(size_t count) {
+		uint8_t presence = getByte();
+		if (presence == NONE_PRESENT || presence == ALL_PRESENT) {
+			return std::vector<bool>(count, presence == ALL_PRESENT);
+		} else if (presence != BITMAP) {
+			PVLOG_EXCEPT("Invalid presence in spot data archive");
+		}
+
+		std::vector<bool> present(count);
+		for (size_t i = 0; i < count; i += 8) {
+			uint8_t bits = getByte();
+			for (size_t j = i; j < count && j < i + 8; ++j) {
+				present[j] = (bits >> (j - i)) & 1;
+			}
+		}
+		return present;
+	}
+
+	Channel getChannel(size_t count) {
+		std::vector<bool> present = getPresence(count);
+
+		Channel channel(count);
+		int64_t prev = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (present[i]) {
+				prev += getSigned();
+				channel[i] = static_cast<int32_t>(prev);
+			}
+		}
+		return channel;
+	}
+
+	bool atEnd() const {
+		return pos == data.size();
+	}
+
+private:
+	const std::vector<char>& data;
+	size_t pos;
+};
+
+template<typename Map>
+std::set<int> keys(const std::vector<SpotData>& spotDatas, Map SpotData::* member) {
+	std::set<int> result;
+	for (const SpotData& sd : spotDatas) {
+		for (const auto& entry : sd.*member) {
+			result.insert(entry.first);
+		}
+	}
+	return result;
+}
+
+template<typename Map, typename F>
+Channel channel(const std::vector<SpotData>& spotDatas, Map SpotData::* member, int key, F value) {
+	Channel result;
+	result.reserve(spotDatas.size());
+	for (const SpotData& sd : spotDatas) {
+		auto it = (sd.*member).find(key);
+		result.push_back(it != (sd.*member).end() ? value(it->second) : boost::none);
+	}
+	return result;
+}
+
+//Version, sample count and timestamps, the start of every encoding
+std::vector<int64_t> decodeTimes(Decoder& decoder, size_t dataSize) {
+	if (decoder.getByte() != FORMAT_VERSION) {
+		PVLOG_EXCEPT("Unsupported spot data archive version");
+	}
+
+	size_t count = decoder.getVarint();
+	if (count > dataSize * 8) {
+		PVLOG_EXCEPT("Invalid sample count in spot data archive");
+	}
+
+	std::vector<int64_t> times(count);
+	int64_t time  = 0;
+	int64_t delta = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (i == 0) {
+			time = decoder.getSigned();
+		} else {
+			delta += decoder.getSigned();
+			time  += delta;
+		}
+		times[i] = time;
+	}
+	return times;
+}
+
+} //namespace {
+
+std::vector<char> encodeSpotData(const std::vector<SpotData>& spotDatas) {
+	Encoder encoder;
+	encoder.putByte(FORMAT_VERSION);
+	encoder.putVarint(spotDatas.size());
+
+	//timestamps: first value, first delta, then delta of delta
+	int64_t prevTime  = 0;
+	int64_t prevDelta = 0;
+	for (size_t i = 0; i < spotDatas.size(); ++i) {
+		int64_t time = pt::to_time_t(spotDatas[i].time);
+		int64_t delta = time - prevTime;
+		encoder.putSigned(i == 0 ? time : delta - prevDelta);
+		prevDelta = (i == 0) ? 0 : delta;
+		prevTime  = time;
+	}
+
+	Channel power, dayYield, frequency;
+	for (const SpotData& sd : spotDatas) {
+		power.push_back(sd.power);
+		dayYield.push_back(sd.dayYield);
+		frequency.push_back(sd.frequency);
+	}
+	encoder.putChannel(power);
+	encoder.putChannel(dayYield);
+	encoder.putChannel(frequency);
+
+	//phase power is not optional, its presence marks the phase as present
+	std::set<int> phases = keys(spotDatas, &SpotData::phases);
+	encoder.putVarint(phases.size());
+	for (int phase : phases) {
+		encoder.putVarint(phase);
+		encoder.putChannel(channel(spotDatas, &SpotData::phases, phase,
+				[](const Phase& p) { return boost::optional<int32_t>(p.power); }));
+		encoder.putChannel(channel(spotDatas, &SpotData::phases, phase,
+				[](const Phase& p) { return p.voltage; }));
+		encoder.putChannel(channel(spotDatas, &SpotData::phases, phase,
+				[](const Phase& p) { return p.current; }));
+	}
+
+	std::set<int> dcInputs = keys(spotDatas, &SpotData::dcInputs);
+	encoder.putVarint(dcInputs.size());
+	for (int input : dcInputs) {
+		encoder.putVarint(input);
+
+		std::vector<bool> present;
+		for (const SpotData& sd : spotDatas) {
+			present.push_back(sd.dcInputs.count(input) != 0);
+		}
+		encoder.putPresence(present);
+		encoder.putChannel(channel(spotDatas, &SpotData::dcInputs, input,
+				[](const DcInput& d) { return d.power; }));
+		encoder.putChannel(channel(spotDatas, &SpotData::dcInputs, input,
+				[](const DcInput& d) { return d.voltage; }));
+		encoder.putChannel(channel(spotDatas, &SpotData::dcInputs, input,
+				[](const DcInput& d) { return d.current; }));
+	}
+
+	return std::move(encoder.data);
+}
+
+std::vector<SpotData> decodeSpotData(const std::vector<char>& data, InverterPtr inverter) {
+	Decoder decoder(data);
+	std::vector<int64_t> times = decodeTimes(decoder, data.size());
+	size_t count = times.size();
+
+	std::vector<SpotData> spotDatas(count);
+	for (size_t i = 0; i < count; ++i) {
+		spotDatas[i].id       = 0;
+		spotDatas[i].inverter = inverter;
+		spotDatas[i].time     = pt::from_time_t(times[i]);
+	}
+
+	Channel power = decoder.getChannel(count);
+	Channel dayYield = decoder.getChannel(count);
+	Channel frequency = decoder.getChannel(count);
+	for (size_t i = 0; i < count; ++i) {
+		spotDatas[i].power     = power[i].get_value_or(0);
+		spotDatas[i].dayYield  = dayYield[i];
+		spotDatas[i].frequency = frequency[i];
+	}
+
+	size_t phaseNum = decoder.getVarint();
+	for (size_t p = 0; p < phaseNum; ++p) {
+		int num = decoder.getVarint();
+		Channel phasePower   = decoder.getChannel(count);
+		Channel phaseVoltage = decoder.getChannel(count);
+		Channel phaseCurrent = decoder.getChannel(count);
+		for (size_t i = 0; i < count; ++i) {
+			if (phasePower[i]) {
+				Phase phase;
+				phase.power   = phasePower[i].get();
+				phase.voltage = phaseVoltage[i];
+				phase.current = phaseCurrent[i];
+				spotDatas[i].phases.emplace(num, phase);
+			}
+		}
+	}
+
+	size_t dcInputNum = decoder.getVarint();
+	for (size_t d = 0; d < dcInputNum; ++d) {
+		int num = decoder.getVarint();
+		std::vector<bool> present = decoder.getPresence(count);
+		Channel dcPower   = decoder.getChannel(count);
+		Channel dcVoltage = decoder.getChannel(count);
+		Channel dcCurrent = decoder.getChannel(count);
+		for (size_t i = 0; i < count; ++i) {
+			if (present[i]) {
+				DcInput dcInput;
+				dcInput.power   = dcPower[i];
+				dcInput.voltage = dcVoltage[i];
+				dcInput.current = dcCurrent[i];
+				spotDatas[i].dcInputs.emplace(num, dcInput);
+			}
+		}
+	}
+
+	if (!decoder.atEnd()) {
+		PVLOG_EXCEPT("Trailing data in spot data archive");
+	}
+
+	return spotDatas;
+}
+
+std::vector<SpotDataPower> decodeSpotDataPower(const std::vector<char>& data, int64_t inverterId) {
+	Decoder decoder(data);
+	std::vector<int64_t> times = decodeTimes(decoder, data.size());
+	size_t count = times.size();
+
+	//power is the first channel, the channels after it are not read
+	Channel power = decoder.getChannel(count);
+
+	std::vector<SpotDataPower> spotDatas(count);
+	for (size_t i = 0; i < count; ++i) {
+		spotDatas[i].inverterId = inverterId;
+		spotDatas[i].time       = pt::from_time_t(times[i]);
+		spotDatas[i].power      = power[i].get_value_or(0);
+	}
+
+	return spotDatas;
+}
+
+size_t rowSize(const std::vector<SpotData>& spotDatas) {
+	//id, inverter, time, power, day_yield, frequency
+	const size_t spotDataRow = 4 * 5 + 8;
+	//id, phase/input, power, voltage, current
+	const size_t containerRow = 4 * 5;
+
+	size_t size = 0;
+	for (const SpotData& sd : spotDatas) {
+		size += spotDataRow + (sd.phases.size() + sd.dcInputs.size()) * containerRow;
+	}
+	return size;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SPOTDATACODEC_H_
+#define SRC_PVLOG_SPOTDATACODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "models/inverter.h"
+#include "models/spotdata.h"
+
+/**
+ * Compressed encoding of the spot data of one inverter.
+ *
+ * Timestamps are stored as delta of delta, every channel (power, day yield,
+ * frequency and power, voltage, current of every phase and dc input) as
+ * presence bitmap followed by zigzag varint deltas of the present values.
+ * Regular series with a fixed logging interval need about one byte per value.
+ *
+ * spotDatas have to be sorted by time.
+ */
+std::vector<char> encodeSpotData(const std::vector<model::SpotData>& spotDatas);
+
+/**
+ * Decode data encoded by encodeSpotData. The inverter is assigned to all decoded
+ * spot data. Throws PvlogException on corrupt data.
+ */
+std::vector<model::SpotData> decodeSpotData(const std::vector<char>& data, model::InverterPtr inverter);
+
+/**
+ * Decode only time and power of data encoded by encodeSpotData, the other
+ * channels are neither decoded nor checked.
+ */
+std::vector<model::SpotDataPower> decodeSpotDataPower(const std::vector<char>& data, int64_t inverterId);
+
+/**
+ * Size of spotDatas stored as rows of the spot_data, phase and dc_input tables,
+ * not counting sqlite record and index overhead.
+ */
+size_t rowSize(const std::vector<model::SpotData>& spotDatas);
+
+#endif /* SRC_PVLOG_SPOTDATACODEC_H_ */
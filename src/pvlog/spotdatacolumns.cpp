@@ -0,0 +1,83 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spotdatacolumns.h"
+
+#include <boost/date_time/posix_time/conversion.hpp>
+
+namespace pt = boost::posix_time;
+
+using model::SpotData;
+
+SpotDataColumns::Columns& SpotDataColumns::columns(std::map<int, Columns>& map, int num, std::size_t size) {
+	auto it = map.find(num);
+	if (it == map.end()) {
+		//channel appears the first time, earlier samples have no value
+		Columns c;
+		c.power.resize(size);
+		c.voltage.resize(size);
+		c.current.resize(size);
+		it = map.emplace(num, std::move(c)).first;
+	}
+	return it->second;
+}
+
+void SpotDataColumns::fill(std::map<int, Columns>& map, std::size_t size) {
+	for (auto& entry : map) {
+		entry.second.power.resize(size);
+		entry.second.voltage.resize(size);
+		entry.second.current.resize(size);
+	}
+}
+
+void SpotDataColumns::add(const SpotData& spotData) {
+	std::size_t index = times.size();
+
+	times.push_back(pt::to_time_t(spotData.time));
+	power.push_back(spotData.power);
+	frequency.push_back(spotData.frequency);
+	dayYield.push_back(spotData.dayYield);
+
+	for (const auto& entry : spotData.phases) {
+		Columns& c = columns(phases, entry.first, index);
+		c.power.push_back(entry.second.power);
+		c.voltage.push_back(entry.second.voltage);
+		c.current.push_back(entry.second.current);
+	}
+
+	for (const auto& entry : spotData.dcInputs) {
+		Columns& c = columns(dcInputs, entry.first, index);
+		c.power.push_back(entry.second.power);
+		c.voltage.push_back(entry.second.voltage);
+		c.current.push_back(entry.second.current);
+	}
+
+	//channels missing in this sample
+	fill(phases, index + 1);
+	fill(dcInputs, index + 1);
+}
+
+void SpotDataColumns::clear() {
+	times.clear();
+	power.clear();
+	frequency.clear();
+	dayYield.clear();
+	phases.clear();
+	dcInputs.clear();
+}
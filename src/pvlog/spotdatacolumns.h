@@ -0,0 +1,136 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SPOTDATACOLUMNS_H_
+#define SRC_PVLOG_SPOTDATACOLUMNS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "models/spotdata.h"
+
+/**
+ * Spot data of one inverter in columnar layout: one timestamp array and one
+ * value array per channel, all of the same length. Values a sample does not
+ * have (like a phase that is missing in some samples) are null.
+ *
+ * Written as
+ * {"time":[...],"power":[...],"frequency":[...],"dayYield":[...],
+ *  "phases":{"1":{"power":[...],"voltage":[...],"current":[...]}},
+ *  "dc_inputs":{"1":{"power":[...],"voltage":[...],"current":[...]}}}
+ * phases and dc_inputs are null if no sample has one.
+ */
+class SpotDataColumns {
+public:
+	/**
+	 * Append sample, samples have to be added in time order.
+	 */
+	void add(const model::SpotData& spotData);
+
+	void clear();
+
+	std::size_t size() const {
+		return times.size();
+	}
+
+	/**
+	 * Write columns with util::JsonWriter or util::MsgPackWriter.
+	 */
+	template<typename Writer>
+	void write(Writer& writer) const;
+
+private:
+	using Channel = std::vector<boost::optional<int32_t>>;
+
+	struct Columns {
+		Channel power;
+		Channel voltage;
+		Channel current;
+	};
+
+	static Columns& columns(std::map<int, Columns>& map, int num, std::size_t size);
+
+	static void fill(std::map<int, Columns>& map, std::size_t size);
+
+	template<typename Writer>
+	static void writeChannel(Writer& writer, const std::string& name, const Channel& channel);
+
+	template<typename Writer>
+	static void writeColumns(Writer& writer, const std::string& name, const std::map<int, Columns>& map);
+
+	std::vector<int64_t> times;
+	Channel power;
+	Channel frequency;
+	Channel dayYield;
+	std::map<int, Columns> phases;
+	std::map<int, Columns> dcInputs;
+};
+
+template<typename Writer>
+void SpotDataColumns::writeChannel(Writer& writer, const std::string& name, const Channel& channel) {
+	writer.key(name).beginArray(channel.size());
+	for (const auto& value : channel) {
+		writer.value(value);
+	}
+	writer.endArray();
+}
+
+template<typename Writer>
+void SpotDataColumns::writeColumns(Writer& writer, const std::string& name, const std::map<int, Columns>& map) {
+	writer.key(name);
+	if (map.empty()) {
+		writer.null();
+		return;
+	}
+
+	writer.beginObject(map.size());
+	for (const auto& entry : map) {
+		writer.key(std::to_string(entry.first)).beginObject(3);
+		writeChannel(writer, "power", entry.second.power);
+		writeChannel(writer, "voltage", entry.second.voltage);
+		writeChannel(writer, "current", entry.second.current);
+		writer.endObject();
+	}
+	writer.endObject();
+}
+
+template<typename Writer>
+void SpotDataColumns::write(Writer& writer) const {
+	writer.beginObject(6);
+
+	writer.key("time").beginArray(times.size());
+	for (int64_t time : times) {
+		writer.value(time);
+	}
+	writer.endArray();
+
+	writeChannel(writer, "power", power);
+	writeChannel(writer, "frequency", frequency);
+	writeChannel(writer, "dayYield", dayYield);
+	writeColumns(writer, "phases", phases);
+	writeColumns(writer, "dc_inputs", dcInputs);
+
+	writer.endObject();
+}
+
+#endif /* SRC_PVLOG_SPOTDATACOLUMNS_H_ */
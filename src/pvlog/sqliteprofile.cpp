@@ -0,0 +1,152 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqliteprofile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+
+#include <sqlite3.h>
+#include <odb/sqlite/database.hxx>
+#include <odb/sqlite/connection.hxx>
+
+#include "configreader.h"
+#include "log.h"
+#include "pvlogexception.h"
+
+static std::string toUpper(std::string str) {
+	std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::toupper(c); });
+	return str;
+}
+
+static std::string readOption(const ConfigReader& configReader, const std::string& key,
+		const std::string& defaultValue, const std::set<std::string>& allowed) {
+	std::string value = toUpper(configReader.getValue(key, defaultValue));
+	if (allowed.count(value) == 0) {
+		PVLOG_EXCEPT("Invalid value for " + key + ": " + value);
+	}
+
+	return value;
+}
+
+static void execPragma(sqlite3* handle, const std::string& pragma) {
+	char* errorMsg = nullptr;
+	if (sqlite3_exec(handle, pragma.c_str(), nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+		std::string error = errorMsg != nullptr ? errorMsg : "unknown error";
+		sqlite3_free(errorMsg);
+		PVLOG_EXCEPT("Executing " + pragma + " failed: " + error);
+	}
+}
+
+SqliteProfile::SqliteProfile() :
+		journalMode("WAL"),
+		synchronous("NORMAL"),
+		tempStore("MEMORY"),
+		mmapSize(0),
+		cacheSize(-2000),
+		readConnections(2) {
+	//nothing to do
+}
+
+SqliteProfile SqliteProfile::read(const ConfigReader& configReader) {
+	SqliteProfile profile;
+
+	std::string databaseType = configReader.getValue("database_type", "sqlite");
+	if (databaseType != "sqlite") {
+		PVLOG_EXCEPT("Unsupported database type: " + databaseType);
+	}
+
+	//sqlite is file based so the server settings are meaningless
+	for (const char* key : { "hostname", "port", "username", "password" }) {
+		if (!configReader.getValue(key, "").empty()) {
+			LOG(Warning) << "Ignoring " << key << " setting, not used by sqlite database.";
+		}
+	}
+
+	profile.databaseName = configReader.getValue("database_name");
+	profile.journalMode  = readOption(configReader, "journal_mode", profile.journalMode,
+			{ "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF" });
+	profile.synchronous  = readOption(configReader, "synchronous", profile.synchronous,
+			{ "OFF", "NORMAL", "FULL", "EXTRA" });
+	profile.tempStore    = readOption(configReader, "temp_store", profile.tempStore,
+			{ "DEFAULT", "FILE", "MEMORY" });
+
+	try {
+		profile.mmapSize  = std::stoll(configReader.getValue("mmap_size", std::to_string(profile.mmapSize)));
+		profile.cacheSize = std::stoll(configReader.getValue("cache_size", std::to_string(profile.cacheSize)));
+	} catch (const std::logic_error& ex) {
+		PVLOG_EXCEPT(std::string("Invalid mmap_size or cache_size: ") + ex.what());
+	}
+
+	if (profile.mmapSize < 0) {
+		PVLOG_EXCEPT("mmap_size must not be negative");
+	}
+
+	try {
+		int readConnections = std::stoi(configReader.getValue("read_connections",
+				std::to_string(profile.readConnections)));
+		if (readConnections < 1) {
+			PVLOG_EXCEPT("read_connections must be at least 1");
+		}
+		profile.readConnections = readConnections;
+	} catch (const std::logic_error& ex) {
+		PVLOG_EXCEPT(std::string("Invalid read_connections: ") + ex.what());
+	}
+
+	return profile;
+}
+
+void SqliteProfile::apply(sqlite3* handle, bool readOnly) const {
+	//journal_mode is persistent and set by the writer, a read only connection
+	//cannot change it, e.g. switching to or from WAL needs write access
+	if (!readOnly) {
+		execPragma(handle, "PRAGMA journal_mode=" + journalMode);
+	}
+	execPragma(handle, "PRAGMA synchronous=" + synchronous);
+	execPragma(handle, "PRAGMA temp_store=" + tempStore);
+	execPragma(handle, "PRAGMA mmap_size=" + std::to_string(mmapSize));
+	execPragma(handle, "PRAGMA cache_size=" + std::to_string(cacheSize));
+}
+
+ProfiledConnectionFactory::ProfiledConnectionFactory(SqliteProfile profile, bool readOnly,
+		std::size_t maxConnections, std::size_t minConnections) :
+		connection_pool_factory(maxConnections, minConnections),
+		profile(std::move(profile)),
+		readOnly(readOnly) {
+	//nothing to do
+}
+
+ProfiledConnectionFactory::pooled_connection_ptr ProfiledConnectionFactory::create() {
+	pooled_connection_ptr connection(connection_pool_factory::create());
+	profile.apply(connection->handle(), readOnly);
+
+	return connection;
+}
+
+void optimizeDatabase(odb::database* db) {
+	try {
+		odb::sqlite::database* sqliteDb = static_cast<odb::sqlite::database*>(db);
+		odb::sqlite::connection_ptr connection(sqliteDb->connection());
+		execPragma(connection->handle(), "PRAGMA optimize");
+		LOG(Debug) << "Optimized database";
+	} catch (const std::exception& ex) {
+		LOG(Error) << "Optimizing database failed: " << ex.what();
+	}
+}
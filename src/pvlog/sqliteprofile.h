@@ -0,0 +1,87 @@
+/*
+ * This file is part of Pvlog.
+ *
+ * Copyright (C) 2017 pvlogdev@gmail.com
+ *
+ * Pvlog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pvlog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PVLOG_SQLITEPROFILE_H_
+#define SRC_PVLOG_SQLITEPROFILE_H_
+
+#include <cstdint>
+#include <string>
+
+#include <odb/sqlite/connection-factory.hxx>
+
+class ConfigReader;
+
+struct sqlite3;
+
+namespace odb {
+	class database;
+}
+
+/**
+ * Storage tuning parameters read from the database configuration file.
+ *
+ * The pragmas are applied to every connection opened by the
+ * database, so pooled connections behave the same.
+ */
+struct SqliteProfile {
+	std::string databaseName;
+	std::string journalMode; //DELETE, TRUNCATE, PERSIST, MEMORY, WAL, OFF
+	std::string synchronous; //OFF, NORMAL, FULL, EXTRA
+	std::string tempStore;   //DEFAULT, FILE, MEMORY
+	int64_t mmapSize;        //bytes, 0 disables memory mapped io
+	int64_t cacheSize;       //pages if positive, KiB if negative
+	std::size_t readConnections; //number of read only connections
+
+	SqliteProfile();
+
+	/**
+	 * Read profile from database configuration file.
+	 * Throws PvlogException on invalid or unsupported values.
+	 */
+	static SqliteProfile read(const ConfigReader& configReader);
+
+	/**
+	 * Apply connection pragmas to handle.
+	 * The journal mode can only be changed by read write connections.
+	 */
+	void apply(sqlite3* handle, bool readOnly) const;
+};
+
+/**
+ * Connection pool factory applying a SqliteProfile to each new connection.
+ */
+class ProfiledConnectionFactory : public odb::sqlite::connection_pool_factory {
+public:
+	ProfiledConnectionFactory(SqliteProfile profile, bool readOnly,
+	                          std::size_t maxConnections = 0, std::size_t minConnections = 1);
+
+protected:
+	virtual pooled_connection_ptr create() override;
+
+private:
+	SqliteProfile profile;
+	bool readOnly;
+};
+
+/**
+ * Run "PRAGMA optimize", should be called periodically on long living connections.
+ */
+void optimizeDatabase(odb::database* db);
+
+#endif /* SRC_PVLOG_SQLITEPROFILE_H_ */
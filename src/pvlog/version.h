@@ -20,6 +20,6 @@
 #ifndef SRC_PVLOG_VERSION_H_
 #define SRC_PVLOG_VERSION_H_
 
-#pragma db model version(1, 3, closed)
+#pragma db model version(1, 6, closed)
 
 #endif /* #ifndef SRC_PVLOG_VERSION_H_ */
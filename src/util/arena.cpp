@@ -0,0 +1,83 @@
+#include <arena.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace util {
+
+const std::size_t Arena::MIN_CHUNK_SIZE;
+const std::size_t Arena::MAX_RETAINED_SIZE;
+
+Arena::Arena() :
+		chunks(nullptr),
+		pos(nullptr),
+		end(nullptr),
+		depth(0) {
+	//nothing to do
+}
+
+Arena::~Arena() {
+	while (chunks != nullptr) {
+		Chunk* next = chunks->next;
+		::operator delete(chunks);
+		chunks = next;
+	}
+}
+
+char* Arena::chunkBegin(Chunk* chunk) const {
+	return reinterpret_cast<char*>(chunk) + sizeof(Chunk);
+}
+
+void Arena::addChunk(std::size_t minSize) {
+	//chunks grow geometrically, a retained chunk fits the largest request seen
+	std::size_t size = std::max(minSize + sizeof(Chunk), MIN_CHUNK_SIZE);
+	if (chunks != nullptr) {
+		size = std::max(size, 2 * chunks->size);
+	}
+
+	Chunk* chunk = static_cast<Chunk*>(::operator new(size));
+	chunk->next = chunks;
+	chunk->size = size;
+	chunks = chunk;
+
+	pos = chunkBegin(chunk);
+	end = reinterpret_cast<char*>(chunk) + size;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+	std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(pos) + alignment - 1) & ~(alignment - 1);
+	if (pos == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(end)) {
+		addChunk(size + alignment);
+		aligned = (reinterpret_cast<std::uintptr_t>(pos) + alignment - 1) & ~(alignment - 1);
+	}
+
+	pos = reinterpret_cast<char*>(aligned + size);
+	return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::release() {
+	if (chunks == nullptr) {
+		return;
+	}
+
+	Chunk* retained = (chunks->size <= MAX_RETAINED_SIZE) ? chunks : nullptr;
+	Chunk* chunk = (retained != nullptr) ? chunks->next : chunks;
+	while (chunk != nullptr) {
+		Chunk* next = chunk->next;
+		::operator delete(chunk);
+		chunk = next;
+	}
+
+	chunks = retained;
+	if (retained != nullptr) {
+		retained->next = nullptr;
+		pos = chunkBegin(retained);
+		end = reinterpret_cast<char*>(retained) + retained->size;
+	} else {
+		pos = nullptr;
+		end = nullptr;
+	}
+}
+
+} //namespace util {
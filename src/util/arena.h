@@ -0,0 +1,118 @@
+#ifndef SRC_UTIL_ARENA_H_
+#define SRC_UTIL_ARENA_H_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <utility.h>
+
+namespace util {
+
+/**
+ * Monotonic allocator for memory with the lifetime of one request.
+ *
+ * Allocations bump a pointer in the current chunk, nothing is freed before
+ * release. Release keeps the last and largest chunk, so a thread serving
+ * similar requests stops allocating from the heap after the first one.
+ */
+class Arena {
+	DISABLE_COPY(Arena)
+public:
+	static const std::size_t MIN_CHUNK_SIZE    = 4096;
+	static const std::size_t MAX_RETAINED_SIZE = 1024 * 1024; //larger chunks are freed on release
+
+	/**
+	 * Releases the arena when the outermost scope ends,
+	 * nested scopes of the same request share its allocations.
+	 */
+	class Scope {
+		DISABLE_COPY(Scope)
+	public:
+		explicit Scope(Arena& arena) : arena(arena) {
+			++arena.depth;
+		}
+
+		~Scope() {
+			if (--arena.depth == 0) {
+				arena.release();
+			}
+		}
+
+	private:
+		Arena& arena;
+	};
+
+	Arena();
+	~Arena();
+
+	void* allocate(std::size_t size, std::size_t alignment);
+
+	/**
+	 * Free all allocations at once.
+	 */
+	void release();
+
+private:
+	struct Chunk {
+		Chunk* next;
+		std::size_t size; //including this header
+	};
+
+	void addChunk(std::size_t minSize);
+	char* chunkBegin(Chunk* chunk) const;
+
+	Chunk* chunks; //newest first
+	char* pos;
+	char* end;
+	int depth;
+};
+
+/**
+ * Standard allocator handing out memory of an arena, deallocate does nothing.
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, std::size_t) {
+		//nothing to do
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return arena == other.arena;
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return arena != other.arena;
+	}
+
+private:
+	template<typename> friend class ArenaAllocator;
+
+	Arena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<typename Key, typename T>
+using ArenaMap = std::map<Key, T, std::less<Key>, ArenaAllocator<std::pair<const Key, T>>>;
+
+} //namespace util {
+
+#endif /* SRC_UTIL_ARENA_H_ */
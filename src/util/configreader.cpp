@@ -3,6 +3,7 @@
 #include <pvlogexception.h>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 
 static void trim(std::string& source, const char * delims = "\t\n\r\0x20")
@@ -77,3 +78,39 @@ const std::string & ConfigReader::getValue(const std::string& name) const
 
 	return it->second;
 }
+
+std::string ConfigReader::getValue(const std::string& name, const std::string& defaultValue) const
+{
+	std::map<std::string, std::string>::const_iterator it = values.find(name);
+
+	if (it == values.end() || it->second.empty()) return defaultValue;
+
+	return it->second;
+}
+
+std::size_t ConfigReader::getSizeValue(const std::string& name, const std::string& defaultValue,
+		std::size_t min, std::size_t max) const
+{
+	std::string value = getValue(name, defaultValue);
+
+	unsigned long long result = 0;
+	std::size_t parsed = 0;
+	try {
+		//stoull accepts a sign and wraps negative numbers
+		if (value.find('-') == std::string::npos) {
+			result = std::stoull(value, &parsed);
+		}
+	} catch (const std::logic_error&) {
+		parsed = 0;
+	}
+
+	if (parsed == 0 || parsed != value.size()) {
+		PVLOG_EXCEPT("Invalid setting " + name + ": \"" + value + "\" is not a non negative integer");
+	}
+	if (result < min || result > max) {
+		PVLOG_EXCEPT("Invalid setting " + name + ": must be between " + std::to_string(min) +
+				" and " + std::to_string(max));
+	}
+
+	return static_cast<std::size_t>(result);
+}
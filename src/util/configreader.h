@@ -2,6 +2,7 @@
 #define CONFIG_READER_H
 
 #include <utility.h>
+#include <cstddef>
 #include <string>
 #include <map>
 #include <fstream>
@@ -24,6 +25,18 @@ public:
 	void parse();
 
 	const std::string& getValue(const std::string & name) const;
+
+	/**
+	 * Return value of name or defaultValue if name is not present.
+	 */
+	std::string getValue(const std::string & name, const std::string & defaultValue) const;
+
+	/**
+	 * Return the non negative integer value of name or defaultValue if name is not present.
+	 * Throws PvlogException naming the key if the value is not a number or out of [min, max].
+	 */
+	std::size_t getSizeValue(const std::string & name, const std::string & defaultValue,
+			std::size_t min, std::size_t max) const;
 };
 
 #endif // #ifndef CONFIG_READER_H
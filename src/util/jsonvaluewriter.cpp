@@ -0,0 +1,74 @@
+#include <jsonvaluewriter.h>
+
+#include <cmath>
+
+namespace util {
+
+JsonValueWriter::JsonValueWriter(Json::Value& out) :
+		out(out) {
+	//nothing to do
+}
+
+Json::Value& JsonValueWriter::next() {
+	if (open.empty()) {
+		return out;
+	}
+
+	Json::Value& parent = *open.back();
+	if (parent.isArray()) {
+		return parent.append(Json::Value());
+	}
+	return parent[pendingKey];
+}
+
+JsonValueWriter& JsonValueWriter::beginObject() {
+	Json::Value& object = next();
+	object = Json::Value(Json::objectValue);
+	open.push_back(&object);
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::endObject() {
+	open.pop_back();
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::beginArray() {
+	Json::Value& array = next();
+	array = Json::Value(Json::arrayValue);
+	open.push_back(&array);
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::endArray() {
+	open.pop_back();
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::key(const std::string& name) {
+	pendingKey = name;
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::value(int64_t value) {
+	next() = static_cast<Json::Int64>(value);
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::value(double value) {
+	//same as JsonWriter, json has no representation of nan and infinity
+	next() = std::isfinite(value) ? Json::Value(value) : Json::Value();
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::value(const std::string& value) {
+	next() = value;
+	return *this;
+}
+
+JsonValueWriter& JsonValueWriter::null() {
+	next() = Json::Value();
+	return *this;
+}
+
+} //namespace util {
@@ -0,0 +1,55 @@
+#ifndef SRC_UTIL_JSONVALUEWRITER_H_
+#define SRC_UTIL_JSONVALUEWRITER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <jsoncpp/json/value.h>
+
+namespace util {
+
+/**
+ * Builds a Json::Value tree with the same interface as JsonWriter, for
+ * json-rpc-cpp handlers that need a tree instead of serialized json.
+ */
+class JsonValueWriter {
+public:
+	explicit JsonValueWriter(Json::Value& out);
+
+	JsonValueWriter& beginObject();
+	JsonValueWriter& endObject();
+
+	JsonValueWriter& beginArray();
+	JsonValueWriter& endArray();
+
+	//sizes are ignored, they allow using the same code for MsgPackWriter
+	JsonValueWriter& beginObject(std::size_t) { return beginObject(); }
+	JsonValueWriter& beginArray(std::size_t) { return beginArray(); }
+
+	JsonValueWriter& key(const std::string& name);
+
+	JsonValueWriter& value(int64_t value);
+	JsonValueWriter& value(int32_t value) { return this->value(static_cast<int64_t>(value)); }
+	JsonValueWriter& value(double value);
+	JsonValueWriter& value(const std::string& value);
+	JsonValueWriter& null();
+
+	template<typename T>
+	JsonValueWriter& value(const boost::optional<T>& value) {
+		return value ? this->value(value.get()) : null();
+	}
+
+private:
+	//value to write next, a new member or element of the innermost open object or array
+	Json::Value& next();
+
+	Json::Value& out;
+	std::vector<Json::Value*> open;
+	std::string pendingKey;
+};
+
+} //namespace util {
+
+#endif /* SRC_UTIL_JSONVALUEWRITER_H_ */
@@ -0,0 +1,120 @@
+#include <jsonwriter.h>
+
+#include <cmath>
+#include <cstdio>
+
+namespace util {
+
+JsonWriter::JsonWriter(std::string& out) :
+		out(out),
+		afterKey(false) {
+	//nothing to do
+}
+
+void JsonWriter::separator() {
+	if (afterKey) {
+		afterKey = false;
+		return;
+	}
+
+	if (!first.empty()) {
+		if (!first.back()) {
+			out += ',';
+		}
+		first.back() = false;
+	}
+}
+
+JsonWriter& JsonWriter::beginObject() {
+	separator();
+	out += '{';
+	first.push_back(true);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+	out += '}';
+	first.pop_back();
+	return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+	separator();
+	out += '[';
+	first.push_back(true);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+	out += ']';
+	first.pop_back();
+	return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name) {
+	value(name);
+	out += ':';
+	afterKey = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t value) {
+	separator();
+	out += std::to_string(value);
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(double value) {
+	separator();
+	if (!std::isfinite(value)) {
+		out += "null";
+		return *this;
+	}
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.17g", value);
+	out += buf;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& value) {
+	static const char HEX[] = "0123456789abcdef";
+
+	separator();
+	out += '"';
+	for (char c : value) {
+		switch (c) {
+		case '"':  out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\b': out += "\\b";  break;
+		case '\f': out += "\\f";  break;
+		case '\n': out += "\\n";  break;
+		case '\r': out += "\\r";  break;
+		case '\t': out += "\\t";  break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				out += "\\u00";
+				out += HEX[(c >> 4) & 0xf];
+				out += HEX[c & 0xf];
+			} else {
+				out += c;
+			}
+		}
+	}
+	out += '"';
+	return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+	separator();
+	out += "null";
+	return *this;
+}
+
+JsonWriter& JsonWriter::raw(const std::string& json) {
+	separator();
+	out += json;
+	return *this;
+}
+
+} //namespace util {
@@ -0,0 +1,60 @@
+#ifndef SRC_UTIL_JSONWRITER_H_
+#define SRC_UTIL_JSONWRITER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace util {
+
+/**
+ * Writes compact json directly into a string without building a Json::Value tree.
+ *
+ * Commas are inserted automatically, the caller is responsible for
+ * balancing begin and end calls and for writing keys inside objects only.
+ */
+class JsonWriter {
+public:
+	explicit JsonWriter(std::string& out);
+
+	JsonWriter& beginObject();
+	JsonWriter& endObject();
+
+	JsonWriter& beginArray();
+	JsonWriter& endArray();
+
+	//sizes are ignored, they allow using the same code for MsgPackWriter
+	JsonWriter& beginObject(std::size_t) { return beginObject(); }
+	JsonWriter& beginArray(std::size_t) { return beginArray(); }
+
+	JsonWriter& key(const std::string& name);
+
+	JsonWriter& value(int64_t value);
+	JsonWriter& value(int32_t value) { return this->value(static_cast<int64_t>(value)); }
+	JsonWriter& value(double value);
+	JsonWriter& value(const std::string& value);
+	JsonWriter& null();
+
+	template<typename T>
+	JsonWriter& value(const boost::optional<T>& value) {
+		return value ? this->value(value.get()) : null();
+	}
+
+	/**
+	 * Write already serialized json as value.
+	 */
+	JsonWriter& raw(const std::string& json);
+
+private:
+	void separator();
+
+	std::string& out;
+	std::vector<bool> first; //one entry per open object or array
+	bool afterKey;
+};
+
+} //namespace util {
+
+#endif /* SRC_UTIL_JSONWRITER_H_ */
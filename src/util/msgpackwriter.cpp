@@ -0,0 +1,157 @@
+#include <msgpackwriter.h>
+
+#include <cstring>
+
+#include <pvlogexception.h>
+
+namespace util {
+
+MsgPackWriter::MsgPackWriter(std::string& out) :
+		out(out) {
+	//nothing to do
+}
+
+void MsgPackWriter::put(uint8_t byte) {
+	out += static_cast<char>(byte);
+}
+
+template<typename T>
+void MsgPackWriter::putBigEndian(T value) {
+	for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+		put(static_cast<uint8_t>(value >> shift));
+	}
+}
+
+void MsgPackWriter::header(uint8_t fix, uint8_t fixMax, uint8_t type16, uint8_t type32, std::size_t size) {
+	if (size <= fixMax) {
+		put(fix | static_cast<uint8_t>(size));
+	} else if (size <= 0xffff) {
+		put(type16);
+		putBigEndian(static_cast<uint16_t>(size));
+	} else {
+		put(type32);
+		putBigEndian(static_cast<uint32_t>(size));
+	}
+}
+
+MsgPackWriter& MsgPackWriter::beginObject(std::size_t size) {
+	header(0x80, 15, 0xde, 0xdf, size);
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::beginArray(std::size_t size) {
+	header(0x90, 15, 0xdc, 0xdd, size);
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::value(int64_t value) {
+	if (value >= 0) {
+		if (value <= 0x7f) {
+			put(static_cast<uint8_t>(value));
+		} else if (value <= 0xff) {
+			put(0xcc);
+			put(static_cast<uint8_t>(value));
+		} else if (value <= 0xffff) {
+			put(0xcd);
+			putBigEndian(static_cast<uint16_t>(value));
+		} else if (value <= 0xffffffffLL) {
+			put(0xce);
+			putBigEndian(static_cast<uint32_t>(value));
+		} else {
+			put(0xcf);
+			putBigEndian(static_cast<uint64_t>(value));
+		}
+	} else {
+		if (value >= -32) {
+			put(static_cast<uint8_t>(value));
+		} else if (value >= INT8_MIN) {
+			put(0xd0);
+			put(static_cast<uint8_t>(value));
+		} else if (value >= INT16_MIN) {
+			put(0xd1);
+			putBigEndian(static_cast<uint16_t>(value));
+		} else if (value >= INT32_MIN) {
+			put(0xd2);
+			putBigEndian(static_cast<uint32_t>(value));
+		} else {
+			put(0xd3);
+			putBigEndian(static_cast<uint64_t>(value));
+		}
+	}
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::value(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put(0xcb);
+	putBigEndian(bits);
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::value(const std::string& value) {
+	if (value.size() <= 31) {
+		put(0xa0 | static_cast<uint8_t>(value.size()));
+	} else if (value.size() <= 0xff) {
+		put(0xd9);
+		put(static_cast<uint8_t>(value.size()));
+	} else {
+		header(0, 0, 0xda, 0xdb, value.size());
+	}
+	out += value;
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::value(bool value) {
+	put(value ? 0xc3 : 0xc2);
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::null() {
+	put(0xc0);
+	return *this;
+}
+
+MsgPackWriter& MsgPackWriter::value(const Json::Value& value) {
+	switch (value.type()) {
+	case Json::nullValue:
+		return null();
+	case Json::intValue:
+		return this->value(static_cast<int64_t>(value.asInt64()));
+	case Json::uintValue:
+		if (value.asUInt64() > static_cast<Json::UInt64>(INT64_MAX)) {
+			put(0xcf);
+			putBigEndian(static_cast<uint64_t>(value.asUInt64()));
+			return *this;
+		}
+		return this->value(static_cast<int64_t>(value.asUInt64()));
+	case Json::realValue:
+		return this->value(value.asDouble());
+	case Json::stringValue:
+		return this->value(value.asString());
+	case Json::booleanValue:
+		return this->value(value.asBool());
+	case Json::arrayValue:
+		beginArray(value.size());
+		for (const Json::Value& element : value) {
+			this->value(element);
+		}
+		return endArray();
+	case Json::objectValue:
+		beginObject(value.size());
+		for (auto it = value.begin(); it != value.end(); ++it) {
+			key(it.name());
+			this->value(*it);
+		}
+		return endObject();
+	}
+
+	PVLOG_EXCEPT("Invalid json value type");
+}
+
+MsgPackWriter& MsgPackWriter::raw(const std::string& data) {
+	out += data;
+	return *this;
+}
+
+} //namespace util {
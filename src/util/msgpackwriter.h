@@ -0,0 +1,66 @@
+#ifndef SRC_UTIL_MSGPACKWRITER_H_
+#define SRC_UTIL_MSGPACKWRITER_H_
+
+#include <cstdint>
+#include <string>
+
+#include <boost/optional.hpp>
+#include <jsoncpp/json/value.h>
+
+namespace util {
+
+/**
+ * Writes MessagePack into a string, with the same interface as JsonWriter.
+ *
+ * MessagePack needs the number of entries in front of maps and arrays, so
+ * the sizes passed to beginObject and beginArray have to be correct.
+ */
+class MsgPackWriter {
+public:
+	explicit MsgPackWriter(std::string& out);
+
+	MsgPackWriter& beginObject(std::size_t size);
+	MsgPackWriter& endObject() { return *this; }
+
+	MsgPackWriter& beginArray(std::size_t size);
+	MsgPackWriter& endArray() { return *this; }
+
+	MsgPackWriter& key(const std::string& name) { return value(name); }
+
+	MsgPackWriter& value(int64_t value);
+	MsgPackWriter& value(int32_t value) { return this->value(static_cast<int64_t>(value)); }
+	MsgPackWriter& value(double value);
+	MsgPackWriter& value(const std::string& value);
+	MsgPackWriter& value(const char* value) { return this->value(std::string(value)); }
+	MsgPackWriter& value(bool value);
+	MsgPackWriter& null();
+
+	template<typename T>
+	MsgPackWriter& value(const boost::optional<T>& value) {
+		return value ? this->value(value.get()) : null();
+	}
+
+	/**
+	 * Write json value as MessagePack.
+	 */
+	MsgPackWriter& value(const Json::Value& value);
+
+	/**
+	 * Write already encoded MessagePack as value.
+	 */
+	MsgPackWriter& raw(const std::string& data);
+
+private:
+	void put(uint8_t byte);
+
+	template<typename T>
+	void putBigEndian(T value);
+
+	void header(uint8_t fix, uint8_t fixMax, uint8_t type16, uint8_t type32, std::size_t size);
+
+	std::string& out;
+};
+
+} //namespace util {
+
+#endif /* SRC_UTIL_MSGPACKWRITER_H_ */
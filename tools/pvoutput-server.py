@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+# This file is part of Pvlog.
+#
+# Copyright (C) 2017 pvlogdev@gmail.com
+#
+# Pvlog is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Pvlog is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Pvlog.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Local https stand-in for the pvoutput.org upload api.
+
+Point pvoutput_host and pvoutput_port of pvlog at it to check uploads
+without a pvoutput.org account. Every request is printed with the
+connection it came in on, so keep-alive reuse and tls session resumption
+can be seen. A self-signed certificate is created with openssl if none
+is given, pvlog accepts it.
+"""
+
+import argparse
+import http.server
+import os
+import signal
+import ssl
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.parse
+
+PATHS = {
+    "/service/r2/addstatus.jsp": ("status", False),
+    "/service/r2/addbatchstatus.jsp": ("status", True),
+    "/service/r2/addoutput.jsp": ("output", False),
+    "/service/r2/addbatchoutput.jsp": ("output", True),
+}
+
+MAX_BATCH = 30
+
+
+class Stats:
+    connections = 0
+    resumed = 0
+    requests = 0
+    entries = 0
+    failed = 0
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive
+
+    def setup(self):
+        super().setup()
+        Stats.connections += 1
+        self.connection_id = Stats.connections
+        resumed = self.request.session_reused
+        Stats.resumed += resumed
+        print("connection %d from %s:%d, %s" % (self.connection_id, self.client_address[0],
+              self.client_address[1], "resumed tls session" if resumed else "full handshake"), flush=True)
+
+    def reply(self, status, body, headers=()):
+        data = body.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(data)))
+        for name, value in headers:
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        form = urllib.parse.parse_qs(self.rfile.read(length).decode())
+        Stats.requests += 1
+
+        if self.path not in PATHS:
+            return self.reply(404, "Not found")
+        kind, batch = PATHS[self.path]
+
+        if not self.headers.get("X-Pvoutput-SystemId") or not self.headers.get("X-Pvoutput-Apikey"):
+            return self.reply(401, "Unauthorized 401: Invalid System ID or API Key")
+
+        if self.server.fail > 0:
+            self.server.fail -= 1
+            Stats.failed += 1
+            print("connection %d: %s answered with 500" % (self.connection_id, self.path), flush=True)
+            return self.reply(500, "Internal server error")
+
+        if batch:
+            entries = form.get("data", [""])[0].split(";")
+            if len(entries) > MAX_BATCH:
+                return self.reply(400, "Bad request 400: Too many entries")
+            result = ";".join(",".join(e.split(",")[:2]) + ",1" for e in entries)
+        else:
+            entries = [",".join(form.get(key, [""])[0] for key in ("d", "t", "v1", "v2", "g") if key in form)]
+            result = "OK 200: Added %s" % ("Status" if kind == "status" else "Output")
+        Stats.entries += len(entries)
+
+        print("connection %d: %s %d %s entries: %s" % (self.connection_id, self.path, len(entries), kind,
+              " ".join(entries)), flush=True)
+
+        remaining = max(self.server.requests_per_hour - Stats.requests, 0)
+        self.reply(200, result, [("X-Rate-Limit-Remaining", str(remaining)),
+                                 ("X-Rate-Limit-Limit", str(self.server.requests_per_hour)),
+                                 ("X-Rate-Limit-Reset", str(int(time.time()) + 3600))])
+
+    def log_message(self, format, *args):
+        pass  # requests are printed by do_POST
+
+
+def stop(signum, frame):
+    raise KeyboardInterrupt()
+
+
+def create_certificate(directory):
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                    "-subj", "/CN=localhost", "-keyout", key, "-out", cert],
+                   check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8443, help="port to listen on, pvoutput_port of pvlog")
+    parser.add_argument("--cert", help="certificate in pem format, self-signed if not given")
+    parser.add_argument("--key", help="private key of --cert")
+    parser.add_argument("--fail", type=int, default=0, help="answer the first requests with 500")
+    parser.add_argument("--requests-per-hour", type=int, default=60,
+                        help="quota reported in X-Rate-Limit-Remaining")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        cert, key = (args.cert, args.key) if args.cert else create_certificate(directory)
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(cert, key)
+
+        server = http.server.ThreadingHTTPServer(("localhost", args.port), Handler)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        server.fail = args.fail
+        server.requests_per_hour = args.requests_per_hour
+
+        signal.signal(signal.SIGTERM, stop)
+        print("Listening on https://localhost:%d, set pvoutput_host=localhost and pvoutput_port=%d"
+              % (args.port, args.port), flush=True)
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+        finally:
+            print("%d connections, %d of them resumed, %d requests, %d entries, %d failed"
+                  % (Stats.connections, Stats.resumed, Stats.requests, Stats.entries, Stats.failed))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())